@@ -0,0 +1,87 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttcharset.h
+// Purpose:   Precompiled set of characters for delimiter scanning
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#if !(__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+    #error "The contents of <ttcharset.h> are available only with C++17 or later."
+#endif
+
+/// @file
+/// ttlib::charset converts a set of characters into a 256-bit bitmap along with the lookup tables
+/// needed to check 32 characters at a time using AVX2. Create the set once and use it to scan any
+/// number of strings:
+///
+///      ttlib::charset delims(",;|");
+///      for (auto pos = delims.find_oneof(line); pos != tt::npos; pos = delims.find_oneof(line, pos + 1))
+///          ...
+
+#include <cstdint>
+#include <string_view>
+
+#include "ttlibspace.h"  // ttlib namespace functions and declarations
+
+namespace ttlib
+{
+    class charset
+    {
+    public:
+        charset() {}
+        charset(std::string_view chars) { assign(chars); }
+
+        /// Replaces the current set with chars.
+        void assign(std::string_view chars);
+
+        /// Adds a single character to the set.
+        void add(char ch);
+
+        /// Returns true if ch is in the set.
+        bool contains(char ch) const noexcept
+        {
+            auto uch = static_cast<unsigned char>(ch);
+            return (m_bits[uch >> 6] >> (uch & 63)) & 1;
+        }
+
+        /// Returns the offset of the first character at or after start that is in the set, or
+        /// tt::npos if there isn't one.
+        size_t find_oneof(std::string_view str, size_t start = 0) const noexcept;
+
+        /// Returns the offset of the first character at or after start that is not in the set,
+        /// or tt::npos if there isn't one.
+        size_t find_noneof(std::string_view str, size_t start = 0) const noexcept;
+
+        /// Returns the offset of the last character at or before start that is in the set, or
+        /// tt::npos if there isn't one.
+        size_t rfind_oneof(std::string_view str, size_t start = tt::npos) const noexcept;
+
+        /// Returns the offset of the last character at or before start that is not in the set,
+        /// or tt::npos if there isn't one.
+        size_t rfind_noneof(std::string_view str, size_t start = tt::npos) const noexcept;
+
+        /// Returns the number of different characters in the set.
+        size_t size() const noexcept { return m_count; }
+        bool empty() const noexcept { return m_count == 0; }
+
+    private:
+        size_t scan(std::string_view str, size_t start, bool want) const noexcept;
+        size_t rscan(std::string_view str, size_t start, bool want) const noexcept;
+
+        uint64_t m_bits[4] {};
+
+        // Indexed by the low 4 bits of a character. Each bit n is set if the character with n (or
+        // n + 8 for m_nibble_high) as its high 4 bits is in the set.
+        uint8_t m_nibble_low[16] {};
+        uint8_t m_nibble_high[16] {};
+
+        uint16_t m_count { 0 };
+
+        // When the set is this small, SSE2 can compare against each character directly
+        static constexpr size_t max_small = 4;
+        char m_small[max_small] {};
+    };
+}  // namespace ttlib
@@ -26,6 +26,7 @@
     #include "ttstr.h"  // ttString -- wxString with additional methods similar to ttlib::cstr
 #endif
 
+#include "ttformat.h"    // Type-safe printf-style formatting without intermediate allocations
 #include "ttlibspace.h"  // ttlib namespace functions and declarations
 
 #if !defined(_TTLIB_CVIEW_AVAILABLE_)
@@ -138,27 +139,34 @@ namespace ttlib
             return false;
         }
 
+        /// Returns true if any of the patterns in the ttlib::multisearcher appear in the string.
+        bool strContains(const ttlib::multisearcher& patterns) { return ttlib::strContains(*this, patterns); }
+
         /// Find any one of the characters in a set. Returns offset if found, npos if not.
         ///
         /// This is equivalent to calling std::strpbrk but returns an offset instead of a pointer.
         size_t find_oneof(const char* pszSet) const;
 
-        /// Find any one of the characters in a set. Returns offset if found, npos if not.
-        ///
-        /// This is equivalent to calling std::strpbrk but returns an offset instead of a pointer.
+        /// Find any one of the characters in a set, starting at start. Returns the offset from start
+        /// (not from the beginning of the string) if found, npos if not.
         size_t find_oneof(cview set, size_t start) const;
 
+        /// Find any one of the characters in a precompiled set, starting at start. Unlike find_oneof(),
+        /// returns the offset from the beginning of the string if found, npos if not. Use this when the
+        /// same set is used to scan many strings.
+        size_t find_first_in(const ttlib::charset& set, size_t start = 0) const;
+
         /// Returns offset to the next whitespace character starting with pos. Returns npos if
         /// there are no more whitespaces.
         ///
-        /// A whitespace character is a space, tab, eol or form feed character.
+        /// A whitespace character is a space, tab, eol, vertical tab or form feed character.
         size_t find_space(size_t start = 0) const;
         ttlib::cview view_space(size_t start = 0) const;
 
         /// Returns offset to the next non-whitespace character starting with pos. Returns npos
         /// if there are no more non-whitespace characters.
         ///
-        /// A whitespace character is a space, tab, eol or form feed character.
+        /// A whitespace character is a space, tab, eol, vertical tab or form feed character.
         size_t find_nonspace(size_t start = 0) const;
         ttlib::cview view_nonspace(size_t start = 0) const;
 
@@ -185,7 +193,7 @@ namespace ttlib
         /// any trailing space is removed.
         void erase_from(std::string_view sub);
 
-        /// Removes whitespace: ' ', \t, \r, \\n, \f
+        /// Removes whitespace: ' ', \t, \r, \\n, \v, \f
         ///
         /// where: TRIM::right, TRIM::left, or TRIM::both
         cstr& trim(tt::TRIM where = tt::TRIM::right);
@@ -253,6 +261,9 @@ namespace ttlib
         /// Generates hash of current string using djb2 hash algorithm
         size_t get_hash() const noexcept;
 
+        /// Generates a seeded 64-bit hash of current string. See ttlib::get_hash64().
+        uint64_t get_hash64(uint64_t seed = 0) const noexcept { return ttlib::get_hash64(*this, seed); }
+
         /// Convert the entire string to lower case. Assumes the string is UTF8.
         cstr& MakeLower();
 
@@ -264,15 +275,21 @@ namespace ttlib
         /// Current string is replaced if found, cleared if not.
         bool assignEnvVar(const char* env_var);
 
-        /// Similer to sprintf, but without floating point support.
+        /// Similar to sprintf, but type-safe. See ttformat.h for the supported conversions.
         ///
-        /// %v expects a std::string_view argument.
+        /// %s and %v accept any string type, including std::wstring (which is converted to UTF8).
         ///
         /// %k flag will place a string argument in quotes, and format a numerical argument
         /// with commas or periods (depending on the current locale).
         ///
         /// %z is considered unsigned unless the value is -1.
-        cstr& cdecl Format(std::string_view format, ...);
+        template <typename... Args>
+        cstr& Format(std::string_view format, const Args&... args)
+        {
+            const ttlib::format_arg list[] = { ttlib::format_arg(args)..., ttlib::format_arg() };
+            ttlib::vformat_assign(*this, format, list, sizeof...(args));
+            return *this;
+        }
 
         /// Caution: view is only valid until cstr is modified or destroyed!
         std::string_view subview(size_t start, size_t len) const;
@@ -374,13 +391,17 @@ namespace ttlib
 
         cstr& operator<<(int i)
         {
-            *this += itoa(i);
+            ttlib::itoa_append(*this, i);
             return *this;
         }
 
         cstr& operator<<(size_t i)
         {
-            *this += itoa(i);
+            // tt::npos is displayed as -1, the same as %zu
+            if (i == tt::npos)
+                *this += "-1";
+            else
+                ttlib::itoa_append(*this, i);
             return *this;
         }
 
@@ -431,3 +452,12 @@ namespace ttlib
     };  // end cstr class
 
 }  // namespace ttlib
+
+namespace std
+{
+    template <>
+    struct hash<ttlib::cstr>
+    {
+        size_t operator()(const ttlib::cstr& str) const noexcept { return static_cast<size_t>(ttlib::get_hash64(str)); }
+    };
+}  // namespace std
@@ -122,26 +122,33 @@ namespace ttlib
             return false;
         }
 
+        /// Returns true if any of the patterns in the ttlib::multisearcher appear in the string.
+        bool strContains(const ttlib::multisearcher& patterns) { return ttlib::strContains(*this, patterns); }
+
         /// Find any one of the characters in a set. Returns offset if found, npos if not.
         ///
         /// This is equivalent to calling std::strpbrk but returns an offset instead of a pointer.
         size_t find_oneof(const std::string& set) const;
 
-        /// Find any one of the characters in a set. Returns offset if found, npos if not.
-        ///
-        /// This is equivalent to calling std::strpbrk but returns an offset instead of a pointer.
+        /// Find any one of the characters in a set, starting at start. Returns the offset from start
+        /// (not from the beginning of the string) if found, npos if not.
         size_t find_oneof(cview set, size_t start) const;
 
+        /// Find any one of the characters in a precompiled set, starting at start. Unlike find_oneof(),
+        /// returns the offset from the beginning of the string if found, npos if not. Use this when the
+        /// same set is used to scan many strings.
+        size_t find_first_in(const ttlib::charset& set, size_t start = 0) const;
+
         /// Returns offset to the next whitespace character starting with pos. Returns npos if
         /// there are no more whitespaces.
         ///
-        /// A whitespace character is a space, tab, eol or form feed character.
+        /// A whitespace character is a space, tab, eol, vertical tab or form feed character.
         size_t find_space(size_t start = 0) const;
 
         /// Returns offset to the next non-whitespace character starting with pos. Returns npos
         /// if there are no more non-whitespace characters.
         ///
-        /// A whitespace character is a space, tab, eol or form feed character.
+        /// A whitespace character is a space, tab, eol, vertical tab or form feed character.
         size_t find_nonspace(size_t start = 0) const;
 
         /// Returns an offset to the next word -- i.e., find the first non-whitedspace character
@@ -202,6 +209,9 @@ namespace ttlib
         /// Generates hash of current string using djb2 hash algorithm
         size_t get_hash() const noexcept;
 
+        /// Generates a seeded 64-bit hash of current string. See ttlib::get_hash64().
+        uint64_t get_hash64(uint64_t seed = 0) const noexcept { return ttlib::get_hash64(*this, seed); }
+
         /////////////////////////////////////////////////////////////////////////////////
         // Note: all moveto_() functions start from the beginning of the view. On success
         // they change the view and return true. On failure, the view remains unchanged.
@@ -232,6 +242,24 @@ namespace ttlib
         /// view.
         bool moveto_filename() noexcept;
 
+        /// Move start position forward count UTF8 characters. Fails if the view has fewer
+        /// characters.
+        bool advance(size_t count = 1) noexcept;
+
+        /// Move start position back count UTF8 characters. begin is the start of the string the
+        /// view is part of -- this fails if there are fewer characters between begin and the
+        /// start of the view.
+        bool retreat(size_t count, const char* begin) noexcept;
+
         bool operator==(ttlib::cview str) { return this->is_sameas(str); }
     };
 }  // namespace ttlib
+
+namespace std
+{
+    template <>
+    struct hash<ttlib::cview>
+    {
+        size_t operator()(const ttlib::cview& str) const noexcept { return static_cast<size_t>(ttlib::get_hash64(str)); }
+    };
+}  // namespace std
@@ -0,0 +1,81 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttdiff.h
+// Purpose:   Line-by-line difference between two text files
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#if !(__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+    #error "The contents of <ttdiff.h> are available only with C++17 or later."
+#endif
+
+/// @file
+/// ttlib::diff_lines() returns the ranges of lines that have to be inserted, deleted or changed to
+/// turn one list of lines into another. ttlib::diff_files() does the same for any two of
+/// ttlib::textfile, ttlib::viewfile and ttlib::compactfile:
+///
+///      for (auto& hunk: ttlib::diff_files(original, modified))
+///      {
+///          if (hunk.type == tt::DIFF::changed)
+///              ... // original lines [old_line, old_line + old_count) were replaced with
+///                  // modified lines [new_line, new_line + new_count)
+///      }
+///
+/// Every line is first replaced with an id shared by all the lines that are identical to it, so
+/// the lines themselves are only compared once. The diff is computed with Eugene Myers' O(ND)
+/// algorithm ("An O(ND) Difference Algorithm and Its Variations") using the linear space
+/// refinement, so the time depends on the number of differences rather than on the size of the
+/// files. Lines that appear in only one of the files can never match, so they are marked as
+/// inserted or deleted before the algorithm runs -- this keeps files that have little in common
+/// from taking quadratic time. For very large numbers of differences, the result may not be the
+/// smallest possible edit script, but it is always a correct one.
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "ttlibspace.h"  // ttlib namespace functions and declarations
+
+namespace tt
+{
+    enum class DIFF : uint8_t
+    {
+        inserted,  // new lines were added before old_line
+        deleted,   // old lines were removed before new_line
+        changed,   // old lines were replaced with new lines
+    };
+}
+
+namespace ttlib
+{
+    struct diff_hunk
+    {
+        tt::DIFF type;
+
+        size_t old_line;   // first line in the old file
+        size_t old_count;  // number of old lines, zero for tt::DIFF::inserted
+
+        size_t new_line;   // first line in the new file
+        size_t new_count;  // number of new lines, zero for tt::DIFF::deleted
+    };
+
+    /// Returns the hunks needed to turn old_lines into new_lines, in the order they occur. Lines
+    /// are compared using checkcase. An empty vector means the two lists are the same.
+    std::vector<diff_hunk> diff_lines(const std::vector<std::string_view>& old_lines,
+                                      const std::vector<std::string_view>& new_lines,
+                                      tt::CASE checkcase = tt::CASE::exact);
+
+    /// Returns the hunks needed to turn old_file into new_file. Both arguments can be any
+    /// container of lines that convert to std::string_view (ttlib::textfile, ttlib::viewfile,
+    /// ttlib::compactfile, ttlib::cstrVector, etc.).
+    template <typename T, typename U>
+    std::vector<diff_hunk> diff_files(const T& old_file, const U& new_file, tt::CASE checkcase = tt::CASE::exact)
+    {
+        return diff_lines(std::vector<std::string_view>(old_file.begin(), old_file.end()),
+                          std::vector<std::string_view>(new_file.begin(), new_file.end()), checkcase);
+    }
+}  // namespace ttlib
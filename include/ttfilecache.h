@@ -0,0 +1,157 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttfilecache.h
+// Purpose:   Cache of file fingerprints, content hashes and line indexes
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#if !(__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+    #error "The contents of <ttfilecache.h> are available only with C++17 or later."
+#endif
+
+/// @file
+/// ttlib::filecache remembers the size, modification time and inode of every file read through it,
+/// along with a hash of the file's contents and the position of every line. A program that reads
+/// the same files every time it runs can save the cache when it exits and load it the next time:
+///
+///      ttlib::filecache cache;
+///      cache.load(".file_cache");
+///      for (auto& name: filenames)
+///      {
+///          if (cache.is_unchanged(name))
+///              continue;  // only stat() was called
+///          ttlib::textfile file;
+///          file.ReadFile(name, cache);
+///          ...
+///      }
+///      cache.save(".file_cache");
+///
+/// textfile::ReadFile() and viewfile::ReadFile() still need the file's contents when it is
+/// unchanged, but the lines are created from the cached index instead of searching the text for
+/// line endings. get_hash() and is_unchanged() only need to stat() a file that hasn't changed.
+///
+/// A file that was modified within a couple of seconds of being cached may have been changed
+/// again without its modification time changing, so it is never treated as unchanged -- it is
+/// read and hashed again until it is old enough to trust.
+///
+/// Files are identified by the name they were read with, so always use the same form of a path
+/// (e.g., always relative to the same directory). On Windows, the inode is not available without
+/// opening the file, so only the size and modification time are compared.
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ttlib
+{
+    class filecache
+    {
+    public:
+        struct fingerprint
+        {
+            uint64_t size { 0 };
+            int64_t mtime { 0 };  // last modification time in nanoseconds since 1970
+            uint64_t inode { 0 };
+            uint64_t device { 0 };
+
+            bool operator==(const fingerprint& other) const noexcept
+            {
+                return size == other.size && mtime == other.mtime && inode == other.inode && device == other.device;
+            }
+            bool operator!=(const fingerprint& other) const noexcept { return !(*this == other); }
+        };
+
+        struct entry
+        {
+            fingerprint stamp;
+            uint64_t hash { 0 };       // ttlib::get_hash64() of the text
+            uint64_t text_size { 0 };  // size of the text after conversion to UTF8
+
+            // For each line, the length of the line shifted left one bit, with the low bit set if the
+            // line ends with "\r\n", stored 7 bits per byte. Each line starts right after the line
+            // ending of the previous line, so the offsets don't need to be stored.
+            std::string lines;
+            size_t line_count { 0 };
+
+            // The file was modified too recently to be sure that it won't change again without
+            // its fingerprint changing
+            bool racy { false };
+
+            /// Calls func(offset, length) for each line in the file's text. Returns false if the
+            /// index is damaged, in which case func may already have been called for some lines.
+            template <typename FUNC>
+            bool for_each_line(FUNC&& func) const
+            {
+                auto pos = reinterpret_cast<const unsigned char*>(lines.data());
+                auto end = pos + lines.size();
+                uint64_t offset = 0;
+                for (size_t count = 0; count < line_count; ++count)
+                {
+                    uint64_t value = 0;
+                    for (int shift = 0;; shift += 7)
+                    {
+                        if (pos == end || shift >= 64)
+                            return false;
+                        value |= static_cast<uint64_t>(*pos & 0x7F) << shift;
+                        if (*pos++ < 0x80)
+                            break;
+                    }
+                    auto length = value >> 1;
+                    if (offset + length > text_size)
+                        return false;
+                    func(static_cast<size_t>(offset), static_cast<size_t>(length));
+                    offset += length + 1 + (value & 1);
+                }
+                return true;
+            }
+        };
+
+        /// Replaces the contents of the cache with a cache previously written by save(). Returns
+        /// false (leaving the cache empty) if the file doesn't exist or isn't a valid cache.
+        bool load(std::string_view cache_filename);
+
+        /// Writes the cache to a file, replacing the file atomically.
+        bool save(std::string_view cache_filename);
+
+        /// Returns true if anything has been added or removed since the cache was created,
+        /// loaded or saved.
+        bool is_modified() const noexcept { return m_modified; }
+
+        /// Returns true if filename has the same size, modification time and inode as it had
+        /// when it was cached. Only calls stat() -- the file is not read.
+        bool is_unchanged(std::string_view filename) const;
+
+        /// Sets hash to ttlib::get_hash64() of the file's text after conversion to UTF8. The
+        /// file is only read if it has changed since it was cached. Returns false if the file
+        /// can't be read.
+        bool get_hash(std::string_view filename, uint64_t& hash);
+
+        /// Returns the entry for filename if its fingerprint matches stamp, or nullptr if the
+        /// file isn't cached or has changed.
+        const entry* find(std::string_view filename, const fingerprint& stamp) const;
+
+        /// Hashes and indexes text (the file's contents after conversion to UTF8), and stores it
+        /// as the entry for filename. stamp should be retrieved before the file is read, so that
+        /// a change made while reading it is detected the next time.
+        const entry& insert(std::string_view filename, const fingerprint& stamp, std::string_view text);
+
+        void erase(std::string_view filename);
+        void clear();
+
+        size_t size() const noexcept { return m_entries.size(); }
+        bool empty() const noexcept { return m_entries.empty(); }
+
+        /// Retrieves the size, modification time and inode of filename. Returns false if the file
+        /// doesn't exist.
+        static bool get_fingerprint(std::string_view filename, fingerprint& stamp);
+
+    private:
+        std::unordered_map<std::string, entry> m_entries;
+        bool m_modified { false };
+    };
+}  // namespace ttlib
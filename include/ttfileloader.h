@@ -0,0 +1,115 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttfileloader.h
+// Purpose:   Loads multiple files at the same time on worker threads
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#if !(__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+    #error "The contents of <ttfileloader.h> are available only with C++17 or later."
+#endif
+
+/// @file
+/// ttlib::fileloader reads and parses files into ttlib::viewfile objects on a pool of worker
+/// threads, and returns each one as soon as it is ready:
+///
+///      ttlib::fileloader loader;
+///      loader.add_files(filenames);
+///
+///      ttlib::fileloader::result loaded;
+///      while (loader.next(loaded))
+///      {
+///          if (!loaded.file)
+///              ... // loaded.error is the reason loaded.filename couldn't be read
+///          else
+///              ... // use *loaded.file
+///      }
+///
+/// Each worker opens, maps (or reads) and parses one file at a time, so while one thread is
+/// waiting for the disk, the others are parsing files that have already been read. Files are
+/// returned in the order they finish -- result::index is the order in which they were added.
+///
+/// Unlike ttlib::ThrdPool, this class doesn't require Windows.
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ttcstr.h"      // cstr -- std::string with additional methods
+#include "tttextfile.h"  // Classes for reading and writing text files
+
+namespace ttlib
+{
+    class fileloader
+    {
+    public:
+        struct result
+        {
+            size_t index { 0 };  // zero-based order in which the file was added
+            ttlib::cstr filename;
+
+            // nullptr if the file couldn't be read. The viewfile is allocated separately so that
+            // moving a result never moves the buffer that its lines point to.
+            std::unique_ptr<ttlib::viewfile> file;
+
+            std::error_code error;  // the reason the file couldn't be read
+        };
+
+        /// thread_count is the maximum number of worker threads. Zero creates up to one thread for
+        /// each CPU, but never fewer than 4. Threads are only created as files are added.
+        fileloader(size_t thread_count = 0);
+
+        /// Waits for the files currently being read to finish. Files that haven't been started
+        /// yet are never read.
+        ~fileloader();
+
+        fileloader(const fileloader&) = delete;
+        fileloader& operator=(const fileloader&) = delete;
+
+        /// Adds a file to be loaded. Files can be added at any time, including while calling
+        /// next() for earlier files.
+        void add(std::string_view filename);
+
+        /// Adds every filename in a container of strings.
+        template <typename T>
+        void add_files(const T& filenames)
+        {
+            for (auto& filename: filenames)
+                add(filename);
+        }
+
+        /// Waits for the next file to finish loading. Returns false if every file that has been
+        /// added has already been returned.
+        bool next(result& loaded);
+
+        /// Number of files that have been added but not yet returned by next()
+        size_t pending() const;
+
+    protected:
+        // Loads files until the loader is destroyed
+        void worker();
+
+    private:
+        mutable std::mutex m_mutex;
+        std::condition_variable m_work_ready;
+        std::condition_variable m_result_ready;
+
+        std::deque<std::pair<size_t, ttlib::cstr>> m_jobs;  // files that haven't been started
+        std::deque<result> m_results;                        // files that next() hasn't returned
+        std::vector<std::thread> m_threads;
+
+        size_t m_max_threads;
+        size_t m_added { 0 };
+        size_t m_returned { 0 };
+        bool m_stop { false };
+    };
+}  // namespace ttlib
@@ -0,0 +1,96 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttfilewriter.h
+// Purpose:   Buffered file writer that replaces the file atomically
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#if !(__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+    #error "The contents of <ttfilewriter.h> are available only with C++17 or later."
+#endif
+
+/// @file
+/// ttlib::filewriter writes to a temporary file in the same directory as the file being saved, and
+/// only renames it over the original file when commit() is called. If the program (or the system)
+/// crashes before then, the original file is unchanged. If anything fails, the temporary file is
+/// removed and the original file is left alone.
+///
+///      ttlib::filewriter file;
+///      if (file.open("your filename"))
+///      {
+///          for (auto& line: lines)
+///          {
+///              file.write(line);
+///              file.write('\n');
+///          }
+///          if (!file.commit())
+///              ... // the original file was not changed
+///      }
+///
+/// Output is collected in a large buffer, so the file is written with a few large writes no matter
+/// how many small strings are written. Any write error (including a short write on a full disk) is
+/// remembered and reported by commit().
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "ttcstr.h"  // cstr -- Classes for handling zero-terminated char strings.
+
+namespace ttlib
+{
+    class filewriter
+    {
+    public:
+        filewriter(size_t buffer_size = 256 * 1024) : m_buffer_size(buffer_size ? buffer_size : 1) {}
+
+        /// Calls discard() if commit() wasn't called.
+        ~filewriter() { discard(); }
+
+        filewriter(const filewriter&) = delete;
+        filewriter& operator=(const filewriter&) = delete;
+
+        /// Creates a temporary file that will replace filename when commit() is called. If
+        /// filename is a symbolic link on a POSIX system, the file it points to is replaced.
+        bool open(std::string_view filename);
+
+        bool is_open() const noexcept { return m_handle != invalid_handle; }
+
+        /// Adds str to the buffer, writing the buffer to the file whenever it is full. Returns
+        /// false if this or any previous write failed.
+        bool write(std::string_view str);
+
+        bool write(char ch) { return write(std::string_view(&ch, 1)); }
+
+        /// Writes anything left in the buffer and renames the temporary file to the filename
+        /// passed to open(). If sync is true, the file (and on POSIX systems the directory) is
+        /// flushed to the disk before returning.
+        ///
+        /// Returns false if any write failed, in which case the temporary file is removed.
+        bool commit(bool sync = false);
+
+        /// Closes and removes the temporary file without changing the original file.
+        void discard() noexcept;
+
+    protected:
+        // Writes the buffer to the file
+        bool flush();
+        bool write_all(const char* data, size_t size) noexcept;
+        void close_handle() noexcept;
+
+    private:
+        static constexpr intptr_t invalid_handle = -1;
+
+        std::string m_buffer;
+        size_t m_buffer_size;
+
+        ttlib::cstr m_filename;  // the file that will be replaced
+        ttlib::cstr m_tempname;
+
+        intptr_t m_handle { invalid_handle };  // file descriptor, or HANDLE on Windows
+        bool m_failed { false };
+    };
+}  // namespace ttlib
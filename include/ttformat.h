@@ -0,0 +1,285 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttformat.h
+// Purpose:   Type-safe printf-style formatting without intermediate allocations
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#if !(__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+    #error "The contents of <ttformat.h> are available only with C++17 or later."
+#endif
+
+/// @file
+/// The formatting functions accept a printf-style format string, but each argument carries its own
+/// type, so a mismatched conversion can never read the wrong type. Output is written directly into
+/// the destination string or buffer.
+///
+/// Supported conversions are %c %s %v %d %i %u %o %x %X %p %f %F %e %E %g %G and %%. Flags can
+/// include '-' (left justify), '0' (pad numbers with zeros), '+' and ' ' (sign of a positive number),
+/// '#' (alternate form) and 'k', followed by an optional field width and precision. As with printf,
+/// the precision of an integer is the minimum number of digits. Length modifiers (h, hh, l, ll, j, z,
+/// t, L) are accepted for compatibility.
+///
+/// %k places a string argument in quotes, and formats a decimal argument with the thousands separator
+/// of the current locale.
+///
+/// %s and %v accept any string type (char or wchar_t). Wide strings are converted to UTF8.
+///
+/// %c writes a char or any other single-byte integer (e.g. uint8_t) as that byte. A wider integer
+/// or wchar_t is treated as a Unicode code point and written as UTF8.
+///
+/// %zd, %zu, %zx and %zo display a size_t value of -1 (tt::npos) as "-1".
+///
+/// If the conversion doesn't match the argument (e.g. %s with an integer), the argument is displayed
+/// the way its own type would normally be displayed.
+///
+/// itoa(), hextoa() and their _append() versions convert a single integer without parsing a format
+/// string. They write directly into a buffer or the end of a string, so appending numbers to a string
+/// that already has enough capacity never allocates.
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace ttlib
+{
+    /// A single argument to one of the formatting functions. These are created automatically by the
+    /// variadic formatting templates -- you shouldn't need to create one yourself.
+    class format_arg
+    {
+    public:
+        enum TYPE : uint8_t
+        {
+            type_none,
+            type_signed,
+            type_unsigned,
+            type_char,
+            type_wchar,
+            type_string,
+            type_wstring,
+            type_double,
+            type_pointer,
+        };
+
+        format_arg() noexcept {}
+
+        template <typename T>
+        format_arg(const T& value) noexcept
+        {
+            if constexpr (std::is_same_v<T, char>)
+            {
+                m_type = type_char;
+                m_char = value;
+            }
+            else if constexpr (std::is_same_v<T, wchar_t> || std::is_same_v<T, char16_t> ||
+                               std::is_same_v<T, char32_t>)
+            {
+                m_type = type_wchar;
+                m_unsigned = static_cast<uint32_t>(value);
+            }
+            else if constexpr (std::is_same_v<T, bool>)
+            {
+                m_type = type_unsigned;
+                m_unsigned = value ? 1 : 0;
+                m_size = 1;
+            }
+            else if constexpr (std::is_integral_v<T>)
+            {
+                m_size = sizeof(T);
+                if constexpr (std::is_signed_v<T>)
+                {
+                    m_type = type_signed;
+                    m_signed = value;
+                }
+                else
+                {
+                    m_type = type_unsigned;
+                    m_unsigned = value;
+                }
+            }
+            else if constexpr (std::is_enum_v<T>)
+            {
+                *this = format_arg(static_cast<std::underlying_type_t<T>>(value));
+            }
+            else if constexpr (std::is_floating_point_v<T>)
+            {
+                m_type = type_double;
+                m_double = static_cast<double>(value);
+            }
+            else if constexpr (std::is_null_pointer_v<T>)
+            {
+                m_type = type_pointer;
+                m_pointer = nullptr;
+            }
+            else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+            {
+                // Includes const char*, char arrays, std::string and all ttlib string classes
+                if constexpr (std::is_pointer_v<T>)
+                {
+                    if (!value)
+                    {
+                        m_type = type_string;
+                        m_str = { "(null)", 6 };
+                        return;
+                    }
+                }
+                std::string_view str(value);
+                m_type = type_string;
+                m_str = { str.data(), str.size() };
+            }
+            else if constexpr (std::is_convertible_v<const T&, std::wstring_view>)
+            {
+                if constexpr (std::is_pointer_v<T>)
+                {
+                    if (!value)
+                    {
+                        m_type = type_string;
+                        m_str = { "(null)", 6 };
+                        return;
+                    }
+                }
+                std::wstring_view str(value);
+                m_type = type_wstring;
+                m_str = { str.data(), str.size() };
+            }
+            else if constexpr (std::is_pointer_v<T>)
+            {
+                m_type = type_pointer;
+                m_pointer = value;
+            }
+            else
+            {
+                static_assert(!sizeof(T), "This type cannot be used as an argument to a formatting function.");
+            }
+        }
+
+        TYPE type() const noexcept { return m_type; }
+
+        // Size in bytes of the original integer type
+        size_t size() const noexcept { return m_size; }
+
+        int64_t as_signed() const noexcept { return m_signed; }
+        uint64_t as_unsigned() const noexcept { return m_unsigned; }
+        char as_char() const noexcept { return m_char; }
+        double as_double() const noexcept { return m_double; }
+        const void* as_pointer() const noexcept { return m_pointer; }
+
+        std::string_view as_string() const noexcept
+        {
+            return std::string_view(static_cast<const char*>(m_str.data), m_str.size);
+        }
+        std::wstring_view as_wstring() const noexcept
+        {
+            return std::wstring_view(static_cast<const wchar_t*>(m_str.data), m_str.size);
+        }
+
+    private:
+        struct STRING
+        {
+            const void* data;
+            size_t size;
+        };
+
+        union
+        {
+            int64_t m_signed;
+            uint64_t m_unsigned { 0 };
+            char m_char;
+            double m_double;
+            const void* m_pointer;
+            STRING m_str;
+        };
+
+        TYPE m_type { type_none };
+        uint8_t m_size { 0 };
+    };
+
+    /// Appends the formatted arguments to dest.
+    void vformat_append(std::string& dest, std::string_view format, const format_arg* args, size_t count);
+
+    /// Replaces the contents of dest with the formatted arguments. Arguments may refer to dest.
+    void vformat_assign(std::string& dest, std::string_view format, const format_arg* args, size_t count);
+
+    /// Writes up to size - 1 characters into buffer followed by a zero. Returns the number of characters
+    /// that would have been written if buffer was large enough (not counting the trailing zero).
+    size_t vformat_to(char* buffer, size_t size, std::string_view format, const format_arg* args,
+                      size_t count) noexcept;
+
+    /// Minimum size of a buffer passed to itoa() or hextoa(). This is large enough for any 64-bit value,
+    /// including a sign and a thousands separator between every digit.
+    constexpr size_t itoa_buffer_size = 48;
+
+    /// Writes the digits of value into buffer, preceded by '-' if negative is true. Returns a pointer
+    /// to the character after the last one written -- no trailing zero is added.
+    ///
+    /// If format is true, the thousands separator of the current locale is inserted between groups of
+    /// digits. The locale is only queried once, the first time a separator is needed.
+    char* itoa_digits(char* buffer, uint64_t value, bool negative, bool format) noexcept;
+
+    /// Writes value as lowercase (or uppercase) hexadecimal digits with no prefix. Returns a pointer
+    /// to the character after the last one written -- no trailing zero is added.
+    char* hextoa_digits(char* buffer, uint64_t value, bool upper) noexcept;
+
+    /// Writes value into buffer (which must contain at least itoa_buffer_size characters) and returns
+    /// a pointer to the character after the last one written. No trailing zero is added.
+    template <typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+    char* itoa(char* buffer, T value, bool format = false) noexcept
+    {
+        if constexpr (std::is_signed_v<T>)
+        {
+            auto magnitude = (value < 0) ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+            return itoa_digits(buffer, magnitude, value < 0, format);
+        }
+        else
+        {
+            return itoa_digits(buffer, value, false, format);
+        }
+    }
+
+    /// Appends value to dest. If format is true, the current locale's thousands separator is used.
+    template <typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+    void itoa_append(std::string& dest, T value, bool format = false)
+    {
+        char buffer[itoa_buffer_size];
+        dest.append(buffer, static_cast<size_t>(itoa(buffer, value, format) - buffer));
+    }
+
+    /// Writes value into buffer as hexadecimal digits and returns a pointer to the character after
+    /// the last one written. No prefix or trailing zero is added. Negative values are written as the
+    /// unsigned value of the same type, the same as %x.
+    template <typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+    char* hextoa(char* buffer, T value, bool upper = false) noexcept
+    {
+        return hextoa_digits(buffer, static_cast<std::make_unsigned_t<T>>(value), upper);
+    }
+
+    /// Appends value to dest as hexadecimal digits with no prefix.
+    template <typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+    void hextoa_append(std::string& dest, T value, bool upper = false)
+    {
+        char buffer[itoa_buffer_size];
+        dest.append(buffer, static_cast<size_t>(hextoa(buffer, value, upper) - buffer));
+    }
+
+    /// Appends the formatted arguments to dest.
+    template <typename... Args>
+    void format_append(std::string& dest, std::string_view format, const Args&... args)
+    {
+        // The extra argument prevents a zero-length array when there are no arguments
+        const format_arg list[] = { format_arg(args)..., format_arg() };
+        vformat_append(dest, format, list, sizeof...(args));
+    }
+
+    /// Writes up to size - 1 characters into buffer followed by a zero. Returns the number of characters
+    /// that would have been written if buffer was large enough (not counting the trailing zero).
+    template <typename... Args>
+    size_t format_to(char* buffer, size_t size, std::string_view format, const Args&... args) noexcept
+    {
+        const format_arg list[] = { format_arg(args)..., format_arg() };
+        return vformat_to(buffer, size, format, list, sizeof...(args));
+    }
+}  // namespace ttlib
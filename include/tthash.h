@@ -0,0 +1,271 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      tthash.h
+// Purpose:   Seeded 64-bit string hash and incremental hasher
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#if !(__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+    #error "The contents of <tthash.h> are available only with C++17 or later."
+#endif
+
+/// @file
+/// ttlib::get_hash64() (declared in ttlibspace.h) hashes 16 to 48 bytes per step using 64x64->128 bit
+/// multiplies, and every bit of the input affects every bit of the result. It is a variant of wyhash.
+///
+/// ttlib::hasher produces the same value as get_hash64() for input that is supplied in pieces:
+///
+///      ttlib::hasher hash;
+///      hash.update(path);
+///      hash.update(line);
+///      auto value = hash.digest();
+///
+/// The original djb2 get_hash() functions are unchanged -- use them when the value must match
+/// hashes that were computed (or stored) by earlier versions of ttLib.
+///
+/// The str_hash, str_equal and str_less functors accept any mix of ttlib::cstr, ttlib::cview,
+/// ttlib::sview, std::string and const char* without creating a temporary string. The _nocase
+/// versions ignore ASCII case the same way tt::CASE::either does:
+///
+///      std::set<ttlib::cstr, ttlib::str_less_nocase> files;
+///      if (files.find(ttlib::cview("README.md")) != files.end())
+///          ...
+///
+///      std::unordered_set<ttlib::cstr, ttlib::str_hash_nocase, ttlib::str_equal_nocase> names;
+///
+/// Note that std::map and std::set accept lookups with a different type (since C++14), but
+/// std::unordered_map and std::unordered_set only do so when compiled with C++20.
+///
+/// tt::hash64() computes the same value as ttlib::get_hash64() at compile time, and the _hash literal
+/// calls it. Together they allow a switch on a string, where each case needs just one compare to
+/// rule out a different string that happens to have the same hash:
+///
+///      using namespace tt::literals;
+///      switch (ttlib::get_hash64(option))
+///      {
+///          case "verbose"_hash:
+///              if (option == "verbose")
+///                  ...
+///              break;
+///
+/// Two cases with the same hash won't compile, but a collision can also be checked for directly:
+///
+///      static_assert(tt::hashes_unique({ "help", "verbose", "version" }));
+
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
+
+#include "ttlibspace.h"  // ttlib namespace functions and declarations
+
+namespace tt
+{
+    // Everything in hash_detail is only used to implement tt::hash64() and ttlib::get_hash64().
+    namespace hash_detail
+    {
+        constexpr uint64_t secret[4] = { 0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull,
+                                         0x4d5a2da51de1aa47ull };
+
+        // Returns the high 64 bits of a * b, and replaces a with the low 64 bits. Uses only 64-bit
+        // math so that it can be evaluated by any compiler at compile time.
+        constexpr uint64_t multiply(uint64_t& a, uint64_t b) noexcept
+        {
+            uint64_t ha = a >> 32, hb = b >> 32, la = a & 0xFFFFFFFF, lb = b & 0xFFFFFFFF;
+            uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+            uint64_t carry = t < rl;
+            uint64_t lo = t + (rm1 << 32);
+            carry += lo < t;
+            a = lo;
+            return rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+        }
+
+        constexpr uint64_t mix(uint64_t a, uint64_t b) noexcept
+        {
+            auto high = multiply(a, b);
+            return a ^ high;
+        }
+
+        // Little-endian read of count bytes
+        constexpr uint64_t read(std::string_view str, size_t pos, size_t count) noexcept
+        {
+            uint64_t value = 0;
+            for (size_t idx = count; idx-- > 0;)
+                value = (value << 8) | static_cast<unsigned char>(str[pos + idx]);
+            return value;
+        }
+    }  // namespace hash_detail
+
+    /// Compile-time equivalent of ttlib::get_hash64(). This is much slower than get_hash64(), so only
+    /// use it for strings that are known at compile time.
+    constexpr uint64_t hash64(std::string_view str, uint64_t seed = 0) noexcept
+    {
+        using namespace hash_detail;
+        size_t length = str.size();
+        seed ^= mix(seed ^ secret[0], secret[1]);
+
+        uint64_t a = 0, b = 0;
+        if (length <= 16)
+        {
+            if (length >= 4)
+            {
+                a = (read(str, 0, 4) << 32) | read(str, (length >> 3) << 2, 4);
+                b = (read(str, length - 4, 4) << 32) | read(str, length - 4 - ((length >> 3) << 2), 4);
+            }
+            else if (length > 0)
+            {
+                a = (read(str, 0, 1) << 16) | (read(str, length >> 1, 1) << 8) | read(str, length - 1, 1);
+            }
+        }
+        else
+        {
+            size_t pos = 0;
+            size_t remaining = length;
+            if (remaining > 48)
+            {
+                uint64_t see1 = seed, see2 = seed;
+                do
+                {
+                    seed = mix(read(str, pos, 8) ^ secret[1], read(str, pos + 8, 8) ^ seed);
+                    see1 = mix(read(str, pos + 16, 8) ^ secret[2], read(str, pos + 24, 8) ^ see1);
+                    see2 = mix(read(str, pos + 32, 8) ^ secret[3], read(str, pos + 40, 8) ^ see2);
+                    pos += 48;
+                    remaining -= 48;
+                } while (remaining > 48);
+                seed ^= see1 ^ see2;
+            }
+            while (remaining > 16)
+            {
+                seed = mix(read(str, pos, 8) ^ secret[1], read(str, pos + 8, 8) ^ seed);
+                pos += 16;
+                remaining -= 16;
+            }
+            a = read(str, pos + remaining - 16, 8);
+            b = read(str, pos + remaining - 8, 8);
+        }
+
+        a ^= secret[1];
+        b ^= seed;
+        b = multiply(a, b);
+        return mix(a ^ secret[0] ^ length, b ^ secret[1]);
+    }
+
+    /// Returns true if none of the strings have the same hash. Intended for use in a static_assert.
+    constexpr bool hashes_unique(std::initializer_list<std::string_view> strings) noexcept
+    {
+        for (auto first = strings.begin(); first != strings.end(); ++first)
+        {
+            auto hash = hash64(*first);
+            for (auto second = first + 1; second != strings.end(); ++second)
+            {
+                if (hash64(*second) == hash)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    namespace literals
+    {
+        /// "string"_hash is the same as ttlib::get_hash64("string"), but computed at compile time.
+        constexpr uint64_t operator""_hash(const char* str, size_t length) noexcept
+        {
+            return hash64(std::string_view(str, length));
+        }
+    }  // namespace literals
+}  // namespace tt
+
+namespace ttlib
+{
+    /// Hashes the string as if every ASCII letter were lowercase. Unlike calling get_hash64() on a
+    /// lowercase copy, no memory is allocated.
+    uint64_t get_hash64_nocase(std::string_view str, uint64_t seed = 0) noexcept;
+
+    /// Hashes the string after Unicode simple case folding, so any two strings that
+    /// is_sameas_utf8() considers the same have the same hash. (Defined in ttcasefold.cpp.)
+    uint64_t get_hash64_utf8(std::string_view str, uint64_t seed = 0) noexcept;
+
+    struct str_hash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view str) const noexcept { return static_cast<size_t>(get_hash64(str)); }
+    };
+
+    struct str_equal
+    {
+        using is_transparent = void;
+        bool operator()(std::string_view str1, std::string_view str2) const noexcept { return str1 == str2; }
+    };
+
+    struct str_less
+    {
+        using is_transparent = void;
+        bool operator()(std::string_view str1, std::string_view str2) const noexcept { return str1 < str2; }
+    };
+
+    struct str_hash_nocase
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view str) const noexcept
+        {
+            return static_cast<size_t>(get_hash64_nocase(str));
+        }
+    };
+
+    struct str_equal_nocase
+    {
+        using is_transparent = void;
+        bool operator()(std::string_view str1, std::string_view str2) const noexcept
+        {
+            return is_sameas(str1, str2, tt::CASE::either);
+        }
+    };
+
+    struct str_less_nocase
+    {
+        using is_transparent = void;
+        bool operator()(std::string_view str1, std::string_view str2) const noexcept
+        {
+            return comparei(str1, str2) < 0;
+        }
+    };
+
+    class hasher
+    {
+    public:
+        hasher(uint64_t seed = 0) noexcept { reset(seed); }
+
+        /// Discards all previous input and starts over using seed.
+        void reset(uint64_t seed = 0) noexcept;
+
+        /// Adds more data to the hash.
+        void update(const void* data, size_t length) noexcept;
+        void update(std::string_view str) noexcept { update(str.data(), str.size()); }
+
+        /// Returns the hash of all the data added since the hasher was created or reset. This can be
+        /// called at any time, and more data can still be added afterwards.
+        uint64_t digest() const noexcept;
+
+        /// Total number of bytes added so far.
+        uint64_t length() const noexcept { return m_total; }
+
+    private:
+        void process_block(const unsigned char* block) noexcept;
+
+        uint64_t m_seed;
+        uint64_t m_see1;
+        uint64_t m_see2;
+        uint64_t m_total;
+
+        // Input that hasn't been processed yet. A full block is only processed once more input
+        // arrives, since the final (possibly full) block is handled by digest().
+        unsigned char m_buffer[48];
+        size_t m_buf_len;
+
+        // Last 16 bytes of the most recently processed block. digest() needs these when fewer than
+        // 16 bytes remain in m_buffer.
+        unsigned char m_last[16] {};
+    };
+}  // namespace ttlib
@@ -20,7 +20,9 @@
     #define _TTLIB_NAMESPACE_H_GUARD_  // sanity check to confirm that #pragma once is working as expected
 #endif
 
+#include <array>
 #include <cctype>
+#include <cstdint>
 #include <filesystem>  // directory_entry
 #include <stdlib.h>    // for std::abs(long)
 #include <string>
@@ -97,29 +99,96 @@ namespace tt
         all = true,
     };
 
+    /// Character class flags stored in tt::char_class_table. Only ASCII characters belong to a
+    /// class, so unlike the std::is...() functions, the result never depends on the current locale.
+    enum CHARCLASS : uint8_t
+    {
+        cls_space = 1 << 0,   // ' ', \t, \n, \v, \f, \r
+        cls_digit = 1 << 1,   // 0-9
+        cls_upper = 1 << 2,   // A-Z
+        cls_lower = 1 << 3,   // a-z
+        cls_punct = 1 << 4,   // printable characters other than letters, digits and space
+        cls_cntrl = 1 << 5,   // 0x00-0x1F and 0x7F
+        cls_xdigit = 1 << 6,  // 0-9, A-F, a-f
+        cls_blank = 1 << 7,   // ' ' and \t
+    };
+
+    constexpr uint8_t classify_char(unsigned char ch) noexcept
+    {
+        uint8_t classes = 0;
+        if (ch == ' ' || (ch >= '\t' && ch <= '\r'))
+            classes |= cls_space;
+        if (ch == ' ' || ch == '\t')
+            classes |= cls_blank;
+        if (ch >= '0' && ch <= '9')
+            classes |= cls_digit | cls_xdigit;
+        if (ch >= 'A' && ch <= 'Z')
+            classes |= cls_upper;
+        if (ch >= 'a' && ch <= 'z')
+            classes |= cls_lower;
+        if ((ch >= 'A' && ch <= 'F') || (ch >= 'a' && ch <= 'f'))
+            classes |= cls_xdigit;
+        if (ch < 0x20 || ch == 0x7F)
+            classes |= cls_cntrl;
+        if (ch > ' ' && ch < 0x7F && !(classes & (cls_digit | cls_upper | cls_lower)))
+            classes |= cls_punct;
+        return classes;
+    }
+
+    constexpr std::array<uint8_t, 256> make_char_class_table() noexcept
+    {
+        std::array<uint8_t, 256> table {};
+        for (size_t ch = 0; ch < table.size(); ++ch)
+            table[ch] = classify_char(static_cast<unsigned char>(ch));
+        return table;
+    }
+
+    /// tt::CHARCLASS flags for every char value (after casting it to unsigned char)
+    inline constexpr std::array<uint8_t, 256> char_class_table = make_char_class_table();
+
 }  // namespace tt
 
 namespace ttlib
 {
     class cstr;  // forward definition
     class cview;
+    class charset;
+    class multisearcher;
 
     extern const std::string emptystring;
 
-    // These functions are provided for convenience since they cast a char to unsigned char before calling the std::
-    // library function.
-
-    inline bool is_alnum(char ch) { return std::isalnum(static_cast<unsigned char>(ch)); }
-    inline bool is_alpha(char ch) { return std::isalpha(static_cast<unsigned char>(ch)); }
-    inline bool is_blank(char ch) { return std::isblank(static_cast<unsigned char>(ch)); }
-    inline bool is_cntrl(char ch) { return std::iscntrl(static_cast<unsigned char>(ch)); }
-    inline bool is_digit(char ch) { return std::isdigit(static_cast<unsigned char>(ch)); }
-    inline bool is_graph(char ch) { return std::isgraph(static_cast<unsigned char>(ch)); }
-    inline bool is_lower(char ch) { return std::islower(static_cast<unsigned char>(ch)); }
-    inline bool is_print(char ch) { return std::isprint(static_cast<unsigned char>(ch)); }
-    inline bool is_punctuation(char ch) { return std::ispunct(static_cast<unsigned char>(ch)); }
-    inline bool is_upper(char ch) { return std::isupper(static_cast<unsigned char>(ch)); }
-    inline bool is_whitespace(char ch) { return std::isspace(static_cast<unsigned char>(ch)); }
+    // These functions look up the character in tt::char_class_table rather than calling the std:: library
+    // function, so they are faster and only recognize ASCII characters regardless of the current locale.
+
+    constexpr bool is_class(char ch, uint8_t classes) noexcept
+    {
+        return (tt::char_class_table[static_cast<unsigned char>(ch)] & classes) != 0;
+    }
+
+    constexpr bool is_alnum(char ch) noexcept { return is_class(ch, tt::cls_digit | tt::cls_upper | tt::cls_lower); }
+    constexpr bool is_alpha(char ch) noexcept { return is_class(ch, tt::cls_upper | tt::cls_lower); }
+    constexpr bool is_blank(char ch) noexcept { return is_class(ch, tt::cls_blank); }
+    constexpr bool is_cntrl(char ch) noexcept { return is_class(ch, tt::cls_cntrl); }
+    constexpr bool is_digit(char ch) noexcept { return is_class(ch, tt::cls_digit); }
+    constexpr bool is_graph(char ch) noexcept
+    {
+        return is_class(ch, tt::cls_digit | tt::cls_upper | tt::cls_lower | tt::cls_punct);
+    }
+    constexpr bool is_lower(char ch) noexcept { return is_class(ch, tt::cls_lower); }
+    constexpr bool is_print(char ch) noexcept { return ch == ' ' || is_graph(ch); }
+    constexpr bool is_punctuation(char ch) noexcept { return is_class(ch, tt::cls_punct); }
+    constexpr bool is_upper(char ch) noexcept { return is_class(ch, tt::cls_upper); }
+    constexpr bool is_whitespace(char ch) noexcept { return is_class(ch, tt::cls_space); }
+
+    /// Returns the offset of the first character at or after start that belongs to any of the
+    /// tt::CHARCLASS classes in classes, or tt::npos if there isn't one.
+    ///
+    /// Uses SSE2 or AVX2 (chosen at runtime) when available to check 16 or 32 characters at a time.
+    size_t find_class(std::string_view str, uint8_t classes, size_t start = 0) noexcept;
+
+    /// Returns the offset of the first character at or after start that does not belong to any
+    /// of the tt::CHARCLASS classes in classes, or tt::npos if there isn't one.
+    size_t find_nonclass(std::string_view str, uint8_t classes, size_t start = 0) noexcept;
 
     /// Is ch the start of a utf8 sequence?
     constexpr inline bool is_utf8(char ch) noexcept { return ((ch & 0xC0) != 0x80); }
@@ -144,6 +213,10 @@ namespace ttlib
     /// Returns true if the sub-string is identical to the first part of the main string
     bool is_sameprefix(std::string_view strMain, std::string_view strSub, tt::CASE checkcase = tt::CASE::exact);
 
+    /// Case-insensitive comparison of ASCII letters. Returns zero if the strings are the same, a
+    /// negative value if str1 sorts before str2, and a positive value if it sorts after it.
+    int comparei(std::string_view str1, std::string_view str2) noexcept;
+
     /// Return a view to the portion of the string beginning with the sub string.
     ///
     /// Return view is empty if substring is not found.
@@ -152,6 +225,13 @@ namespace ttlib
     /// Returns the position of sub within main, or npos if not found.
     size_t findstr_pos(std::string_view main, std::string_view sub, tt::CASE checkcase = tt::CASE::exact);
 
+    /// Returns the position of sub within main starting at start, or npos if not found. The
+    /// comparison ignores the case of ASCII letters.
+    ///
+    /// Uses SSE2 or AVX2 (chosen at runtime) when available, and never takes more than linear
+    /// time regardless of the contents of main and sub.
+    size_t find_nocase(std::string_view main, std::string_view sub, size_t start = 0) noexcept;
+
     /// Returns true if the sub string exists withing the main string.
     ///
     /// Same as find_str but with a boolean return instead of a string_view.
@@ -169,6 +249,11 @@ namespace ttlib
         return false;
     }
 
+    /// Returns true if any of the patterns in the ttlib::multisearcher appear in str. Unlike the
+    /// template version, this examines each character of str only once no matter how many
+    /// patterns there are. See ttmultisearch.h.
+    bool strContains(std::string_view str, const ttlib::multisearcher& patterns);
+
     // Combining has_member() and add_if() lets you use a std::vector like a std::set -- the vector will have have a lower
     // memory footprint, but searching will be slower.
 
@@ -249,6 +334,40 @@ namespace ttlib
     /// Returns a pointer to the next character in a UTF8 string.
     const char* next_utf8_char(const char* psz) noexcept;
 
+    // The following functions use the simple Unicode case mappings built into the library -- they
+    // never use the current locale and never allocate memory.
+
+    /// Returns the Unicode simple case folding of a code point. Two code points are equal
+    /// ignoring case if their folded values are identical.
+    char32_t fold_case(char32_t ch) noexcept;
+
+    /// Returns the Unicode simple lowercase mapping of a code point.
+    char32_t to_lower(char32_t ch) noexcept;
+
+    /// Returns the Unicode simple uppercase mapping of a code point.
+    char32_t to_upper(char32_t ch) noexcept;
+
+    /// Returns true if the UTF8 strings are identical after case folding.
+    bool is_sameas_utf8(std::string_view str1, std::string_view str2) noexcept;
+
+    /// Returns true if the UTF8 sub-string is identical to the first part of the main string
+    /// after case folding.
+    bool is_sameprefix_utf8(std::string_view strMain, std::string_view strSub) noexcept;
+
+    /// Returns the position of the UTF8 sub string within main starting at start, or npos if
+    /// not found. Case folding is applied to every code point.
+    ///
+    /// Note that a few characters (such as the Kelvin sign) match a character with a
+    /// different UTF8 length, so the matching text in main is not always the same length as
+    /// sub.
+    size_t find_utf8(std::string_view main, std::string_view sub, size_t start = 0) noexcept;
+
+    /// Converts a UTF8 string to lowercase.
+    void MakeLower(std::string& str);
+
+    /// Converts a UTF8 string to uppercase.
+    void MakeUpper(std::string& str);
+
     /// Returns view to the next whitespace character. View is empty if there are no more
     /// whitespaces.
     std::string_view find_space(std::string_view str) noexcept;
@@ -282,24 +401,37 @@ namespace ttlib
     cview view_stepover(const std::string& str, size_t startpos = 0) noexcept;
 
     /// Generates hash of string using djb2 hash algorithm
+    ///
+    /// Use get_hash64() instead unless the hash needs to match values generated by earlier versions.
     size_t get_hash(std::string_view str) noexcept;
 
-    /// Converts a string into an integer.
+    /// Generates a 64-bit hash of the string that is much faster than get_hash() on anything but
+    /// very short strings, and has far fewer collisions. Different seeds produce unrelated hashes.
+    ///
+    /// Use ttlib::hasher in tthash.h to hash data that arrives in pieces.
+    uint64_t get_hash64(std::string_view str, uint64_t seed = 0) noexcept;
+
+    /// Converts a string into an integer, skipping any leading whitespace.
     ///
     /// If string begins with '0x' it is assumed to be hexadecimal and is converted.
     /// String may begin with a '-' or '+' to indicate the sign of the integer.
+    ///
+    /// Use the parse functions in ttnumparse.h to detect errors or to find out where the
+    /// number ends.
     int atoi(std::string_view str) noexcept;
 
     /// Converts a signed integer into a string.
     ///
     /// If format is true, the number will be formatted with ',' or '.' depending on the
     /// current locale.
+    ///
+    /// See ttformat.h for versions that write into an existing buffer or append to a string.
     ttlib::cstr itoa(int val, bool format = false);
 
     /// Converts a size_t into a string.
     ///
     /// If format is true, the number will be formatted with ',' or '.' depending on the
-    /// current locale.
+    /// current locale. tt::npos is returned as "-1".
     ttlib::cstr itoa(size_t val, bool format = false);
 
     /// Return a view to a filename's extension. View is empty if there is no extension.
@@ -330,8 +462,13 @@ namespace ttlib
     bool dir_exists(std::string_view dir);
     bool file_exists(std::string_view filename);
 
-    void utf8to16(std::string_view str, std::wstring& dest);
-    void utf16to8(std::wstring_view str, std::string& dest);
+    /// Appends the converted string to dest. Returns false if str contains invalid UTF8, in which
+    /// case each invalid sequence is converted to U+FFFD. See ttutf.h for details.
+    bool utf8to16(std::string_view str, std::wstring& dest);
+
+    /// Appends the converted string to dest. Returns false if str contains an unpaired surrogate, in
+    /// which case it is converted to U+FFFD.
+    bool utf16to8(std::wstring_view str, std::string& dest);
 
     std::wstring utf8to16(std::string_view str);
     ttlib::cstr utf16to8(std::wstring_view str);
@@ -0,0 +1,57 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttmapfile.h
+// Purpose:   Read-only memory-mapped file
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#if !(__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+    #error "The contents of <ttmapfile.h> are available only with C++17 or later."
+#endif
+
+/// @file
+/// ttlib::mapfile maps an entire file into memory so that it can be viewed without copying it. The
+/// pages are read in by the operating system as they are accessed (on Linux they are read in when
+/// the file is mapped, since the file is expected to be read from start to finish).
+///
+/// Only regular files can be mapped -- open() fails for pipes, devices and empty files, in which
+/// case the file should be read normally.
+///
+/// On Windows, the file can't be replaced (e.g., by ttlib::filewriter) until it is closed.
+
+#include <string_view>
+
+namespace ttlib
+{
+    class mapfile
+    {
+    public:
+        mapfile() = default;
+        ~mapfile() { close(); }
+
+        mapfile(const mapfile&) = delete;
+        mapfile& operator=(const mapfile&) = delete;
+
+        /// Maps the entire file into memory. Returns false if the file doesn't exist, can't
+        /// be read, is empty, or isn't a regular file.
+        bool open(std::string_view filename);
+
+        /// Unmaps the file. Any views of the file become invalid.
+        void close() noexcept;
+
+        bool is_open() const noexcept { return m_data != nullptr; }
+
+        const char* data() const noexcept { return m_data; }
+        size_t size() const noexcept { return m_size; }
+
+        /// Returns a view of the entire file.
+        std::string_view view() const noexcept { return std::string_view(m_data, m_size); }
+
+    private:
+        const char* m_data { nullptr };
+        size_t m_size { 0 };
+    };
+}  // namespace ttlib
@@ -0,0 +1,119 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttmultisearch.h
+// Purpose:   Search for any number of strings in a single pass
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#if !(__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+    #error "The contents of <ttmultisearch.h> are available only with C++17 or later."
+#endif
+
+/// @file
+/// ttlib::multisearcher compiles a list of strings into an Aho-Corasick automaton. Searching examines
+/// each character of the text exactly once, so the time it takes depends on the length of the text and
+/// not on how many strings are being searched for.
+///
+///      ttlib::multisearcher keywords({ "TODO", "FIXME", "REVIEW" }, tt::CASE::either);
+///      for (auto& line: file)
+///      {
+///          if (line.strContains(keywords))
+///              ...
+///      }
+
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ttlibspace.h"  // ttlib namespace functions and declarations
+
+namespace ttlib
+{
+    class multisearcher
+    {
+    public:
+        struct match
+        {
+            size_t pos;      // offset of the match within the text, or tt::npos if there is no match
+            size_t pattern;  // zero-based index of the pattern that matched (order in which it was added)
+        };
+
+        multisearcher() {}
+
+        /// patterns can be any container of strings (std::vector<std::string>, ttlib::cstrVector,
+        /// etc.). tt::CASE::utf8 is treated as tt::CASE::either -- only ASCII letters are
+        /// case-insensitive.
+        template <class iterT,
+                  std::enable_if_t<std::is_convertible_v<decltype(*std::begin(std::declval<const iterT&>())),
+                                                         std::string_view>,
+                                   int> = 0>
+        explicit multisearcher(const iterT& patterns, tt::CASE checkcase = tt::CASE::exact) : m_case(checkcase)
+        {
+            for (auto& iter: patterns)
+                add(iter);
+            compile();
+        }
+
+        multisearcher(std::initializer_list<std::string_view> patterns, tt::CASE checkcase = tt::CASE::exact) :
+            m_case(checkcase)
+        {
+            for (auto iter: patterns)
+                add(iter);
+            compile();
+        }
+
+        /// Adds a pattern. You must call compile() after adding patterns and before searching.
+        /// Empty patterns are accepted (so that pattern indices are unchanged) but never match.
+        void add(std::string_view pattern) { m_patterns.emplace_back(pattern); }
+
+        /// Builds the search automaton from all of the patterns that have been added.
+        void compile();
+
+        /// Changes case sensitivity. You must call compile() afterwards.
+        void set_case(tt::CASE checkcase) { m_case = checkcase; }
+
+        /// Returns true if any pattern appears in text.
+        bool contains(std::string_view text) const noexcept { return find(text).pos != tt::npos; }
+
+        /// Returns true if every non-empty pattern appears at least once in text.
+        bool contains_all(std::string_view text) const;
+
+        /// Returns the match that ends first at or after start. If more than one pattern ends at
+        /// the same position, the longest one is returned.
+        match find(std::string_view text, size_t start = 0) const noexcept;
+
+        /// Returns every match, including overlapping matches, ordered by where each match ends.
+        std::vector<match> find_all(std::string_view text) const;
+
+        const std::string& pattern(size_t index) const { return m_patterns[index]; }
+        size_t size() const noexcept { return m_patterns.size(); }
+        bool empty() const noexcept { return m_patterns.empty(); }
+
+    private:
+        std::vector<std::string> m_patterns;
+        tt::CASE m_case { tt::CASE::exact };
+
+        // Characters that don't appear in any pattern all share class 0, which keeps the
+        // transition table small.
+        uint16_t m_class[256] {};
+        size_t m_classes { 0 };
+
+        // Transition table: m_delta[state * m_classes + class] is the next state. Every transition
+        // is filled in, so the search never needs to follow failure links.
+        std::vector<uint32_t> m_delta;
+
+        // Patterns that end in a state are m_out_ids[m_out_start[state]] to m_out_ids[m_out_start[state + 1]]
+        std::vector<uint32_t> m_out_start;
+        std::vector<uint32_t> m_out_ids;
+
+        size_t m_non_empty { 0 };
+    };
+}  // namespace ttlib
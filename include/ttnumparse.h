@@ -0,0 +1,63 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttnumparse.h
+// Purpose:   Fast integer and floating-point parsing over string views
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#if !(__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+    #error "The contents of <ttnumparse.h> are available only with C++17 or later."
+#endif
+
+/// @file
+/// The parse functions convert the number at the very beginning of a view -- unlike ttlib::atoi()
+/// they do not skip leading whitespace. Each returns the value, the number of characters that were
+/// part of the number, and an error code. Since ttlib::sview and ttlib::cview are string_views, a
+/// tokenizer can step over each number without scanning it a second time:
+///
+///      ttlib::sview fields(line);
+///      while (!fields.empty())
+///      {
+///          auto result = ttlib::parse_int64(fields);
+///          if (!result)
+///              break;
+///          total += result.value;
+///          fields.remove_prefix(result.length);
+///          fields.moveto_nonspace();
+///      }
+///
+/// Integers may begin with '+' or '-' (only '+' for unsigned values) and may use a "0x" prefix for
+/// hexadecimal. Floating-point values are parsed exactly -- the result is always the closest double
+/// to the decimal value.
+
+#include <cstdint>
+#include <string_view>
+#include <system_error>
+
+namespace ttlib
+{
+    template <typename T>
+    struct number_result
+    {
+        T value { 0 };
+
+        // Number of characters that were converted. If the number is out of range, this still
+        // includes all of its digits.
+        size_t length { 0 };
+
+        // std::errc::invalid_argument if str doesn't begin with a number, and
+        // std::errc::result_out_of_range if the number doesn't fit in T (in which case value is the
+        // closest value that does fit).
+        std::errc error { std::errc::invalid_argument };
+
+        explicit operator bool() const noexcept { return error == std::errc(); }
+    };
+
+    number_result<int32_t> parse_int32(std::string_view str) noexcept;
+    number_result<int64_t> parse_int64(std::string_view str) noexcept;
+    number_result<uint64_t> parse_uint64(std::string_view str) noexcept;
+    number_result<double> parse_double(std::string_view str) noexcept;
+}  // namespace ttlib
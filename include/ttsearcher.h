@@ -0,0 +1,89 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttsearcher.h
+// Purpose:   Precompiled search string for repeated searches
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#if !(__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+    #error "The contents of <ttsearcher.h> are available only with C++17 or later."
+#endif
+
+/// @file
+/// ttlib::searcher does all of the setup work for a search string once, so that the same string can be
+/// searched for in any number of strings without repeating that work. Use it when the same search string
+/// is going to be used for many lines or files:
+///
+///      ttlib::searcher search("FindLineContaining", tt::CASE::either);
+///      for (auto& file: files)
+///      {
+///          if (search.contains(file.GetBuffer()))
+///              ...
+///      }
+///
+/// Both ttlib::textfile and ttlib::viewfile have a FindLineContaining() overload that accepts a searcher.
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ttlibspace.h"  // ttlib namespace functions and declarations
+
+namespace ttlib
+{
+    class searcher
+    {
+    public:
+        searcher() {}
+        searcher(std::string_view needle, tt::CASE checkcase = tt::CASE::exact) { compile(needle, checkcase); }
+
+        /// Replaces any previous search string with needle.
+        void compile(std::string_view needle, tt::CASE checkcase = tt::CASE::exact);
+
+        /// Returns the offset of the first match at or after start, or tt::npos if there is
+        /// no match (or the search string is empty).
+        size_t find(std::string_view str, size_t start = 0) const noexcept;
+
+        bool contains(std::string_view str) const noexcept { return find(str) != tt::npos; }
+
+        /// Returns the offset of every non-overlapping match in str.
+        std::vector<size_t> find_all(std::string_view str) const;
+
+        /// Returns the search string passed to the constructor or compile().
+        const std::string& needle() const noexcept { return m_needle; }
+
+        tt::CASE checkcase() const noexcept { return m_case; }
+
+        bool empty() const noexcept { return m_needle.empty(); }
+
+    private:
+        // The search method is chosen when the needle is compiled.
+        enum class METHOD : uint8_t
+        {
+            none,    // empty needle, never matches
+            exact,   // characters must match exactly
+            nocase,  // ASCII letters match either case
+            utf8,    // needle requires full UTF8 case folding -- ttlib::find_utf8()
+        };
+
+        std::string m_needle;
+        tt::CASE m_case { tt::CASE::exact };
+        METHOD m_method { METHOD::none };
+
+        // Two-Way critical factorization of the needle
+        size_t m_suffix { 0 };
+        size_t m_period { 0 };
+        bool m_periodic { false };
+
+        // Number of code points in the needle, used to step over a METHOD::utf8 match
+        size_t m_codepoints { 0 };
+
+        // Horspool skip table indexed by character. This is only filled in on platforms where the
+        // SIMD search isn't available.
+        uint32_t m_skip[256];
+    };
+}  // namespace ttlib
@@ -33,6 +33,7 @@ namespace ttlib
         using bsv = std::basic_string_view<char, std::char_traits<char>>;
 
     public:
+        sview() noexcept : bsv() {}
         sview(const std::string& str) : bsv(str.c_str(), str.length()) {}
         sview(const char* str, size_t len) : bsv(str, len) {}
         sview(const char* str) : bsv(str) {}
@@ -97,22 +98,29 @@ namespace ttlib
             return false;
         }
 
+        /// Returns true if any of the patterns in the ttlib::multisearcher appear in the string.
+        bool strContains(const ttlib::multisearcher& patterns) { return ttlib::strContains(*this, patterns); }
+
         /// Find any one of the characters in a set. Returns offset if found, npos if not.
         size_t find_oneof(const std::string& set, size_t start = 0) const;
 
         /// Find any one of the characters in a set. Returns offset if found, npos if not.
         size_t find_oneof(sview set, size_t start = 0) const;
 
+        /// Find any one of the characters in a precompiled set, starting at start. Returns offset if found,
+        /// npos if not. Use this when the same set is used to scan many strings.
+        size_t find_first_in(const ttlib::charset& set, size_t start = 0) const;
+
         /// Returns offset to the next whitespace character starting with pos. Returns npos if
         /// there are no more whitespaces.
         ///
-        /// A whitespace character is a space, tab, eol or form feed character.
+        /// A whitespace character is a space, tab, eol, vertical tab or form feed character.
         size_t find_space(size_t start = 0) const;
 
         /// Returns offset to the next non-whitespace character starting with pos. Returns npos
         /// if there are no more non-whitespace characters.
         ///
-        /// A whitespace character is a space, tab, eol or form feed character.
+        /// A whitespace character is a space, tab, eol, vertical tab or form feed character.
         size_t find_nonspace(size_t start = 0) const;
 
         /// Returns an offset to the next word -- i.e., find the first non-whitedspace character
@@ -127,7 +135,7 @@ namespace ttlib
         /// Returns true if the sub-string is identical to the first part of the main string
         bool is_sameprefix(std::string_view str, tt::CASE checkcase = tt::CASE::exact) const;
 
-        int atoi(size_t start = 0) const { return ttlib::atoi(data() + start); }
+        int atoi(size_t start = 0) const { return ttlib::atoi(subview(start)); }
 
         /// Returns true if current filename contains the specified case-insensitive extension.
         bool has_extension(std::string_view ext) const { return ttlib::is_sameas(extension(), ext, tt::CASE::either); }
@@ -157,7 +165,7 @@ namespace ttlib
         /// any trailing space is removed.
         sview& erase_from(std::string_view sub, tt::CASE check = tt::CASE::exact);
 
-        /// Removes whitespace: ' ', \t, \r, \\n, \f
+        /// Removes whitespace: ' ', \t, \r, \\n, \v, \f
         ///
         /// where: TRIM::right, TRIM::left, or TRIM::both
         sview& trim(tt::TRIM where = tt::TRIM::right);
@@ -203,6 +211,9 @@ namespace ttlib
         /// Generates hash of current string using djb2 hash algorithm
         size_t get_hash() const noexcept;
 
+        /// Generates a seeded 64-bit hash of current string. See ttlib::get_hash64().
+        uint64_t get_hash64(uint64_t seed = 0) const noexcept { return ttlib::get_hash64(*this, seed); }
+
         /////////////////////////////////////////////////////////////////////////////////
         // Note: all moveto_() functions start from the beginning of the sview. On success
         // they change the sview and return true. On failure, the sview remains unchanged.
@@ -240,6 +251,24 @@ namespace ttlib
         /// character found after substr.
         bool moveto_substr(std::string_view substr, bool StepOverIfFound = false) noexcept;
 
+        /// Move start position forward count UTF8 characters. Fails if the sview has fewer
+        /// characters.
+        bool advance(size_t count = 1) noexcept;
+
+        /// Move start position back count UTF8 characters. begin is the start of the string the
+        /// sview is part of -- this fails if there are fewer characters between begin and the
+        /// start of the sview.
+        bool retreat(size_t count, const char* begin) noexcept;
+
         bool operator==(ttlib::sview str) { return this->is_sameas(str); }
     };
 }  // namespace ttlib
+
+namespace std
+{
+    template <>
+    struct hash<ttlib::sview>
+    {
+        size_t operator()(const ttlib::sview& str) const noexcept { return static_cast<size_t>(ttlib::get_hash64(str)); }
+    };
+}  // namespace std
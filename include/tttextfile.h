@@ -29,18 +29,28 @@
 ///             file.WriteFile("your filename");
 ///      }
 ///
-/// Note: The entire file is read into memory, so these classes are not appropriate for extemely large
-/// files.
-
+/// Note: ttlib::textfile reads the entire file into memory, so it is not appropriate for extemely large
+/// files. ttlib::viewfile memory-maps UTF8 files (except on Windows, where a mapped file can't be
+/// replaced), so only the line views are allocated. Use
+/// ttlib::linereader to read a file that is larger than the available memory one line at a time.
+
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <memory>
 #include <string_view>
 #include <vector>
 
 #include "ttcstr.h"   // cstr -- std::string with additional methods
 #include "ttsview.h"  // sview -- std::string_view with additional methods
+#include "ttutf.h"    // Unicode conversion, validation and decoding
 
 namespace ttlib
 {
-    class viewfile;  // forward definition
+    class viewfile;   // forward definition
+    class searcher;   // forward definition
+    class mapfile;    // forward definition
+    class filecache;  // forward definition
 
     /// This reads a line-oriented file into a vector of ttlib::cstr (std::string)
     /// allowing you to modify, append, or delete individual lines. If you write
@@ -50,7 +60,22 @@ namespace ttlib
     public:
         /// Reads a line-oriented file and converts each line into a ttlib::cstr
         /// (std::string).
-        bool ReadFile(std::string_view filename);
+        ///
+        /// UTF-16, UTF-32 and Windows-1252 files are converted to UTF8 as they are read (see
+        /// ttlib::detect_encoding() in ttutf.h). A byte order mark is not included in the
+        /// first line.
+        ///
+        /// If invalid_utf8 is not null, the file is checked for invalid UTF8 before it is
+        /// parsed. If an invalid sequence is found, *invalid_utf8 is set to its offset in the
+        /// file, no lines are read, and false is returned. Otherwise *invalid_utf8 is set to
+        /// tt::npos. Files that are detected as UTF-16 or UTF-32 are always converted to valid
+        /// UTF8, but a file that would otherwise be treated as Windows-1252 is checked as UTF8.
+        bool ReadFile(std::string_view filename, size_t* invalid_utf8 = nullptr);
+
+        /// Same as above, but if the file hasn't changed since it was added to cache, the lines
+        /// are created from the cached line index instead of searching for line endings. If the
+        /// file has changed, it is added to the cache. See ttfilecache.h.
+        bool ReadFile(std::string_view filename, ttlib::filecache& cache);
 
         /// This will be the filename passed to ReadFile()
         ttlib::cstr& filename() { return m_filename; }
@@ -78,8 +103,10 @@ namespace ttlib
         /// Reads count items from an array of char* strings.
         void ReadArray(const char** begin, size_t count);
 
-        /// Writes each line to the file adding a '\n' to the end of the line.
-        bool WriteFile(const std::string& filename) const;
+        /// Writes each line to the file adding a '\n' to the end of the line. The lines are written
+        /// to a temporary file which then replaces filename, so filename is unchanged if writing
+        /// fails. If sync is true, the file is flushed to the disk before returning.
+        bool WriteFile(const std::string& filename, bool sync = false) const;
 
         /// Writes to the same file that was previously read
         bool WriteFile() const { return !m_filename.empty() ? WriteFile(m_filename) : false; }
@@ -89,13 +116,17 @@ namespace ttlib
         /// startline is the zero-based offset to the line to start searching.
         size_t FindLineContaining(std::string_view str, size_t startline = 0, tt::CASE checkcase = tt::CASE::exact) const;
 
+        /// Same as above, but uses a search string that has already been compiled. Use this when
+        /// searching for the same string in multiple files.
+        size_t FindLineContaining(const ttlib::searcher& search, size_t startline = 0) const;
+
         /// If a line is found that contains orgStr, it will be replaced by newStr and the
         /// line position is returned. If no line is found, tt::npos is returned.
         size_t ReplaceInLine(std::string_view orgStr, std::string_view newStr, size_t startline = 0,
                              tt::CASE checkcase = tt::CASE::exact);
 
-        bool is_sameas(ttlib::textfile other, tt::CASE checkcase = tt::CASE::exact) const;
-        bool is_sameas(ttlib::viewfile other, tt::CASE checkcase = tt::CASE::exact) const;
+        bool is_sameas(const ttlib::textfile& other, tt::CASE checkcase = tt::CASE::exact) const;
+        bool is_sameas(const ttlib::viewfile& other, tt::CASE checkcase = tt::CASE::exact) const;
 
         /// Use addEmptyLine() if you need to modify the line after adding it to the end.
         ///
@@ -156,8 +187,21 @@ namespace ttlib
     class viewfile : public std::vector<ttlib::sview>
     {
     public:
-        /// Reads a line-oriented file and converts each line into a std::string.
-        bool ReadFile(std::string_view filename);
+        /// Reads a line-oriented file and creates a view of each line.
+        ///
+        /// The file is converted to UTF8 and invalid_utf8 is used the same way as
+        /// textfile::ReadFile().
+        ///
+        /// A UTF8 file is memory-mapped whenever possible, and the lines point directly into
+        /// the mapped file instead of a copy of it. The file is unmapped when the viewfile is
+        /// destroyed or reused (or GetBuffer() is called), so the file must not be truncated
+        /// while it is being viewed.
+        bool ReadFile(std::string_view filename, size_t* invalid_utf8 = nullptr);
+
+        /// Same as above, but if the file hasn't changed since it was added to cache, the lines
+        /// are created from the cached line index instead of searching for line endings. If the
+        /// file has changed, it is added to the cache. See ttfilecache.h.
+        bool ReadFile(std::string_view filename, ttlib::filecache& cache);
 
         /// This will be the filename passed to ReadFile()
         ttlib::cstr& filename() { return m_filename; }
@@ -168,12 +212,19 @@ namespace ttlib
         /// Reads a string as if it was a file (see ReadFile).
         void ReadString(std::string_view str);
 
-        /// Writes each line to the file adding a '\n' to the end of the line.
-        bool WriteFile(const std::string& filename) const;
+        /// Writes each line to the file adding a '\n' to the end of the line. The lines are written
+        /// to a temporary file which then replaces filename, so filename is unchanged if writing
+        /// fails. If sync is true, the file is flushed to the disk before returning.
+        bool WriteFile(const std::string& filename, bool sync = false) const;
 
         /// Returns the string storing the entire file. If you change this string, all
         /// the string_view vector entries will be invalid!
-        ttlib::cstr& GetBuffer() { return m_buffer; }
+        ///
+        /// If the file is memory-mapped, it is copied into the buffer first.
+        ttlib::cstr& GetBuffer();
+
+        /// Returns true if the lines point into a memory-mapped file.
+        bool is_mapped() const { return m_map != nullptr; }
 
         /// Call this if you change the buffer returned by GetBuffer() to turn the buffer
         /// into an array of string_views.
@@ -184,15 +235,317 @@ namespace ttlib
         /// startline is the zero-based offset to the line to start searching.
         size_t FindLineContaining(std::string_view str, size_t startline = 0, tt::CASE checkcase = tt::CASE::exact) const;
 
-        bool is_sameas(ttlib::textfile other, tt::CASE checkcase = tt::CASE::exact) const;
-        bool is_sameas(ttlib::viewfile other, tt::CASE checkcase = tt::CASE::exact) const;
+        /// Same as above, but uses a search string that has already been compiled. Use this when
+        /// searching for the same string in multiple files.
+        size_t FindLineContaining(const ttlib::searcher& search, size_t startline = 0) const;
+
+        bool is_sameas(const ttlib::textfile& other, tt::CASE checkcase = tt::CASE::exact) const;
+        bool is_sameas(const ttlib::viewfile& other, tt::CASE checkcase = tt::CASE::exact) const;
 
     protected:
         // Converts lines into a vector of std::string_view members. Lines can end with \n, \r, or \r\n.
         void ParseLines(std::string_view str);
 
+        // Maps or reads the file without parsing it
+        bool LoadFile(std::string_view filename, size_t* invalid_utf8);
+
     private:
         ttlib::cstr m_buffer;
         ttlib::cstr m_filename;
+
+        // Shared so that a copy of the viewfile keeps the file mapped
+        std::shared_ptr<ttlib::mapfile> m_map;
+        std::string_view m_mapped_text;  // the mapped file without its byte order mark
+    };
+}  // namespace ttlib
+
+////////////////////////////// ttlib::linereader class ///////////////////////////////
+
+namespace ttlib
+{
+    /// Reads a line-oriented file one line at a time, so that files larger than the
+    /// available memory can be processed:
+    ///
+    ///      ttlib::linereader reader;
+    ///      if (reader.open("your filename"))
+    ///      {
+    ///          ttlib::sview line;
+    ///          while (reader.getline(line))
+    ///              ... // process the line
+    ///      }
+    ///
+    /// The file is read in fixed-size blocks. The part of a line that crosses the end of a
+    /// block is moved to the start of the window before the next block is read after it, so
+    /// memory use depends only on the block size and the longest line, not on the size of
+    /// the file.
+    ///
+    /// Encodings, byte order marks and line endings are handled the same way as
+    /// textfile::ReadFile(), except that a last line without a line ending is also returned.
+    class linereader
+    {
+    public:
+        linereader(size_t block_size = 256 * 1024) : m_block_size(block_size ? block_size : 1) {}
+
+        /// Opens the file and determines its encoding. Returns false if the file can't be
+        /// opened.
+        bool open(std::string_view filename);
+
+        void close();
+
+        bool is_open() const { return m_file.is_open(); }
+
+        /// Sets line to the next line in the file, not including the line ending. Returns false
+        /// if there are no more lines.
+        ///
+        /// Caution: line is only valid until the next call to getline() or close().
+        bool getline(ttlib::sview& line);
+
+        /// Returns the one-based number of the last line returned by getline().
+        size_t line_number() const { return m_line_number; }
+
+        tt::ENCODING encoding() const { return m_decoder.encoding(); }
+
+        /// This will be the filename passed to open()
+        ttlib::cstr& filename() { return m_filename; }
+
+    protected:
+        // Moves the unread text to the start of the window and appends the next block. Returns
+        // false at the end of the file.
+        bool fill();
+
+    private:
+        std::ifstream m_file;
+        ttlib::cstr m_filename;
+
+        std::string m_window;  // text that has been read and decoded
+        std::string m_block;   // undecoded block for files that aren't UTF8
+        text_decoder m_decoder;
+
+        size_t m_block_size;
+        size_t m_pos { 0 };  // offset in m_window of the next line
+        size_t m_line_number { 0 };
+        bool m_eof { true };
+    };
+}  // namespace ttlib
+
+////////////////////////////// ttlib::compactfile class ///////////////////////////////
+
+namespace ttlib
+{
+    /// Provides the same methods as ttlib::textfile, but all of the lines are stored in a
+    /// single buffer instead of a separate ttlib::cstr for each line. Each line only needs 8
+    /// bytes in addition to its text, and reading a file doesn't allocate memory for every
+    /// line. Use this for large files that only need a few lines changed.
+    ///
+    /// Indexing or iterating returns a ttlib::sview of the line. To change a line, call
+    /// edit(), which moves the line into a separate ttlib::cstr that can be modified like a
+    /// textfile line:
+    ///
+    ///      ttlib::compactfile file;
+    ///      file.ReadFile("your filename");
+    ///      for (size_t pos = 0; pos < file.size(); ++pos)
+    ///      {
+    ///          if (file[pos].is_sameprefix("#include"))
+    ///              file.edit(pos).Replace("<", "\"");
+    ///      }
+    ///
+    /// Since iterators return a temporary sview, use "for (auto line: file)" rather than
+    /// "for (auto& line: file)".
+    ///
+    /// The lines that have not been edited can't exceed 4GB in total.
+    class compactfile
+    {
+    public:
+        class const_iterator
+        {
+        public:
+            // Lines are returned by value, so operator->() returns a proxy that holds the line
+            struct arrow_proxy
+            {
+                ttlib::sview line;
+                const ttlib::sview* operator->() const { return &line; }
+            };
+
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = ttlib::sview;
+            using difference_type = std::ptrdiff_t;
+            using pointer = arrow_proxy;
+            using reference = ttlib::sview;
+
+            const_iterator() = default;
+            const_iterator(const compactfile* file, size_t pos) : m_file(file), m_pos(pos) {}
+
+            ttlib::sview operator*() const { return (*m_file)[m_pos]; }
+            arrow_proxy operator->() const { return arrow_proxy { (*m_file)[m_pos] }; }
+            ttlib::sview operator[](difference_type count) const { return (*m_file)[m_pos + count]; }
+
+            const_iterator& operator++()
+            {
+                ++m_pos;
+                return *this;
+            }
+            const_iterator operator++(int)
+            {
+                auto prev = *this;
+                ++m_pos;
+                return prev;
+            }
+            const_iterator& operator--()
+            {
+                --m_pos;
+                return *this;
+            }
+            const_iterator operator--(int)
+            {
+                auto prev = *this;
+                --m_pos;
+                return prev;
+            }
+
+            const_iterator& operator+=(difference_type count)
+            {
+                m_pos += count;
+                return *this;
+            }
+            const_iterator& operator-=(difference_type count)
+            {
+                m_pos -= count;
+                return *this;
+            }
+            const_iterator operator+(difference_type count) const { return const_iterator(m_file, m_pos + count); }
+            const_iterator operator-(difference_type count) const { return const_iterator(m_file, m_pos - count); }
+            friend const_iterator operator+(difference_type count, const const_iterator& iter) { return iter + count; }
+            difference_type operator-(const const_iterator& other) const
+            {
+                return static_cast<difference_type>(m_pos) - static_cast<difference_type>(other.m_pos);
+            }
+
+            bool operator==(const const_iterator& other) const { return m_pos == other.m_pos; }
+            bool operator!=(const const_iterator& other) const { return m_pos != other.m_pos; }
+            bool operator<(const const_iterator& other) const { return m_pos < other.m_pos; }
+            bool operator>(const const_iterator& other) const { return m_pos > other.m_pos; }
+            bool operator<=(const const_iterator& other) const { return m_pos <= other.m_pos; }
+            bool operator>=(const const_iterator& other) const { return m_pos >= other.m_pos; }
+
+        private:
+            const compactfile* m_file { nullptr };
+            size_t m_pos { 0 };
+        };
+
+        /// Reads a line-oriented file. Encodings and invalid_utf8 are handled the same way
+        /// as textfile::ReadFile().
+        bool ReadFile(std::string_view filename, size_t* invalid_utf8 = nullptr);
+
+        /// This will be the filename passed to ReadFile()
+        ttlib::cstr& filename() { return m_filename; }
+
+        /// Call this if ReadFile() was not used and you need to store a filename.
+        void set_filename(std::string_view filename) { m_filename = filename; }
+
+        /// Reads a string as if it was a file (see ReadFile).
+        void ReadString(std::string_view str);
+
+        /// Writes each line to the file adding a '\n' to the end of the line. The lines are written
+        /// to a temporary file which then replaces filename, so filename is unchanged if writing
+        /// fails. If sync is true, the file is flushed to the disk before returning.
+        bool WriteFile(const std::string& filename, bool sync = false) const;
+
+        /// Writes to the same file that was previously read
+        bool WriteFile() const { return !m_filename.empty() ? WriteFile(m_filename) : false; }
+
+        size_t size() const noexcept { return m_lines.size(); }
+        bool empty() const noexcept { return m_lines.empty(); }
+        void clear();
+
+        ttlib::sview operator[](size_t pos) const
+        {
+            auto& line = m_lines[pos];
+            if (line.length == overflow_line)
+                return m_overflow[line.offset];
+            return ttlib::sview(m_arena.data() + line.offset, line.length);
+        }
+
+        /// Throws std::out_of_range if pos is not a valid line, the same as textfile::at().
+        ttlib::sview at(size_t pos) const
+        {
+            (void) m_lines.at(pos);
+            return (*this)[pos];
+        }
+
+        ttlib::sview back() const { return (*this)[size() - 1]; }
+
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, size()); }
+
+        /// Returns a modifiable copy of the line. The reference remains valid until the line
+        /// is removed or the file is cleared or read again.
+        ttlib::cstr& edit(size_t pos);
+
+        /// Replaces the contents of a line.
+        void set(size_t pos, std::string_view str) { edit(pos).assign(str); }
+
+        /// Searches every line to see if it contains the sub-string.
+        ///
+        /// startline is the zero-based offset to the line to start searching.
+        size_t FindLineContaining(std::string_view str, size_t startline = 0, tt::CASE checkcase = tt::CASE::exact) const;
+
+        /// Same as above, but uses a search string that has already been compiled. Use this when
+        /// searching for the same string in multiple files.
+        size_t FindLineContaining(const ttlib::searcher& search, size_t startline = 0) const;
+
+        /// If a line is found that contains orgStr, it will be replaced by newStr and the
+        /// line position is returned. If no line is found, tt::npos is returned.
+        size_t ReplaceInLine(std::string_view orgStr, std::string_view newStr, size_t startline = 0,
+                             tt::CASE checkcase = tt::CASE::exact);
+
+        bool is_sameas(const ttlib::compactfile& other, tt::CASE checkcase = tt::CASE::exact) const;
+        bool is_sameas(const ttlib::textfile& other, tt::CASE checkcase = tt::CASE::exact) const;
+        bool is_sameas(const ttlib::viewfile& other, tt::CASE checkcase = tt::CASE::exact) const;
+
+        /// Adds a line to the end of the file.
+        void emplace_back(std::string_view str);
+        void push_back(std::string_view str) { emplace_back(str); }
+
+        cstr& addEmptyLine() { return insertEmptyLine(size()); }
+        cstr& insertEmptyLine(size_t pos);
+        cstr& insertLine(size_t pos, std::string_view str);
+
+        void RemoveLine(size_t line);
+
+        void RemoveLastLine()
+        {
+            if (size())
+                RemoveLine(size() - 1);
+        }
+
+        template <typename T>
+        void operator+=(T str)
+        {
+            emplace_back(str);
+        }
+
+    protected:
+        // Adds the lines in m_arena, starting at start. Lines can end with \n, \r, or \r\n.
+        void ParseArena(size_t start);
+
+    private:
+        // length is set to this if the line has been moved to m_overflow, in which case offset
+        // is its position in m_overflow.
+        static constexpr uint32_t overflow_line = static_cast<uint32_t>(-1);
+
+        struct line_span
+        {
+            uint32_t offset;
+            uint32_t length;
+        };
+
+        std::string m_arena;  // text of every line that hasn't been edited
+        std::vector<line_span> m_lines;
+
+        // Lines that have been edited or added. A deque is used so that references returned by
+        // edit() remain valid when more lines are added.
+        std::deque<ttlib::cstr> m_overflow;
+
+        ttlib::cstr m_filename;
     };
 }  // namespace ttlib
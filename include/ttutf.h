@@ -0,0 +1,162 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttutf.h
+// Purpose:   Unicode conversion, validation and decoding
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#if !(__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+    #error "The contents of <ttutf.h> are available only with C++17 or later."
+#endif
+
+/// @file
+/// ttlib::utf8to16() and ttlib::utf16to8() (declared in ttlibspace.h) compute the exact size of the
+/// converted string before converting it, so the destination is only resized once. Runs of ASCII
+/// characters are converted 16 at a time.
+///
+/// Wide strings are UTF-16 on platforms where wchar_t is 2 bytes (Windows), and UTF-32 where wchar_t
+/// is 4 bytes. A surrogate pair in a UTF-32 string is still accepted as a single character.
+///
+/// Invalid input never stops a conversion -- each invalid sequence is replaced with U+FFFD (the
+/// Unicode replacement character) and the conversion function returns false. Overlong encodings,
+/// encoded surrogates, values above U+10FFFF and unpaired surrogates are all considered invalid.
+///
+/// ttlib::find_invalid_utf8() checks 32 bytes at a time using the lookup-table algorithm from
+/// simdjson (John Keiser and Daniel Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte")
+/// when AVX2 is available.
+///
+/// ttlib::utf8_count(), ttlib::utf8_offset() and ttlib::utf8_offset_back() count the bytes that start
+/// a character (any byte other than 10xxxxxx) 16 or 32 bytes at a time. For valid UTF8 that is the
+/// number of characters -- invalid input is counted the same way, it is never an error. For repeated
+/// lookups in the same long string, ttlib::utf8_index records the offset of every Nth character so
+/// that each lookup only has to count the characters after the closest recorded offset.
+///
+/// ttlib::text_decoder converts text in any of the tt::ENCODING formats to UTF8 one block at a time,
+/// so that a file can be decoded as it is read instead of after the entire file has been loaded.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tt
+{
+    enum class ENCODING : uint8_t
+    {
+        utf8,
+        utf16le,
+        utf16be,
+        utf32le,
+        utf32be,
+        windows_1252,  // Latin-1 with the printable characters that Windows places in 0x80-0x9F
+    };
+}
+
+namespace ttlib
+{
+    /// Returns the offset of the first invalid sequence in str, or tt::npos if str is valid UTF8.
+    size_t find_invalid_utf8(std::string_view str) noexcept;
+
+    /// Returns true if str is valid UTF8.
+    inline bool is_valid_utf8(std::string_view str) noexcept
+    {
+        return find_invalid_utf8(str) == static_cast<size_t>(-1);
+    }
+
+    /// Returns the number of wchar_t values needed to hold str after conversion from UTF-8.
+    size_t utf16_size(std::string_view str) noexcept;
+
+    /// Returns the number of bytes needed to hold str after conversion to UTF-8.
+    size_t utf8_size(std::wstring_view str) noexcept;
+
+    /// Returns the number of UTF8 characters in str.
+    size_t utf8_count(std::string_view str) noexcept;
+
+    /// Returns the byte offset of the character at index, str.size() if index is the number of
+    /// characters in str, or tt::npos if str has fewer characters.
+    size_t utf8_offset(std::string_view str, size_t index) noexcept;
+
+    /// Returns the byte offset of the character that is count characters before the end of str, or
+    /// tt::npos if str has fewer characters.
+    size_t utf8_offset_back(std::string_view str, size_t count) noexcept;
+
+    /// Maps character indexes to byte offsets (and back) in a string that is searched repeatedly.
+    /// The offset of every interval characters is recorded when the index is built, so each lookup
+    /// counts at most interval characters.
+    ///
+    /// Caution: as with a string_view, the index is only valid as long as the string it was built
+    /// from has not been modified or destroyed.
+    class utf8_index
+    {
+    public:
+        utf8_index() = default;
+        utf8_index(std::string_view str, size_t interval = 256) { build(str, interval); }
+
+        void build(std::string_view str, size_t interval = 256);
+
+        /// Number of characters in the string
+        size_t size() const noexcept { return m_count; }
+
+        /// Returns the byte offset of the character at index, or tt::npos if index is greater than
+        /// size().
+        size_t offset(size_t index) const noexcept;
+
+        /// Returns the number of characters that start before the byte offset -- i.e., the column
+        /// of the character at that offset.
+        size_t index(size_t offset) const noexcept;
+
+    private:
+        std::string_view m_str;
+        std::vector<size_t> m_offsets;  // byte offset of every m_interval characters
+        size_t m_interval { 256 };
+        size_t m_count { 0 };
+    };
+
+    /// Determines the encoding of a file from its first block. If the block starts with a byte order
+    /// mark, bom_size is set to its length. Otherwise bom_size is set to zero and the encoding is
+    /// guessed from the pattern of zero bytes (UTF-16 and UTF-32) or by whether the block is valid
+    /// UTF8 (if it isn't, it's assumed to be Windows-1252). Only the first 4096 bytes are examined,
+    /// and if there are at least that many, a character split by the end of them is not an error.
+    tt::ENCODING detect_encoding(std::string_view start, size_t& bom_size) noexcept;
+
+    /// Converts text to UTF8 one block at a time. A character that is split between two blocks is
+    /// completed when the next block is decoded.
+    ///
+    /// UTF8 input is copied without being validated (see find_invalid_utf8()). Invalid input in any
+    /// other encoding is converted to U+FFFD.
+    class text_decoder
+    {
+    public:
+        text_decoder(tt::ENCODING encoding = tt::ENCODING::utf8) noexcept : m_encoding(encoding) {}
+
+        tt::ENCODING encoding() const noexcept { return m_encoding; }
+
+        /// Appends the converted block to dest. Returns false if the block (or any previous block)
+        /// contained invalid input.
+        bool decode(std::string_view block, std::string& dest);
+
+        /// Call this after the last block to convert any incomplete character at the end of the
+        /// input (which is always invalid).
+        bool finish(std::string& dest);
+
+    protected:
+        // Converts as many complete characters as possible. Returns the number of bytes written to
+        // dest, and sets consumed to the number of bytes converted.
+        size_t convert(const unsigned char* src, size_t size, char* dest, size_t& consumed, bool final) noexcept;
+
+        // Maximum number of bytes that convert() can write for size bytes of input
+        size_t max_output(size_t size) const noexcept;
+
+    private:
+        // An incomplete code unit or surrogate pair from the end of the previous block
+        unsigned char m_pending[8];
+        size_t m_pending_size { 0 };
+
+        tt::ENCODING m_encoding;
+        bool m_valid { true };
+    };
+}  // namespace ttlib
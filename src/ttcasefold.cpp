@@ -0,0 +1,1111 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttcasefold.cpp
+// Purpose:   Locale-free Unicode case mapping for UTF8 strings
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+// tt::CASE::utf8 comparisons used to construct std::locale("en_US.utf8") on every call and then
+// convert one byte at a time -- which throws if the locale isn't installed, and is wrong for any
+// character that takes more than one byte. The functions in this file use the simple (one code
+// point to one code point) case mappings from the Unicode Character Database instead.
+//
+// The mapping tables are stored as runs of code points that share the same delta. A stride of 2
+// is used for the many blocks where upper and lower case letters alternate (Latin Extended-A,
+// Cyrillic, etc.). The tables were generated from the Unicode 14.0 CaseFolding.txt (status C and
+// S) and UnicodeData.txt simple lowercase/uppercase mappings -- each run must be sorted and must
+// not overlap any other run.
+
+#include <algorithm>
+
+#include "ttcharset.h"   // Precompiled set of characters for delimiter scanning
+#include "tthash.h"      // Seeded 64-bit string hash and incremental hasher
+#include "ttlibspace.h"  // ttlib namespace functions and declarations
+#include "ttsimd.h"      // Internal SIMD helpers and search kernels
+
+using namespace ttlib;
+
+namespace
+{
+    struct CASE_RANGE
+    {
+        char32_t first;
+        uint16_t count;
+        uint8_t stride;
+        int32_t delta;
+    };
+
+    constexpr CASE_RANGE fold_ranges[] = {
+        { 0x0041, 26, 1, 32 },
+        { 0x00B5, 1, 1, 775 },
+        { 0x00C0, 23, 1, 32 },
+        { 0x00D8, 7, 1, 32 },
+        { 0x0100, 24, 2, 1 },
+        { 0x0132, 3, 2, 1 },
+        { 0x0139, 8, 2, 1 },
+        { 0x014A, 23, 2, 1 },
+        { 0x0178, 1, 1, -121 },
+        { 0x0179, 3, 2, 1 },
+        { 0x017F, 1, 1, -268 },
+        { 0x0181, 1, 1, 210 },
+        { 0x0182, 2, 2, 1 },
+        { 0x0186, 1, 1, 206 },
+        { 0x0187, 1, 1, 1 },
+        { 0x0189, 2, 1, 205 },
+        { 0x018B, 1, 1, 1 },
+        { 0x018E, 1, 1, 79 },
+        { 0x018F, 1, 1, 202 },
+        { 0x0190, 1, 1, 203 },
+        { 0x0191, 1, 1, 1 },
+        { 0x0193, 1, 1, 205 },
+        { 0x0194, 1, 1, 207 },
+        { 0x0196, 1, 1, 211 },
+        { 0x0197, 1, 1, 209 },
+        { 0x0198, 1, 1, 1 },
+        { 0x019C, 1, 1, 211 },
+        { 0x019D, 1, 1, 213 },
+        { 0x019F, 1, 1, 214 },
+        { 0x01A0, 3, 2, 1 },
+        { 0x01A6, 1, 1, 218 },
+        { 0x01A7, 1, 1, 1 },
+        { 0x01A9, 1, 1, 218 },
+        { 0x01AC, 1, 1, 1 },
+        { 0x01AE, 1, 1, 218 },
+        { 0x01AF, 1, 1, 1 },
+        { 0x01B1, 2, 1, 217 },
+        { 0x01B3, 2, 2, 1 },
+        { 0x01B7, 1, 1, 219 },
+        { 0x01B8, 1, 1, 1 },
+        { 0x01BC, 1, 1, 1 },
+        { 0x01C4, 1, 1, 2 },
+        { 0x01C5, 1, 1, 1 },
+        { 0x01C7, 1, 1, 2 },
+        { 0x01C8, 1, 1, 1 },
+        { 0x01CA, 1, 1, 2 },
+        { 0x01CB, 9, 2, 1 },
+        { 0x01DE, 9, 2, 1 },
+        { 0x01F1, 1, 1, 2 },
+        { 0x01F2, 2, 2, 1 },
+        { 0x01F6, 1, 1, -97 },
+        { 0x01F7, 1, 1, -56 },
+        { 0x01F8, 20, 2, 1 },
+        { 0x0220, 1, 1, -130 },
+        { 0x0222, 9, 2, 1 },
+        { 0x023A, 1, 1, 10795 },
+        { 0x023B, 1, 1, 1 },
+        { 0x023D, 1, 1, -163 },
+        { 0x023E, 1, 1, 10792 },
+        { 0x0241, 1, 1, 1 },
+        { 0x0243, 1, 1, -195 },
+        { 0x0244, 1, 1, 69 },
+        { 0x0245, 1, 1, 71 },
+        { 0x0246, 5, 2, 1 },
+        { 0x0345, 1, 1, 116 },
+        { 0x0370, 2, 2, 1 },
+        { 0x0376, 1, 1, 1 },
+        { 0x037F, 1, 1, 116 },
+        { 0x0386, 1, 1, 38 },
+        { 0x0388, 3, 1, 37 },
+        { 0x038C, 1, 1, 64 },
+        { 0x038E, 2, 1, 63 },
+        { 0x0391, 17, 1, 32 },
+        { 0x03A3, 9, 1, 32 },
+        { 0x03C2, 1, 1, 1 },
+        { 0x03CF, 1, 1, 8 },
+        { 0x03D0, 1, 1, -30 },
+        { 0x03D1, 1, 1, -25 },
+        { 0x03D5, 1, 1, -15 },
+        { 0x03D6, 1, 1, -22 },
+        { 0x03D8, 12, 2, 1 },
+        { 0x03F0, 1, 1, -54 },
+        { 0x03F1, 1, 1, -48 },
+        { 0x03F4, 1, 1, -60 },
+        { 0x03F5, 1, 1, -64 },
+        { 0x03F7, 1, 1, 1 },
+        { 0x03F9, 1, 1, -7 },
+        { 0x03FA, 1, 1, 1 },
+        { 0x03FD, 3, 1, -130 },
+        { 0x0400, 16, 1, 80 },
+        { 0x0410, 32, 1, 32 },
+        { 0x0460, 17, 2, 1 },
+        { 0x048A, 27, 2, 1 },
+        { 0x04C0, 1, 1, 15 },
+        { 0x04C1, 7, 2, 1 },
+        { 0x04D0, 48, 2, 1 },
+        { 0x0531, 38, 1, 48 },
+        { 0x10A0, 38, 1, 7264 },
+        { 0x10C7, 1, 1, 7264 },
+        { 0x10CD, 1, 1, 7264 },
+        { 0x13F8, 6, 1, -8 },
+        { 0x1C80, 1, 1, -6222 },
+        { 0x1C81, 1, 1, -6221 },
+        { 0x1C82, 1, 1, -6212 },
+        { 0x1C83, 2, 1, -6210 },
+        { 0x1C85, 1, 1, -6211 },
+        { 0x1C86, 1, 1, -6204 },
+        { 0x1C87, 1, 1, -6180 },
+        { 0x1C88, 1, 1, 35267 },
+        { 0x1C90, 43, 1, -3008 },
+        { 0x1CBD, 3, 1, -3008 },
+        { 0x1E00, 75, 2, 1 },
+        { 0x1E9B, 1, 1, -58 },
+        { 0x1E9E, 1, 1, -7615 },
+        { 0x1EA0, 48, 2, 1 },
+        { 0x1F08, 8, 1, -8 },
+        { 0x1F18, 6, 1, -8 },
+        { 0x1F28, 8, 1, -8 },
+        { 0x1F38, 8, 1, -8 },
+        { 0x1F48, 6, 1, -8 },
+        { 0x1F59, 4, 2, -8 },
+        { 0x1F68, 8, 1, -8 },
+        { 0x1F88, 8, 1, -8 },
+        { 0x1F98, 8, 1, -8 },
+        { 0x1FA8, 8, 1, -8 },
+        { 0x1FB8, 2, 1, -8 },
+        { 0x1FBA, 2, 1, -74 },
+        { 0x1FBC, 1, 1, -9 },
+        { 0x1FBE, 1, 1, -7173 },
+        { 0x1FC8, 4, 1, -86 },
+        { 0x1FCC, 1, 1, -9 },
+        { 0x1FD8, 2, 1, -8 },
+        { 0x1FDA, 2, 1, -100 },
+        { 0x1FE8, 2, 1, -8 },
+        { 0x1FEA, 2, 1, -112 },
+        { 0x1FEC, 1, 1, -7 },
+        { 0x1FF8, 2, 1, -128 },
+        { 0x1FFA, 2, 1, -126 },
+        { 0x1FFC, 1, 1, -9 },
+        { 0x2126, 1, 1, -7517 },
+        { 0x212A, 1, 1, -8383 },
+        { 0x212B, 1, 1, -8262 },
+        { 0x2132, 1, 1, 28 },
+        { 0x2160, 16, 1, 16 },
+        { 0x2183, 1, 1, 1 },
+        { 0x24B6, 26, 1, 26 },
+        { 0x2C00, 48, 1, 48 },
+        { 0x2C60, 1, 1, 1 },
+        { 0x2C62, 1, 1, -10743 },
+        { 0x2C63, 1, 1, -3814 },
+        { 0x2C64, 1, 1, -10727 },
+        { 0x2C67, 3, 2, 1 },
+        { 0x2C6D, 1, 1, -10780 },
+        { 0x2C6E, 1, 1, -10749 },
+        { 0x2C6F, 1, 1, -10783 },
+        { 0x2C70, 1, 1, -10782 },
+        { 0x2C72, 1, 1, 1 },
+        { 0x2C75, 1, 1, 1 },
+        { 0x2C7E, 2, 1, -10815 },
+        { 0x2C80, 50, 2, 1 },
+        { 0x2CEB, 2, 2, 1 },
+        { 0x2CF2, 1, 1, 1 },
+        { 0xA640, 23, 2, 1 },
+        { 0xA680, 14, 2, 1 },
+        { 0xA722, 7, 2, 1 },
+        { 0xA732, 31, 2, 1 },
+        { 0xA779, 2, 2, 1 },
+        { 0xA77D, 1, 1, -35332 },
+        { 0xA77E, 5, 2, 1 },
+        { 0xA78B, 1, 1, 1 },
+        { 0xA78D, 1, 1, -42280 },
+        { 0xA790, 2, 2, 1 },
+        { 0xA796, 10, 2, 1 },
+        { 0xA7AA, 1, 1, -42308 },
+        { 0xA7AB, 1, 1, -42319 },
+        { 0xA7AC, 1, 1, -42315 },
+        { 0xA7AD, 1, 1, -42305 },
+        { 0xA7AE, 1, 1, -42308 },
+        { 0xA7B0, 1, 1, -42258 },
+        { 0xA7B1, 1, 1, -42282 },
+        { 0xA7B2, 1, 1, -42261 },
+        { 0xA7B3, 1, 1, 928 },
+        { 0xA7B4, 8, 2, 1 },
+        { 0xA7C4, 1, 1, -48 },
+        { 0xA7C5, 1, 1, -42307 },
+        { 0xA7C6, 1, 1, -35384 },
+        { 0xA7C7, 2, 2, 1 },
+        { 0xA7D0, 1, 1, 1 },
+        { 0xA7D6, 2, 2, 1 },
+        { 0xA7F5, 1, 1, 1 },
+        { 0xAB70, 80, 1, -38864 },
+        { 0xFF21, 26, 1, 32 },
+        { 0x10400, 40, 1, 40 },
+        { 0x104B0, 36, 1, 40 },
+        { 0x10570, 11, 1, 39 },
+        { 0x1057C, 15, 1, 39 },
+        { 0x1058C, 7, 1, 39 },
+        { 0x10594, 2, 1, 39 },
+        { 0x10C80, 51, 1, 64 },
+        { 0x118A0, 32, 1, 32 },
+        { 0x16E40, 32, 1, 32 },
+        { 0x1E900, 34, 1, 34 },
+    };
+
+    constexpr CASE_RANGE lower_ranges[] = {
+        { 0x0041, 26, 1, 32 },
+        { 0x00C0, 23, 1, 32 },
+        { 0x00D8, 7, 1, 32 },
+        { 0x0100, 24, 2, 1 },
+        { 0x0130, 1, 1, -199 },
+        { 0x0132, 3, 2, 1 },
+        { 0x0139, 8, 2, 1 },
+        { 0x014A, 23, 2, 1 },
+        { 0x0178, 1, 1, -121 },
+        { 0x0179, 3, 2, 1 },
+        { 0x0181, 1, 1, 210 },
+        { 0x0182, 2, 2, 1 },
+        { 0x0186, 1, 1, 206 },
+        { 0x0187, 1, 1, 1 },
+        { 0x0189, 2, 1, 205 },
+        { 0x018B, 1, 1, 1 },
+        { 0x018E, 1, 1, 79 },
+        { 0x018F, 1, 1, 202 },
+        { 0x0190, 1, 1, 203 },
+        { 0x0191, 1, 1, 1 },
+        { 0x0193, 1, 1, 205 },
+        { 0x0194, 1, 1, 207 },
+        { 0x0196, 1, 1, 211 },
+        { 0x0197, 1, 1, 209 },
+        { 0x0198, 1, 1, 1 },
+        { 0x019C, 1, 1, 211 },
+        { 0x019D, 1, 1, 213 },
+        { 0x019F, 1, 1, 214 },
+        { 0x01A0, 3, 2, 1 },
+        { 0x01A6, 1, 1, 218 },
+        { 0x01A7, 1, 1, 1 },
+        { 0x01A9, 1, 1, 218 },
+        { 0x01AC, 1, 1, 1 },
+        { 0x01AE, 1, 1, 218 },
+        { 0x01AF, 1, 1, 1 },
+        { 0x01B1, 2, 1, 217 },
+        { 0x01B3, 2, 2, 1 },
+        { 0x01B7, 1, 1, 219 },
+        { 0x01B8, 1, 1, 1 },
+        { 0x01BC, 1, 1, 1 },
+        { 0x01C4, 1, 1, 2 },
+        { 0x01C5, 1, 1, 1 },
+        { 0x01C7, 1, 1, 2 },
+        { 0x01C8, 1, 1, 1 },
+        { 0x01CA, 1, 1, 2 },
+        { 0x01CB, 9, 2, 1 },
+        { 0x01DE, 9, 2, 1 },
+        { 0x01F1, 1, 1, 2 },
+        { 0x01F2, 2, 2, 1 },
+        { 0x01F6, 1, 1, -97 },
+        { 0x01F7, 1, 1, -56 },
+        { 0x01F8, 20, 2, 1 },
+        { 0x0220, 1, 1, -130 },
+        { 0x0222, 9, 2, 1 },
+        { 0x023A, 1, 1, 10795 },
+        { 0x023B, 1, 1, 1 },
+        { 0x023D, 1, 1, -163 },
+        { 0x023E, 1, 1, 10792 },
+        { 0x0241, 1, 1, 1 },
+        { 0x0243, 1, 1, -195 },
+        { 0x0244, 1, 1, 69 },
+        { 0x0245, 1, 1, 71 },
+        { 0x0246, 5, 2, 1 },
+        { 0x0370, 2, 2, 1 },
+        { 0x0376, 1, 1, 1 },
+        { 0x037F, 1, 1, 116 },
+        { 0x0386, 1, 1, 38 },
+        { 0x0388, 3, 1, 37 },
+        { 0x038C, 1, 1, 64 },
+        { 0x038E, 2, 1, 63 },
+        { 0x0391, 17, 1, 32 },
+        { 0x03A3, 9, 1, 32 },
+        { 0x03CF, 1, 1, 8 },
+        { 0x03D8, 12, 2, 1 },
+        { 0x03F4, 1, 1, -60 },
+        { 0x03F7, 1, 1, 1 },
+        { 0x03F9, 1, 1, -7 },
+        { 0x03FA, 1, 1, 1 },
+        { 0x03FD, 3, 1, -130 },
+        { 0x0400, 16, 1, 80 },
+        { 0x0410, 32, 1, 32 },
+        { 0x0460, 17, 2, 1 },
+        { 0x048A, 27, 2, 1 },
+        { 0x04C0, 1, 1, 15 },
+        { 0x04C1, 7, 2, 1 },
+        { 0x04D0, 48, 2, 1 },
+        { 0x0531, 38, 1, 48 },
+        { 0x10A0, 38, 1, 7264 },
+        { 0x10C7, 1, 1, 7264 },
+        { 0x10CD, 1, 1, 7264 },
+        { 0x13A0, 80, 1, 38864 },
+        { 0x13F0, 6, 1, 8 },
+        { 0x1C90, 43, 1, -3008 },
+        { 0x1CBD, 3, 1, -3008 },
+        { 0x1E00, 75, 2, 1 },
+        { 0x1E9E, 1, 1, -7615 },
+        { 0x1EA0, 48, 2, 1 },
+        { 0x1F08, 8, 1, -8 },
+        { 0x1F18, 6, 1, -8 },
+        { 0x1F28, 8, 1, -8 },
+        { 0x1F38, 8, 1, -8 },
+        { 0x1F48, 6, 1, -8 },
+        { 0x1F59, 4, 2, -8 },
+        { 0x1F68, 8, 1, -8 },
+        { 0x1F88, 8, 1, -8 },
+        { 0x1F98, 8, 1, -8 },
+        { 0x1FA8, 8, 1, -8 },
+        { 0x1FB8, 2, 1, -8 },
+        { 0x1FBA, 2, 1, -74 },
+        { 0x1FBC, 1, 1, -9 },
+        { 0x1FC8, 4, 1, -86 },
+        { 0x1FCC, 1, 1, -9 },
+        { 0x1FD8, 2, 1, -8 },
+        { 0x1FDA, 2, 1, -100 },
+        { 0x1FE8, 2, 1, -8 },
+        { 0x1FEA, 2, 1, -112 },
+        { 0x1FEC, 1, 1, -7 },
+        { 0x1FF8, 2, 1, -128 },
+        { 0x1FFA, 2, 1, -126 },
+        { 0x1FFC, 1, 1, -9 },
+        { 0x2126, 1, 1, -7517 },
+        { 0x212A, 1, 1, -8383 },
+        { 0x212B, 1, 1, -8262 },
+        { 0x2132, 1, 1, 28 },
+        { 0x2160, 16, 1, 16 },
+        { 0x2183, 1, 1, 1 },
+        { 0x24B6, 26, 1, 26 },
+        { 0x2C00, 48, 1, 48 },
+        { 0x2C60, 1, 1, 1 },
+        { 0x2C62, 1, 1, -10743 },
+        { 0x2C63, 1, 1, -3814 },
+        { 0x2C64, 1, 1, -10727 },
+        { 0x2C67, 3, 2, 1 },
+        { 0x2C6D, 1, 1, -10780 },
+        { 0x2C6E, 1, 1, -10749 },
+        { 0x2C6F, 1, 1, -10783 },
+        { 0x2C70, 1, 1, -10782 },
+        { 0x2C72, 1, 1, 1 },
+        { 0x2C75, 1, 1, 1 },
+        { 0x2C7E, 2, 1, -10815 },
+        { 0x2C80, 50, 2, 1 },
+        { 0x2CEB, 2, 2, 1 },
+        { 0x2CF2, 1, 1, 1 },
+        { 0xA640, 23, 2, 1 },
+        { 0xA680, 14, 2, 1 },
+        { 0xA722, 7, 2, 1 },
+        { 0xA732, 31, 2, 1 },
+        { 0xA779, 2, 2, 1 },
+        { 0xA77D, 1, 1, -35332 },
+        { 0xA77E, 5, 2, 1 },
+        { 0xA78B, 1, 1, 1 },
+        { 0xA78D, 1, 1, -42280 },
+        { 0xA790, 2, 2, 1 },
+        { 0xA796, 10, 2, 1 },
+        { 0xA7AA, 1, 1, -42308 },
+        { 0xA7AB, 1, 1, -42319 },
+        { 0xA7AC, 1, 1, -42315 },
+        { 0xA7AD, 1, 1, -42305 },
+        { 0xA7AE, 1, 1, -42308 },
+        { 0xA7B0, 1, 1, -42258 },
+        { 0xA7B1, 1, 1, -42282 },
+        { 0xA7B2, 1, 1, -42261 },
+        { 0xA7B3, 1, 1, 928 },
+        { 0xA7B4, 8, 2, 1 },
+        { 0xA7C4, 1, 1, -48 },
+        { 0xA7C5, 1, 1, -42307 },
+        { 0xA7C6, 1, 1, -35384 },
+        { 0xA7C7, 2, 2, 1 },
+        { 0xA7D0, 1, 1, 1 },
+        { 0xA7D6, 2, 2, 1 },
+        { 0xA7F5, 1, 1, 1 },
+        { 0xFF21, 26, 1, 32 },
+        { 0x10400, 40, 1, 40 },
+        { 0x104B0, 36, 1, 40 },
+        { 0x10570, 11, 1, 39 },
+        { 0x1057C, 15, 1, 39 },
+        { 0x1058C, 7, 1, 39 },
+        { 0x10594, 2, 1, 39 },
+        { 0x10C80, 51, 1, 64 },
+        { 0x118A0, 32, 1, 32 },
+        { 0x16E40, 32, 1, 32 },
+        { 0x1E900, 34, 1, 34 },
+    };
+
+    constexpr CASE_RANGE upper_ranges[] = {
+        { 0x0061, 26, 1, -32 },
+        { 0x00B5, 1, 1, 743 },
+        { 0x00E0, 23, 1, -32 },
+        { 0x00F8, 7, 1, -32 },
+        { 0x00FF, 1, 1, 121 },
+        { 0x0101, 24, 2, -1 },
+        { 0x0131, 1, 1, -232 },
+        { 0x0133, 3, 2, -1 },
+        { 0x013A, 8, 2, -1 },
+        { 0x014B, 23, 2, -1 },
+        { 0x017A, 3, 2, -1 },
+        { 0x017F, 1, 1, -300 },
+        { 0x0180, 1, 1, 195 },
+        { 0x0183, 2, 2, -1 },
+        { 0x0188, 1, 1, -1 },
+        { 0x018C, 1, 1, -1 },
+        { 0x0192, 1, 1, -1 },
+        { 0x0195, 1, 1, 97 },
+        { 0x0199, 1, 1, -1 },
+        { 0x019A, 1, 1, 163 },
+        { 0x019E, 1, 1, 130 },
+        { 0x01A1, 3, 2, -1 },
+        { 0x01A8, 1, 1, -1 },
+        { 0x01AD, 1, 1, -1 },
+        { 0x01B0, 1, 1, -1 },
+        { 0x01B4, 2, 2, -1 },
+        { 0x01B9, 1, 1, -1 },
+        { 0x01BD, 1, 1, -1 },
+        { 0x01BF, 1, 1, 56 },
+        { 0x01C5, 1, 1, -1 },
+        { 0x01C6, 1, 1, -2 },
+        { 0x01C8, 1, 1, -1 },
+        { 0x01C9, 1, 1, -2 },
+        { 0x01CB, 1, 1, -1 },
+        { 0x01CC, 1, 1, -2 },
+        { 0x01CE, 8, 2, -1 },
+        { 0x01DD, 1, 1, -79 },
+        { 0x01DF, 9, 2, -1 },
+        { 0x01F2, 1, 1, -1 },
+        { 0x01F3, 1, 1, -2 },
+        { 0x01F5, 1, 1, -1 },
+        { 0x01F9, 20, 2, -1 },
+        { 0x0223, 9, 2, -1 },
+        { 0x023C, 1, 1, -1 },
+        { 0x023F, 2, 1, 10815 },
+        { 0x0242, 1, 1, -1 },
+        { 0x0247, 5, 2, -1 },
+        { 0x0250, 1, 1, 10783 },
+        { 0x0251, 1, 1, 10780 },
+        { 0x0252, 1, 1, 10782 },
+        { 0x0253, 1, 1, -210 },
+        { 0x0254, 1, 1, -206 },
+        { 0x0256, 2, 1, -205 },
+        { 0x0259, 1, 1, -202 },
+        { 0x025B, 1, 1, -203 },
+        { 0x025C, 1, 1, 42319 },
+        { 0x0260, 1, 1, -205 },
+        { 0x0261, 1, 1, 42315 },
+        { 0x0263, 1, 1, -207 },
+        { 0x0265, 1, 1, 42280 },
+        { 0x0266, 1, 1, 42308 },
+        { 0x0268, 1, 1, -209 },
+        { 0x0269, 1, 1, -211 },
+        { 0x026A, 1, 1, 42308 },
+        { 0x026B, 1, 1, 10743 },
+        { 0x026C, 1, 1, 42305 },
+        { 0x026F, 1, 1, -211 },
+        { 0x0271, 1, 1, 10749 },
+        { 0x0272, 1, 1, -213 },
+        { 0x0275, 1, 1, -214 },
+        { 0x027D, 1, 1, 10727 },
+        { 0x0280, 1, 1, -218 },
+        { 0x0282, 1, 1, 42307 },
+        { 0x0283, 1, 1, -218 },
+        { 0x0287, 1, 1, 42282 },
+        { 0x0288, 1, 1, -218 },
+        { 0x0289, 1, 1, -69 },
+        { 0x028A, 2, 1, -217 },
+        { 0x028C, 1, 1, -71 },
+        { 0x0292, 1, 1, -219 },
+        { 0x029D, 1, 1, 42261 },
+        { 0x029E, 1, 1, 42258 },
+        { 0x0345, 1, 1, 84 },
+        { 0x0371, 2, 2, -1 },
+        { 0x0377, 1, 1, -1 },
+        { 0x037B, 3, 1, 130 },
+        { 0x03AC, 1, 1, -38 },
+        { 0x03AD, 3, 1, -37 },
+        { 0x03B1, 17, 1, -32 },
+        { 0x03C2, 1, 1, -31 },
+        { 0x03C3, 9, 1, -32 },
+        { 0x03CC, 1, 1, -64 },
+        { 0x03CD, 2, 1, -63 },
+        { 0x03D0, 1, 1, -62 },
+        { 0x03D1, 1, 1, -57 },
+        { 0x03D5, 1, 1, -47 },
+        { 0x03D6, 1, 1, -54 },
+        { 0x03D7, 1, 1, -8 },
+        { 0x03D9, 12, 2, -1 },
+        { 0x03F0, 1, 1, -86 },
+        { 0x03F1, 1, 1, -80 },
+        { 0x03F2, 1, 1, 7 },
+        { 0x03F3, 1, 1, -116 },
+        { 0x03F5, 1, 1, -96 },
+        { 0x03F8, 1, 1, -1 },
+        { 0x03FB, 1, 1, -1 },
+        { 0x0430, 32, 1, -32 },
+        { 0x0450, 16, 1, -80 },
+        { 0x0461, 17, 2, -1 },
+        { 0x048B, 27, 2, -1 },
+        { 0x04C2, 7, 2, -1 },
+        { 0x04CF, 1, 1, -15 },
+        { 0x04D1, 48, 2, -1 },
+        { 0x0561, 38, 1, -48 },
+        { 0x10D0, 43, 1, 3008 },
+        { 0x10FD, 3, 1, 3008 },
+        { 0x13F8, 6, 1, -8 },
+        { 0x1C80, 1, 1, -6254 },
+        { 0x1C81, 1, 1, -6253 },
+        { 0x1C82, 1, 1, -6244 },
+        { 0x1C83, 2, 1, -6242 },
+        { 0x1C85, 1, 1, -6243 },
+        { 0x1C86, 1, 1, -6236 },
+        { 0x1C87, 1, 1, -6181 },
+        { 0x1C88, 1, 1, 35266 },
+        { 0x1D79, 1, 1, 35332 },
+        { 0x1D7D, 1, 1, 3814 },
+        { 0x1D8E, 1, 1, 35384 },
+        { 0x1E01, 75, 2, -1 },
+        { 0x1E9B, 1, 1, -59 },
+        { 0x1EA1, 48, 2, -1 },
+        { 0x1F00, 8, 1, 8 },
+        { 0x1F10, 6, 1, 8 },
+        { 0x1F20, 8, 1, 8 },
+        { 0x1F30, 8, 1, 8 },
+        { 0x1F40, 6, 1, 8 },
+        { 0x1F51, 4, 2, 8 },
+        { 0x1F60, 8, 1, 8 },
+        { 0x1F70, 2, 1, 74 },
+        { 0x1F72, 4, 1, 86 },
+        { 0x1F76, 2, 1, 100 },
+        { 0x1F78, 2, 1, 128 },
+        { 0x1F7A, 2, 1, 112 },
+        { 0x1F7C, 2, 1, 126 },
+        { 0x1F80, 8, 1, 8 },
+        { 0x1F90, 8, 1, 8 },
+        { 0x1FA0, 8, 1, 8 },
+        { 0x1FB0, 2, 1, 8 },
+        { 0x1FB3, 1, 1, 9 },
+        { 0x1FBE, 1, 1, -7205 },
+        { 0x1FC3, 1, 1, 9 },
+        { 0x1FD0, 2, 1, 8 },
+        { 0x1FE0, 2, 1, 8 },
+        { 0x1FE5, 1, 1, 7 },
+        { 0x1FF3, 1, 1, 9 },
+        { 0x214E, 1, 1, -28 },
+        { 0x2170, 16, 1, -16 },
+        { 0x2184, 1, 1, -1 },
+        { 0x24D0, 26, 1, -26 },
+        { 0x2C30, 48, 1, -48 },
+        { 0x2C61, 1, 1, -1 },
+        { 0x2C65, 1, 1, -10795 },
+        { 0x2C66, 1, 1, -10792 },
+        { 0x2C68, 3, 2, -1 },
+        { 0x2C73, 1, 1, -1 },
+        { 0x2C76, 1, 1, -1 },
+        { 0x2C81, 50, 2, -1 },
+        { 0x2CEC, 2, 2, -1 },
+        { 0x2CF3, 1, 1, -1 },
+        { 0x2D00, 38, 1, -7264 },
+        { 0x2D27, 1, 1, -7264 },
+        { 0x2D2D, 1, 1, -7264 },
+        { 0xA641, 23, 2, -1 },
+        { 0xA681, 14, 2, -1 },
+        { 0xA723, 7, 2, -1 },
+        { 0xA733, 31, 2, -1 },
+        { 0xA77A, 2, 2, -1 },
+        { 0xA77F, 5, 2, -1 },
+        { 0xA78C, 1, 1, -1 },
+        { 0xA791, 2, 2, -1 },
+        { 0xA794, 1, 1, 48 },
+        { 0xA797, 10, 2, -1 },
+        { 0xA7B5, 8, 2, -1 },
+        { 0xA7C8, 2, 2, -1 },
+        { 0xA7D1, 1, 1, -1 },
+        { 0xA7D7, 2, 2, -1 },
+        { 0xA7F6, 1, 1, -1 },
+        { 0xAB53, 1, 1, -928 },
+        { 0xAB70, 80, 1, -38864 },
+        { 0xFF41, 26, 1, -32 },
+        { 0x10428, 40, 1, -40 },
+        { 0x104D8, 36, 1, -40 },
+        { 0x10597, 11, 1, -39 },
+        { 0x105A3, 15, 1, -39 },
+        { 0x105B3, 7, 1, -39 },
+        { 0x105BB, 2, 1, -39 },
+        { 0x10CC0, 51, 1, -64 },
+        { 0x118C0, 32, 1, -32 },
+        { 0x16E60, 32, 1, -32 },
+        { 0x1E922, 34, 1, -34 },
+    };
+
+    template <size_t N>
+    char32_t map_case(const CASE_RANGE (&ranges)[N], char32_t ch) noexcept
+    {
+        if (ch < ranges[0].first)
+            return ch;
+
+        // Find the last run that starts at or before ch
+        auto iter = std::upper_bound(std::begin(ranges), std::end(ranges), ch,
+                                     [](char32_t value, const CASE_RANGE& range) { return value < range.first; });
+        --iter;
+        auto offset = ch - iter->first;
+        if (offset < static_cast<char32_t>(iter->count) * iter->stride && offset % iter->stride == 0)
+            return static_cast<char32_t>(static_cast<int32_t>(ch) + iter->delta);
+        return ch;
+    }
+
+    // Bytes that are not part of a valid UTF8 sequence are returned as this value plus the byte
+    // so that they only ever compare equal to the identical byte.
+    constexpr char32_t invalid_utf8 = 0x110000;
+
+    // Decodes the code point starting at pos and advances pos past it.
+    char32_t next_codepoint(std::string_view str, size_t& pos) noexcept
+    {
+        auto lead = static_cast<unsigned char>(str[pos]);
+        if (lead < 0x80)
+        {
+            ++pos;
+            return lead;
+        }
+
+        size_t len;
+        char32_t codepoint;
+        if ((lead & 0xE0) == 0xC0)
+        {
+            len = 2;
+            codepoint = lead & 0x1F;
+        }
+        else if ((lead & 0xF0) == 0xE0)
+        {
+            len = 3;
+            codepoint = lead & 0x0F;
+        }
+        else if ((lead & 0xF8) == 0xF0)
+        {
+            len = 4;
+            codepoint = lead & 0x07;
+        }
+        else
+        {
+            ++pos;
+            return invalid_utf8 + lead;
+        }
+
+        if (len > str.size() - pos)
+        {
+            ++pos;
+            return invalid_utf8 + lead;
+        }
+        for (size_t idx = 1; idx < len; ++idx)
+        {
+            auto next = static_cast<unsigned char>(str[pos + idx]);
+            if ((next & 0xC0) != 0x80)
+            {
+                ++pos;
+                return invalid_utf8 + lead;
+            }
+            codepoint = (codepoint << 6) | (next & 0x3F);
+        }
+        pos += len;
+        return codepoint;
+    }
+
+    size_t encoded_size(char32_t codepoint) noexcept
+    {
+        return codepoint < 0x80 ? 1 : codepoint < 0x800 ? 2 : codepoint < 0x10000 ? 3 : 4;
+    }
+
+    void encode(char32_t codepoint, char* dest) noexcept
+    {
+        switch (encoded_size(codepoint))
+        {
+            case 1:
+                dest[0] = static_cast<char>(codepoint);
+                break;
+
+            case 2:
+                dest[0] = static_cast<char>(0xC0 | (codepoint >> 6));
+                dest[1] = static_cast<char>(0x80 | (codepoint & 0x3F));
+                break;
+
+            case 3:
+                dest[0] = static_cast<char>(0xE0 | (codepoint >> 12));
+                dest[1] = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+                dest[2] = static_cast<char>(0x80 | (codepoint & 0x3F));
+                break;
+
+            default:
+                dest[0] = static_cast<char>(0xF0 | (codepoint >> 18));
+                dest[1] = static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+                dest[2] = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+                dest[3] = static_cast<char>(0x80 | (codepoint & 0x3F));
+                break;
+        }
+    }
+
+    bool is_ascii(std::string_view str) noexcept
+    {
+        for (auto ch: str)
+        {
+            if (static_cast<unsigned char>(ch) >= 0x80)
+                return false;
+        }
+        return true;
+    }
+
+    // Returns the number of bytes in main that matched prefix, or npos if main does not start with prefix.
+    size_t match_prefix(std::string_view main, std::string_view prefix) noexcept
+    {
+        size_t pos_main = 0;
+        size_t pos_prefix = 0;
+        while (pos_prefix < prefix.size())
+        {
+            if (pos_main >= main.size())
+                return tt::npos;
+
+            auto ch_main = static_cast<unsigned char>(main[pos_main]);
+            auto ch_prefix = static_cast<unsigned char>(prefix[pos_prefix]);
+            if ((ch_main | ch_prefix) < 0x80)
+            {
+                if (fold_ascii(ch_main) != fold_ascii(ch_prefix))
+                    return tt::npos;
+                ++pos_main;
+                ++pos_prefix;
+            }
+            else if (fold_case(next_codepoint(main, pos_main)) != fold_case(next_codepoint(prefix, pos_prefix)))
+            {
+                return tt::npos;
+            }
+        }
+        return pos_main;
+    }
+
+    // Adds the last UTF8 byte of every code point that folds to folded (including folded itself)
+    void add_fold_sources(ttlib::charset& set, char32_t folded)
+    {
+        char buffer[4];
+        encode(folded, buffer);
+        set.add(buffer[encoded_size(folded) - 1]);
+        for (auto& range: fold_ranges)
+        {
+            auto source = static_cast<char32_t>(static_cast<int32_t>(folded) - range.delta);
+            auto offset = source - range.first;
+            if (source >= range.first && offset < static_cast<char32_t>(range.count) * range.stride &&
+                offset % range.stride == 0)
+            {
+                encode(source, buffer);
+                set.add(buffer[encoded_size(source) - 1]);
+            }
+        }
+    }
+
+    // Knuth-Morris-Pratt search for the folded code points in needle. Each code point in main is
+    // decoded and folded at most once, so the time is linear no matter how many partial matches
+    // there are. fail needs room for count values, and so does offsets (a ring buffer holding the
+    // byte offset of each of the last count code points in main).
+    //
+    // If skip isn't nullptr, it contains the last byte of every character that can match needle[0].
+    // Whenever nothing has been matched, it is used to jump to the next place where a match could start.
+    size_t find_folded(std::string_view main, size_t start, const char32_t* needle, size_t count, size_t* fail,
+                       size_t* offsets, const ttlib::charset* skip) noexcept
+    {
+        // fail[idx] is the length of the longest proper prefix of needle[0..idx] that is also a
+        // suffix of it
+        fail[0] = 0;
+        for (size_t idx = 1, length = 0; idx < count; ++idx)
+        {
+            while (length && needle[idx] != needle[length])
+                length = fail[length - 1];
+            if (needle[idx] == needle[length])
+                ++length;
+            fail[idx] = length;
+        }
+
+        size_t matched = 0;
+        for (size_t pos = start, index = 0; pos < main.size(); ++index)
+        {
+            if (!matched && skip)
+            {
+                // A code point that can match ends with a byte in skip, and starts with the
+                // nearest byte before it that isn't a continuation byte. Every byte that isn't a
+                // continuation byte starts a code point, so this never splits a character
+                // differently than decoding one code point at a time from pos would.
+                for (auto search = pos;;)
+                {
+                    auto found = skip->find_oneof(main, search);
+                    if (found == tt::npos)
+                        return tt::npos;
+                    auto lead = found;
+                    while (lead > pos && found - lead < 3 && (static_cast<unsigned char>(main[lead]) & 0xC0) == 0x80)
+                        --lead;
+                    if (lead == pos || (static_cast<unsigned char>(main[lead]) & 0xC0) != 0x80)
+                    {
+                        pos = lead;
+                        break;
+                    }
+                    search = found + 1;
+                }
+            }
+
+            offsets[index % count] = pos;
+            auto ch = static_cast<unsigned char>(main[pos]);
+            char32_t folded;
+            if (ch < 0x80)
+            {
+                folded = fold_ascii(ch);
+                ++pos;
+            }
+            else
+            {
+                folded = fold_case(next_codepoint(main, pos));
+            }
+
+            while (matched && folded != needle[matched])
+                matched = fail[matched - 1];
+            if (folded == needle[matched] && ++matched == count)
+                return offsets[(index + 1) % count];  // the offset of code point index - count + 1
+        }
+        return tt::npos;
+    }
+
+    // Rabin-Karp hashes are calculated modulo the Mersenne prime 2^61 - 1
+    constexpr uint64_t hash_prime = (static_cast<uint64_t>(1) << 61) - 1;
+    constexpr uint64_t hash_base = 0x1F3D5B79A2C4E6ull % hash_prime;
+
+    // Returns (a * b) % hash_prime without a 128-bit multiply (a and b must be less than hash_prime)
+    uint64_t mul_mod(uint64_t a, uint64_t b) noexcept
+    {
+        uint64_t a_lo = a & 0xFFFFFFFF, a_hi = a >> 32;
+        uint64_t b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+        uint64_t low = a_lo * b_lo;
+        uint64_t mid = a_lo * b_hi + a_hi * b_lo;
+        uint64_t high = a_hi * b_hi;
+
+        // 2^61 is 1 and 2^64 is 8 modulo hash_prime
+        uint64_t result = (low & hash_prime) + (low >> 61) + (high << 3) + (mid >> 29) + ((mid & 0x1FFFFFFF) << 32);
+        result = (result & hash_prime) + (result >> 61);
+        return (result >= hash_prime) ? result - hash_prime : result;
+    }
+
+    // Decodes and folds the code point at pos, and advances pos past it
+    char32_t next_folded(std::string_view str, size_t& pos) noexcept
+    {
+        auto ch = static_cast<unsigned char>(str[pos]);
+        if (ch < 0x80)
+        {
+            ++pos;
+            return fold_ascii(ch);
+        }
+        return fold_case(next_codepoint(str, pos));
+    }
+
+    // Rabin-Karp search used for a needle with too many code points to store. The hash of the last
+    // count code points of main is updated by decoding main twice -- once where each code point
+    // enters the window and once where it leaves -- so nothing needs to be stored, and the time is
+    // linear except for comparing the needle wherever the hashes are the same.
+    size_t find_long(std::string_view main, size_t start, std::string_view sub) noexcept
+    {
+        uint64_t needle_hash = 0;
+        uint64_t high_power = 1;  // hash_base ^ (count - 1)
+        size_t count = 0;
+        for (size_t pos = 0; pos < sub.size(); ++count)
+        {
+            if (count)
+                high_power = mul_mod(high_power, hash_base);
+            needle_hash = (mul_mod(needle_hash, hash_base) + next_folded(sub, pos) + 1) % hash_prime;
+        }
+
+        uint64_t window_hash = 0;
+        size_t pos = start;
+        for (size_t idx = 0; idx < count; ++idx)
+        {
+            if (pos >= main.size())
+                return tt::npos;
+            window_hash = (mul_mod(window_hash, hash_base) + next_folded(main, pos) + 1) % hash_prime;
+        }
+
+        for (size_t trail = start;;)
+        {
+            if (window_hash == needle_hash && match_prefix(main.substr(trail), sub) != tt::npos)
+                return trail;
+            if (pos >= main.size())
+                return tt::npos;
+            auto leaving = mul_mod(next_folded(main, trail) + 1, high_power);
+            window_hash = (window_hash + hash_prime - leaving) % hash_prime;
+            window_hash = (mul_mod(window_hash, hash_base) + next_folded(main, pos) + 1) % hash_prime;
+        }
+    }
+
+    using CASE_MAPPER = char32_t (*)(char32_t) noexcept;
+
+    void convert_case(std::string& str, CASE_MAPPER mapper, unsigned char first_ascii)
+    {
+        for (size_t pos = 0; pos < str.size();)
+        {
+            auto ch = static_cast<unsigned char>(str[pos]);
+            if (ch < 0x80)
+            {
+                if (static_cast<unsigned char>(ch - first_ascii) < 26)
+                    str[pos] = static_cast<char>(ch ^ 0x20);
+                ++pos;
+                continue;
+            }
+
+            auto start = pos;
+            auto codepoint = next_codepoint(str, pos);
+            if (codepoint >= invalid_utf8)
+                continue;
+            auto mapped = mapper(codepoint);
+            if (mapped == codepoint)
+                continue;
+            if (encoded_size(mapped) == pos - start)
+            {
+                encode(mapped, str.data() + start);
+                continue;
+            }
+
+            // A few characters (e.g. U+0130 and U+212A) change size when their case changes. These are rare
+            // enough that the rest of the string is simply rebuilt.
+            std::string result(str, 0, start);
+            result.reserve(str.size() + 8);
+            char buffer[4];
+            encode(mapped, buffer);
+            result.append(buffer, encoded_size(mapped));
+            while (pos < str.size())
+            {
+                start = pos;
+                codepoint = next_codepoint(str, pos);
+                mapped = (codepoint >= invalid_utf8) ? codepoint : mapper(codepoint);
+                if (mapped == codepoint)
+                {
+                    result.append(str, start, pos - start);
+                }
+                else
+                {
+                    encode(mapped, buffer);
+                    result.append(buffer, encoded_size(mapped));
+                }
+            }
+            str.swap(result);
+            return;
+        }
+    }
+}  // anonymous namespace
+
+char32_t ttlib::fold_case(char32_t ch) noexcept
+{
+    if (ch < 0x80)
+        return fold_ascii(static_cast<unsigned char>(ch));
+    return map_case(fold_ranges, ch);
+}
+
+char32_t ttlib::to_lower(char32_t ch) noexcept
+{
+    if (ch < 0x80)
+        return fold_ascii(static_cast<unsigned char>(ch));
+    return map_case(lower_ranges, ch);
+}
+
+char32_t ttlib::to_upper(char32_t ch) noexcept
+{
+    if (ch < 0x80)
+        return (static_cast<unsigned char>(ch - 'a') < 26) ? ch - 0x20 : ch;
+    return map_case(upper_ranges, ch);
+}
+
+bool ttlib::is_sameas_utf8(std::string_view str1, std::string_view str2) noexcept
+{
+    return match_prefix(str1, str2) == str1.size();
+}
+
+bool ttlib::is_sameprefix_utf8(std::string_view strMain, std::string_view strSub) noexcept
+{
+    return match_prefix(strMain, strSub) != tt::npos;
+}
+
+uint64_t ttlib::get_hash64_utf8(std::string_view str, uint64_t seed) noexcept
+{
+    // The folded text is re-encoded as UTF8 in a stack buffer and hashed one piece at a time. A byte
+    // that isn't part of a valid sequence is written as 0xFF followed by the byte -- 0xFF never
+    // appears in UTF8, so two different folded strings never produce the same bytes.
+    char folded[256];
+    size_t count = 0;
+    hasher hash(seed);
+    for (size_t pos = 0; pos < str.size();)
+    {
+        if (count > sizeof(folded) - 4)
+        {
+            hash.update(folded, count);
+            count = 0;
+        }
+
+        auto ch = static_cast<unsigned char>(str[pos]);
+        if (ch < 0x80)
+        {
+            folded[count++] = static_cast<char>(fold_ascii(ch));
+            ++pos;
+            continue;
+        }
+
+        auto codepoint = fold_case(next_codepoint(str, pos));
+        if (codepoint >= invalid_utf8)
+        {
+            folded[count++] = static_cast<char>(0xFF);
+            folded[count++] = static_cast<char>(codepoint - invalid_utf8);
+            continue;
+        }
+        encode(codepoint, folded + count);
+        count += encoded_size(codepoint);
+    }
+    hash.update(folded, count);
+    return hash.digest();
+}
+
+size_t ttlib::find_utf8(std::string_view main, std::string_view sub, size_t start) noexcept
+{
+    if (sub.empty() || start >= main.size())
+        return tt::npos;
+
+    // The only non-ASCII characters that fold to an ASCII character are U+017F (long s) and U+212A
+    // (Kelvin sign). Unless the needle could match one of those, an ASCII needle can only match
+    // ASCII text, so the SIMD ASCII search gives the same result.
+    if (is_ascii(sub))
+    {
+        bool has_ks = false;
+        for (auto ch: sub)
+        {
+            auto folded = fold_ascii(static_cast<unsigned char>(ch));
+            if (folded == 'k' || folded == 's')
+            {
+                has_ks = true;
+                break;
+            }
+        }
+        if (!has_ks || is_ascii(main.substr(start)))
+            return ttlib::find_nocase(main, sub, start);
+    }
+
+    // Nothing is allocated. The folded needle and its KMP tables are kept on the stack, and a needle
+    // with more code points than that is searched for by hashing instead.
+    constexpr size_t max_folded = 64;
+    char32_t needle[max_folded];
+    size_t fail[max_folded];
+    size_t offsets[max_folded];
+
+    size_t count = 0;
+    for (size_t pos = 0; pos < sub.size();)
+    {
+        if (count == max_folded)
+            return find_long(main, start, sub);
+        needle[count++] = fold_case(next_codepoint(sub, pos));
+    }
+
+    // A byte that isn't valid UTF8 only matches the identical byte when decoding doesn't make it
+    // part of a longer character, so a needle that starts with one can't skip ahead.
+    ttlib::charset skip;
+    if (needle[0] >= invalid_utf8)
+        return find_folded(main, start, needle, count, fail, offsets, nullptr);
+    add_fold_sources(skip, needle[0]);
+    return find_folded(main, start, needle, count, fail, offsets, &skip);
+}
+
+void ttlib::MakeLower(std::string& str)
+{
+    convert_case(str, ttlib::to_lower, 'A');
+}
+
+void ttlib::MakeUpper(std::string& str)
+{
+    convert_case(str, ttlib::to_upper, 'a');
+}
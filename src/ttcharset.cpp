@@ -0,0 +1,232 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttcharset.cpp
+// Purpose:   Precompiled set of characters for delimiter scanning
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+// The AVX2 matcher splits every character into its low and high 4 bits. The low 4 bits select a byte
+// from one of two 16-byte tables (one for characters below 0x80, one for the rest), and the high 4 bits
+// select which bit of that byte to test. Both lookups are done with a byte shuffle, so any set of
+// characters can be checked 32 characters at a time.
+//
+// SSE2 has no byte shuffle, so it is only used when the set has a few characters that can be compared
+// directly. Everything else uses the 256-bit bitmap.
+
+#include <algorithm>
+
+#include "ttcharset.h"  // Precompiled set of characters for delimiter scanning
+#include "ttsimd.h"     // Internal SIMD helpers and search kernels
+
+using namespace ttlib;
+
+namespace
+{
+#if defined(TTLIB_SIMD_X86)
+
+    // Returns 0xFF for every character that matches one of the count characters in small
+    inline __m128i match_small_sse2(__m128i chars, const char* small, size_t count) noexcept
+    {
+        auto result = _mm_cmpeq_epi8(chars, _mm_set1_epi8(small[0]));
+        for (size_t idx = 1; idx < count; ++idx)
+            result = _mm_or_si128(result, _mm_cmpeq_epi8(chars, _mm_set1_epi8(small[idx])));
+        return result;
+    }
+
+    size_t scan_small_sse2(const unsigned char* str, size_t len, size_t pos, const char* small, size_t count,
+                           bool want) noexcept
+    {
+        const uint32_t flip = want ? 0 : 0xFFFF;
+        for (; pos + 16 <= len; pos += 16)
+        {
+            auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + pos));
+            auto mask = static_cast<uint32_t>(_mm_movemask_epi8(match_small_sse2(block, small, count))) ^ flip;
+            if (mask)
+                return pos + ctz32(mask);
+        }
+        return pos;
+    }
+
+    // end is one past the last character to check. Returns one past the offset of the match, or
+    // the offset where fewer than 16 characters remain.
+    size_t rscan_small_sse2(const unsigned char* str, size_t end, const char* small, size_t count, bool want) noexcept
+    {
+        const uint32_t flip = want ? 0 : 0xFFFF;
+        for (; end >= 16; end -= 16)
+        {
+            auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + end - 16));
+            auto mask = static_cast<uint32_t>(_mm_movemask_epi8(match_small_sse2(block, small, count))) ^ flip;
+            if (mask)
+                return end - 16 + high_bit32(mask) + 1;
+        }
+        return end;
+    }
+
+    struct NIBBLE_TABLES
+    {
+        __m256i low;
+        __m256i high;
+        __m256i bits;
+    };
+
+    TT_TARGET_AVX2 inline NIBBLE_TABLES load_tables(const uint8_t* nibble_low, const uint8_t* nibble_high) noexcept
+    {
+        NIBBLE_TABLES tables;
+        tables.low = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(nibble_low)));
+        tables.high = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(nibble_high)));
+        // Bit to test for each value of the high 4 bits
+        tables.bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32,
+                                       64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+        return tables;
+    }
+
+    // Returns 0xFF for every character that is in the set
+    TT_TARGET_AVX2 inline __m256i match_avx2(__m256i chars, const NIBBLE_TABLES& tables) noexcept
+    {
+        auto low = _mm256_and_si256(chars, _mm256_set1_epi8(0x0F));
+        auto high = _mm256_and_si256(_mm256_srli_epi16(chars, 4), _mm256_set1_epi8(0x0F));
+        // blendv picks the second table for characters that have their top bit set
+        auto row = _mm256_blendv_epi8(_mm256_shuffle_epi8(tables.low, low), _mm256_shuffle_epi8(tables.high, low), chars);
+        auto bit = _mm256_shuffle_epi8(tables.bits, high);
+        return _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit);
+    }
+
+    TT_TARGET_AVX2 size_t scan_avx2(const unsigned char* str, size_t len, size_t pos, const uint8_t* nibble_low,
+                                    const uint8_t* nibble_high, bool want) noexcept
+    {
+        auto tables = load_tables(nibble_low, nibble_high);
+        const uint32_t flip = want ? 0 : 0xFFFFFFFF;
+        for (; pos + 32 <= len; pos += 32)
+        {
+            auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + pos));
+            auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(match_avx2(block, tables))) ^ flip;
+            if (mask)
+            {
+                _mm256_zeroupper();
+                return pos + ctz32(mask);
+            }
+        }
+        _mm256_zeroupper();
+        return pos;
+    }
+
+    TT_TARGET_AVX2 size_t rscan_avx2(const unsigned char* str, size_t end, const uint8_t* nibble_low,
+                                     const uint8_t* nibble_high, bool want) noexcept
+    {
+        auto tables = load_tables(nibble_low, nibble_high);
+        const uint32_t flip = want ? 0 : 0xFFFFFFFF;
+        for (; end >= 32; end -= 32)
+        {
+            auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + end - 32));
+            auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(match_avx2(block, tables))) ^ flip;
+            if (mask)
+            {
+                _mm256_zeroupper();
+                return end - 32 + high_bit32(mask) + 1;
+            }
+        }
+        _mm256_zeroupper();
+        return end;
+    }
+
+#endif  // TTLIB_SIMD_X86
+}  // anonymous namespace
+
+void charset::assign(std::string_view chars)
+{
+    std::fill(std::begin(m_bits), std::end(m_bits), 0);
+    std::fill(std::begin(m_nibble_low), std::end(m_nibble_low), static_cast<uint8_t>(0));
+    std::fill(std::begin(m_nibble_high), std::end(m_nibble_high), static_cast<uint8_t>(0));
+    m_count = 0;
+
+    for (auto ch: chars)
+        add(ch);
+}
+
+void charset::add(char ch)
+{
+    if (contains(ch))
+        return;
+
+    auto uch = static_cast<unsigned char>(ch);
+    m_bits[uch >> 6] |= (static_cast<uint64_t>(1) << (uch & 63));
+    if (uch < 0x80)
+        m_nibble_low[uch & 0x0F] |= static_cast<uint8_t>(1 << (uch >> 4));
+    else
+        m_nibble_high[uch & 0x0F] |= static_cast<uint8_t>(1 << ((uch >> 4) - 8));
+
+    if (m_count < max_small)
+        m_small[m_count] = ch;
+    ++m_count;
+}
+
+size_t charset::scan(std::string_view str, size_t start, bool want) const noexcept
+{
+    if (start >= str.size())
+        return tt::npos;
+
+    size_t pos = start;
+#if defined(TTLIB_SIMD_X86)
+    auto chars = reinterpret_cast<const unsigned char*>(str.data());
+    if (str.size() - pos >= 32 && has_avx2())
+        pos = scan_avx2(chars, str.size(), pos, m_nibble_low, m_nibble_high, want);
+    else if (m_count && m_count <= max_small && str.size() - pos >= 16)
+        pos = scan_small_sse2(chars, str.size(), pos, m_small, m_count, want);
+#endif
+
+    // Finish whatever is left over (if the vector code found a match, this stops immediately)
+    for (; pos < str.size(); ++pos)
+    {
+        if (contains(str[pos]) == want)
+            return pos;
+    }
+    return tt::npos;
+}
+
+size_t charset::rscan(std::string_view str, size_t start, bool want) const noexcept
+{
+    if (str.empty())
+        return tt::npos;
+
+    // end is one past the last character to check
+    size_t end = (start < str.size()) ? start + 1 : str.size();
+#if defined(TTLIB_SIMD_X86)
+    auto chars = reinterpret_cast<const unsigned char*>(str.data());
+    if (end >= 32 && has_avx2())
+        end = rscan_avx2(chars, end, m_nibble_low, m_nibble_high, want);
+    else if (m_count && m_count <= max_small && end >= 16)
+        end = rscan_small_sse2(chars, end, m_small, m_count, want);
+#endif
+
+    for (; end > 0; --end)
+    {
+        if (contains(str[end - 1]) == want)
+            return end - 1;
+    }
+    return tt::npos;
+}
+
+size_t charset::find_oneof(std::string_view str, size_t start) const noexcept
+{
+    if (empty())
+        return tt::npos;
+    return scan(str, start, true);
+}
+
+size_t charset::find_noneof(std::string_view str, size_t start) const noexcept
+{
+    return scan(str, start, false);
+}
+
+size_t charset::rfind_oneof(std::string_view str, size_t start) const noexcept
+{
+    if (empty())
+        return tt::npos;
+    return rscan(str, start, true);
+}
+
+size_t charset::rfind_noneof(std::string_view str, size_t start) const noexcept
+{
+    return rscan(str, start, false);
+}
@@ -8,16 +8,12 @@
 
 #include <cassert>
 #include <cctype>
-#include <cstdarg>
 #include <cstdlib>
 #include <cstring>
 #include <filesystem>
-#include <iomanip>
-#include <ios>
-#include <locale>
-#include <sstream>
 
 #include "ttlibspace.h"
+#include "ttcharset.h"  // Precompiled set of characters for delimiter scanning
 
 #include "ttcstr.h"
 
@@ -28,75 +24,17 @@ using namespace tt;
 
 bool cstr::is_sameas(std::string_view str, CASE checkcase) const
 {
-    if (size() != str.size())
-        return false;
-
-    if (empty())
-        return str.empty();
-
-    // if both strings have the same length and are non-empty, then we can compare as a prefix.
-    return is_sameprefix(str, checkcase);
+    return ttlib::is_sameas(*this, str, checkcase);
 }
 
 bool cstr::is_sameprefix(std::string_view str, CASE checkcase) const
 {
-    if (str.empty())
-        return empty();
-
-    if (empty() || length() < str.length())
-        return false;
-
-    if (checkcase == CASE::exact)
-    {
-        auto iterMain = begin();
-        for (auto iterSub: str)
-        {
-            if (*iterMain++ != iterSub)
-                return false;
-        }
-        return true;
-    }
-    else if (checkcase == CASE::either)
-    {
-        auto iterMain = begin();
-        for (auto iterSub: str)
-        {
-            if (std::tolower(*iterMain++) != std::tolower(iterSub))
-                return false;
-        }
-        return true;
-    }
-    else if (checkcase == CASE::utf8)
-    {
-        auto utf8locale = std::locale("en_US.utf8");
-        auto iterMain = begin();
-        for (auto iterSub: str)
-        {
-            if (std::tolower(*iterMain++, utf8locale) != std::tolower(iterSub, utf8locale))
-                return false;
-        }
-        return true;
-    }
-    assert(!"Unknown CASE value");
-    return false;
+    return ttlib::is_sameprefix(*this, str, checkcase);
 }
 
 int cstr::comparei(std::string_view str) const
 {
-    auto main = begin();
-    auto sub = str.begin();
-    while (sub != str.end())
-    {
-        auto diff = std::tolower(main[0]) - std::tolower(sub[0]);
-        if (diff != 0)
-            return diff;
-        ++main;
-        ++sub;
-        if (main == end())
-            return (sub != str.end() ? -1 : 0);
-    }
-
-    return (main != end() ? 1 : 0);
+    return ttlib::comparei(*this, str);
 }
 
 cstr& cstr::trim(tt::TRIM where)
@@ -106,16 +44,10 @@ cstr& cstr::trim(tt::TRIM where)
     if (where == tt::TRIM::right || where == tt::TRIM::both)
     {
         auto len = length();
-        for (--len; len != std::string::npos; --len)
-        {
-            // char ch = at(len);
-            char ch = c_str()[len];
-            if (ch != ' ' && ch != '\t' && ch != '\r' && ch != '\n' && ch != '\f')
-                break;
-        }
-
-        if (len + 1 < length())
-            erase(len + 1, length() - len);
+        while (len > 0 && ttlib::is_whitespace(c_str()[len - 1]))
+            --len;
+        if (len < length())
+            erase(len);
     }
 
     // If trim(right) was called above, the string may now be empty -- front() fails on an empty string
@@ -126,13 +58,8 @@ cstr& cstr::trim(tt::TRIM where)
         if (!ttlib::is_whitespace(front()))
             return *this;
 
-        size_t pos;
-        for (pos = 1; pos < length(); ++pos)
-        {
-            if (!ttlib::is_whitespace(c_str()[pos]))
-                break;
-        }
-        replace(0, length(), substr(pos, length() - pos));
+        auto pos = ttlib::find_nonclass(*this, tt::cls_space, 1);
+        erase(0, pos != npos ? pos : length());
     }
 
     return *this;
@@ -354,47 +281,9 @@ size_t cstr::locate(std::string_view str, size_t posStart, CASE checkcase) const
         return find(str, posStart);
 
     if (checkcase == CASE::either)
-    {
-        auto chLower = std::tolower(str[0]);
-        for (auto pos = posStart; pos < length(); ++pos)
-        {
-            if (std::tolower(at(pos)) == chLower)
-            {
-                size_t posSub;
-                for (posSub = 1; posSub < str.length(); ++posSub)
-                {
-                    if (pos + posSub >= length())
-                        return npos;
-                    if (std::tolower(at(pos + posSub)) != std::tolower(str.at(posSub)))
-                        break;
-                }
-                if (posSub >= str.length())
-                    return pos;
-            }
-        }
-    }
-    else
-    {
-        auto utf8locale = std::locale("en_US.utf8");
-        auto chLower = std::tolower(str[0], utf8locale);
-        for (auto pos = posStart; pos < length(); ++pos)
-        {
-            if (std::tolower(at(pos), utf8locale) == chLower)
-            {
-                size_t posSub;
-                for (posSub = 1; posSub < str.length(); ++posSub)
-                {
-                    if (pos + posSub >= length())
-                        return npos;
-                    if (std::tolower(at(pos + posSub), utf8locale) != std::tolower(str.at(posSub), utf8locale))
-                        break;
-                }
-                if (posSub >= str.length())
-                    return pos;
-            }
-        }
-    }
-    return npos;
+        return ttlib::find_nocase(*this, str, posStart);
+
+    return ttlib::find_utf8(*this, str, posStart);
 }
 
 size_t cstr::get_hash() const noexcept
@@ -416,21 +305,13 @@ size_t cstr::get_hash() const noexcept
 
 cstr& cstr::MakeLower()
 {
-    auto utf8locale = std::locale("en_US.utf8");
-    for (auto iter = begin(); iter != end(); ++iter)
-    {
-        *iter = std::tolower(*iter, utf8locale);
-    }
+    ttlib::MakeLower(*this);
     return *this;
 }
 
 cstr& cstr::MakeUpper()
 {
-    auto utf8locale = std::locale("en_US.utf8");
-    for (auto iter = begin(); iter != end(); ++iter)
-    {
-        *iter = std::toupper(*iter, utf8locale);
-    }
+    ttlib::MakeUpper(*this);
     return *this;
 }
 
@@ -696,41 +577,37 @@ size_t cstr::find_oneof(const char* pszSet) const
 {
     if (!pszSet || !*pszSet)
         return npos;
-    const char* pszFound = std::strpbrk(c_str(), pszSet);
-    if (!pszFound)
-        return npos;
-    return (static_cast<size_t>(pszFound - c_str()));
+    return ttlib::charset(pszSet).find_oneof(*this);
 }
 
 size_t cstr::find_oneof(cview set, size_t start) const
 {
     if (set.empty())
         return tt::npos;
-    auto view_start = subview(start);
-    const char* pszFound = std::strpbrk(view_start, set);
-    if (!pszFound)
-        return tt::npos;
-    return (static_cast<size_t>(pszFound - view_start.c_str()));
+
+    // Unlike find_first_in(), this has always returned the offset from start
+    auto pos = ttlib::charset(set).find_oneof(*this, start);
+    return (pos == tt::npos) ? tt::npos : pos - start;
+}
+
+size_t cstr::find_first_in(const ttlib::charset& set, size_t start) const
+{
+    return set.find_oneof(*this, start);
 }
 
 size_t cstr::find_space(size_t start) const
 {
-    if (start >= length())
-        return npos;
-    const char* pszFound = std::strpbrk(c_str() + start, " \t\r\n\f");
-    if (!pszFound)
-        return npos;
-    return (static_cast<size_t>(pszFound - c_str()));
+    return ttlib::find_class(*this, tt::cls_space, start);
 }
 
 size_t cstr::find_nonspace(size_t start) const
 {
-    for (; start < length(); ++start)
-    {
-        if (!std::strchr(" \t\r\n\f", at(start)))
-            break;
-    }
-    return start;
+    // Unlike find_space(), this returns the length of the string rather than npos if there are no
+    // non-whitespace characters.
+    auto pos = ttlib::find_nonclass(*this, tt::cls_space, start);
+    if (pos != npos)
+        return pos;
+    return (start > length()) ? start : length();
 }
 
 size_t cstr::stepover(size_t start) const
@@ -793,319 +670,6 @@ void cstr::erase_from(std::string_view sub)
     }
 }
 
-cstr& cdecl cstr::Format(std::string_view format, ...)
-{
-    enum WIDTH : size_t
-    {
-        WIDTH_NONE,
-        WIDTH_CHAR,
-        WIDTH_SHORT,
-        WIDTH_LONG,
-        WIDTH_LONG_LONG,
-        WIDTH_INT_MAX,
-        WIDTH_SIZE_T,
-        WIDTH_PTRDIFF,
-        WIDTH_LONG_DOUBLE
-    };
-
-    std::va_list args;
-    va_start(args, format);
-
-    std::stringstream buffer;
-
-    // Place this outside the try block so that we can refer to it in the catch block
-    size_t pos = 0;
-
-    try
-    {
-        for (pos = 0; pos < format.length(); ++pos)
-        {
-            // Use .at(pos) not .[pos] to throw an exception if invalid format string is used
-            if (format.at(pos) != '%')
-            {
-                buffer << format.at(pos);
-                continue;
-            }
-            ++pos;
-
-            if (format.at(pos) == '%')
-            {
-                buffer << format.at(pos);
-                continue;
-            }
-
-            bool kflag = false;
-            if (format.at(pos) == 'k')
-            {
-                kflag = true;
-                ++pos;
-            }
-
-            WIDTH width = WIDTH_NONE;
-
-            if (format.at(pos) == 'h')
-            {
-                ++pos;
-                if (format.at(pos) == 'h')
-                {
-                    ++pos;
-                    width = WIDTH_SHORT;
-                }
-                else
-                {
-                    width = WIDTH_CHAR;
-                }
-            }
-
-            else if (format.at(pos) == 'l')
-            {
-                ++pos;
-                if (format.at(pos) == 'l')
-                {
-                    ++pos;
-                    width = WIDTH_LONG_LONG;
-                }
-                else
-                {
-                    width = WIDTH_LONG;
-                }
-            }
-
-            else if (format.at(pos) == 'j')
-            {
-                ++pos;
-                width = WIDTH_INT_MAX;
-            }
-            else if (format.at(pos) == 'z')
-            {
-                ++pos;
-                width = WIDTH_SIZE_T;
-            }
-            else if (format.at(pos) == 't')
-            {
-                ++pos;
-                width = WIDTH_PTRDIFF;
-            }
-            else if (format.at(pos) == 'L')
-            {
-                ++pos;
-                width = WIDTH_LONG_DOUBLE;
-            }
-
-            bool LeftFieldWidth = false;
-            if (format.at(pos) == '-')
-            {
-                buffer << std::left;
-                LeftFieldWidth = true;
-                ++pos;
-            }
-
-            if (ttlib::is_digit(format.at(pos)))
-            {
-                auto fieldWidth = ttlib::atoi(format.substr(pos));
-                buffer << std::setw(fieldWidth);
-                do
-                {
-                    ++pos;
-                } while (pos < format.length() && ttlib::is_digit(format.at(pos)));
-            }
-
-            // For both %lc and %ls we assume a UTF16 string and convert it to UTF8.
-
-            if (format.at(pos) == 'c')
-            {
-                if (width != WIDTH_LONG)
-                    buffer << va_arg(args, char);
-                else
-                {
-                    std::wstring str16;
-                    str16 += va_arg(args, wchar_t);
-                    std::string str8;
-                    ttlib::utf16to8(str16, str8);
-                    buffer << str8;
-                }
-            }
-            else if (format.at(pos) == 's')
-            {
-                if (width != WIDTH_LONG)
-                {
-                    if (kflag)
-                        buffer << std::quoted(va_arg(args, const char*));
-                    else
-                        buffer << va_arg(args, const char*);
-                }
-                else
-                {
-                    std::wstring str16;
-                    str16 += va_arg(args, const wchar_t*);
-                    std::string str8;
-                    ttlib::utf16to8(str16, str8);
-                    if (kflag)
-                        buffer << std::quoted(str8);
-                    else
-                        buffer << str8;
-                }
-            }
-            else if (format.at(pos) == 'v')
-            {
-                if (width != WIDTH_LONG)
-                {
-                    if (kflag)
-                        buffer << std::quoted(va_arg(args, std::string_view));
-                    else
-                        buffer << va_arg(args, std::string_view);
-                }
-                else
-                {
-                    std::wstring str16;
-                    str16 += va_arg(args, std::wstring);
-                    std::string str8;
-                    ttlib::utf16to8(str16, str8);
-                    if (kflag)
-                        buffer << std::quoted(str8);
-                    else
-                        buffer << str8;
-                }
-            }
-            else if (format.at(pos) == 'd' || format.at(pos) == 'i')
-            {
-                std::locale previous;
-                if (kflag)
-                    previous = buffer.imbue(std::locale(""));
-
-                switch (width)
-                {
-                    default:
-                    case WIDTH_NONE:
-                        buffer << va_arg(args, int);
-                        break;
-
-                    case WIDTH_CHAR:
-                        buffer << va_arg(args, signed char);
-                        break;
-
-                    case WIDTH_SHORT:
-                        buffer << va_arg(args, short);
-                        break;
-
-                    case WIDTH_LONG:
-                        buffer << va_arg(args, long);
-                        break;
-
-                    case WIDTH_LONG_LONG:
-                        buffer << va_arg(args, long long);
-                        break;
-
-                    case WIDTH_INT_MAX:
-                        buffer << va_arg(args, intmax_t);
-                        break;
-
-                    case WIDTH_SIZE_T:
-                        // REVIEW: [KeyWorks - 02-14-2020] The spec says this should be signed. Knowing that a
-                        // size_t is set to -1 is valuable, but any other value is likely to be unsigned. We break
-                        // from the spec and special case a value of -1, otherwise we format the value as unsigned.
-                        {
-                            size_t val = va_arg(args, size_t);
-                            if (val == static_cast<size_t>(-1))
-                                buffer << "-1";
-                            else
-                                buffer << val;
-                        }
-                        break;
-
-                    case WIDTH_PTRDIFF:
-                        buffer << va_arg(args, ptrdiff_t);
-                        break;
-                }
-                if (kflag)
-                    previous = buffer.imbue(previous);
-            }
-            else if (format.at(pos) == 'u' || format.at(pos) == 'o' || format.at(pos) == 'x' || format.at(pos) == 'X')
-            {
-                std::locale previous;
-                if (kflag)
-                    previous = buffer.imbue(std::locale(""));
-
-                if (format.at(pos) == 'o')
-                    buffer << std::oct;
-                else if (format.at(pos) == 'x')
-                {
-                    buffer << std::hex;
-                }
-                else if (format.at(pos) == 'X')
-                {
-                    buffer << std::uppercase;
-                    buffer << std::hex;
-                }
-
-                switch (width)
-                {
-                    default:
-                    case WIDTH_NONE:
-                        buffer << va_arg(args, unsigned int);
-                        break;
-
-                    case WIDTH_CHAR:
-                        buffer << va_arg(args, unsigned char);
-                        break;
-
-                    case WIDTH_SHORT:
-                        buffer << va_arg(args, unsigned short);
-                        break;
-
-                    case WIDTH_LONG:
-                        buffer << va_arg(args, unsigned long);
-                        break;
-
-                    case WIDTH_LONG_LONG:
-                        buffer << va_arg(args, unsigned long long);
-                        break;
-
-                    case WIDTH_INT_MAX:
-                        buffer << va_arg(args, uintmax_t);
-                        break;
-
-                    case WIDTH_SIZE_T:
-                        // REVIEW: [KeyWorks - 02-14-2020] The spec says this should be signed. Knowing that a
-                        // size_t is set to -1 is valuable, but any other value is likely to be unsigned. We
-                        // break from the spec and special case a value of -1, otherwise we format the value as
-                        // unsigned.
-                        {
-                            size_t val = va_arg(args, size_t);
-                            if (val == static_cast<size_t>(-1))
-                                buffer << "-1";
-                            else
-                                buffer << val;
-                        }
-                        break;
-
-                    case WIDTH_PTRDIFF:
-                        // REVIEW: [KeyWorks - 02-14-2020] There is no unsigned ptrdiff_t, so we use size_t
-                        buffer << va_arg(args, size_t);
-                        break;
-                }
-
-                if (kflag)
-                    previous = buffer.imbue(previous);
-                buffer << std::dec;
-                buffer << std::nouppercase;
-            }
-
-            if (LeftFieldWidth)
-                buffer << std::right;
-        }
-    }
-    catch (const std::exception& /* e */)
-    {
-        assert(!"exception in ttlib::cstr.Format()");
-    }
-
-    va_end(args);
-
-    this->assign(buffer.str());
-
-    return *this;
-}
 ttlib::cview cstr::subview(size_t start) const
 {
     if (ttlib::is_error(start))
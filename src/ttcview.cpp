@@ -9,65 +9,22 @@
 #include <cassert>
 #include <cctype>
 #include <cstring>
-#include <locale>
 
 #include "ttcview.h"
 
+#include "ttcharset.h"  // Precompiled set of characters for delimiter scanning
+#include "ttutf.h"      // Unicode conversion, validation and decoding
+
 using namespace ttlib;
 
 bool cview::is_sameas(std::string_view str, tt::CASE checkcase) const
 {
-    if (size() != str.size())
-        return false;
-
-    if (empty())
-        return str.empty();
-
-    // if both strings have the same length, then we can compare as a prefix.
-    return is_sameprefix(str, checkcase);
+    return ttlib::is_sameas(*this, str, checkcase);
 }
 
 bool cview::is_sameprefix(std::string_view str, tt::CASE checkcase) const
 {
-    if (str.empty())
-        return empty();
-
-    if (empty() || length() < str.length())
-        return false;
-
-    if (checkcase == tt::CASE::exact)
-    {
-        auto iterMain = begin();
-        for (auto iterSub: str)
-        {
-            if (*iterMain++ != iterSub)
-                return false;
-        }
-        return true;
-    }
-    else if (checkcase == tt::CASE::either)
-    {
-        auto iterMain = begin();
-        for (auto iterSub: str)
-        {
-            if (std::tolower(*iterMain++) != std::tolower(iterSub))
-                return false;
-        }
-        return true;
-    }
-    else if (checkcase == tt::CASE::utf8)
-    {
-        auto utf8locale = std::locale("en_US.utf8");
-        auto iterMain = begin();
-        for (auto iterSub: str)
-        {
-            if (std::tolower(*iterMain++, utf8locale) != std::tolower(iterSub, utf8locale))
-                return false;
-        }
-        return true;
-    }
-    assert(!"Unknown tt::CASE value");
-    return false;
+    return ttlib::is_sameprefix(*this, str, checkcase);
 }
 
 size_t cview::locate(std::string_view str, size_t posStart, tt::CASE checkcase) const
@@ -79,174 +36,72 @@ size_t cview::locate(std::string_view str, size_t posStart, tt::CASE checkcase)
         return find(str, posStart);
 
     if (checkcase == tt::CASE::either)
-    {
-        auto chLower = std::tolower(str[0]);
-        for (auto pos = posStart; pos < length(); ++pos)
-        {
-            if (std::tolower(at(pos)) == chLower)
-            {
-                size_t posSub;
-                for (posSub = 1; posSub < str.length(); ++posSub)
-                {
-                    if (pos + posSub >= length())
-                        return npos;
-                    if (std::tolower(at(pos + posSub)) != std::tolower(str.at(posSub)))
-                        break;
-                }
-                if (posSub >= str.length())
-                    return pos;
-            }
-        }
-    }
-    else
-    {
-        auto utf8locale = std::locale("en_US.utf8");
-        auto chLower = std::tolower(str[0], utf8locale);
-        for (auto pos = posStart; pos < length(); ++pos)
-        {
-            if (std::tolower(at(pos), utf8locale) == chLower)
-            {
-                size_t posSub;
-                for (posSub = 1; posSub < str.length(); ++posSub)
-                {
-                    if (pos + posSub >= length())
-                        return npos;
-                    if (std::tolower(at(pos + posSub), utf8locale) != std::tolower(str.at(posSub), utf8locale))
-                        break;
-                }
-                if (posSub >= str.length())
-                    return pos;
-            }
-        }
-    }
-    return npos;
+        return ttlib::find_nocase(*this, str, posStart);
+
+    return ttlib::find_utf8(*this, str, posStart);
 }
 
 bool cview::moveto_space() noexcept
 {
-    if (empty())
-        return false;
-    size_t pos;
-    for (pos = 0; pos < length(); ++pos)
-    {
-        if (ttlib::is_whitespace(at(pos)))
-            break;
-    }
-    if (pos >= length())
+    auto pos = ttlib::find_class(*this, tt::cls_space);
+    if (pos == npos)
         return false;
-    else
-    {
-        remove_prefix(pos);
-        return true;
-    }
+    remove_prefix(pos);
+    return true;
 }
 
 bool cview::moveto_nonspace() noexcept
 {
-    if (empty())
-        return false;
-    size_t pos;
-    for (pos = 0; pos < length(); ++pos)
-    {
-        if (!ttlib::is_whitespace(at(pos)))
-            break;
-    }
-    if (pos >= length())
+    auto pos = ttlib::find_nonclass(*this, tt::cls_space);
+    if (pos == npos)
         return false;
-    else
-    {
-        remove_prefix(pos);
-        return true;
-    }
+    remove_prefix(pos);
+    return true;
 }
 
 bool cview::moveto_nextword() noexcept
 {
-    if (empty())
-        return false;
-    size_t pos;
-    for (pos = 0; pos < length(); ++pos)
-    {
-        if (ttlib::is_whitespace(at(pos)))
-            break;
-    }
-    if (pos >= length())
+    auto pos = ttlib::find_class(*this, tt::cls_space);
+    if (pos == npos)
         return false;
 
     // whitespace found, look for non-whitespace
-    else
-    {
-        for (++pos; pos < length(); ++pos)
-        {
-            if (!ttlib::is_whitespace(at(pos)))
-                break;
-        }
-        if (pos >= length())
-            return false;
+    pos = ttlib::find_nonclass(*this, tt::cls_space, pos);
+    if (pos == npos)
+        return false;
 
-        remove_prefix(pos);
-        return true;
-    }
+    remove_prefix(pos);
+    return true;
 }
 
 cview cview::view_digit(size_t start) const
 {
-    for (; start < length(); ++start)
-    {
-        if (ttlib::is_digit(at(start)))
-            return subview(start);
-    }
-
-    return subview(length());
+    auto pos = ttlib::find_class(*this, tt::cls_digit, start);
+    return subview(pos != npos ? pos : length());
 }
 
 cview cview::view_nondigit(size_t start) const
 {
-    for (; start < length(); ++start)
-    {
-        if (!ttlib::is_digit(at(start)))
-            return subview(start);
-    }
-
-    return subview(length());
+    auto pos = ttlib::find_nonclass(*this, tt::cls_digit, start);
+    return subview(pos != npos ? pos : length());
 }
 
 bool cview::moveto_digit() noexcept
 {
-    if (empty())
-        return false;
-    size_t pos;
-    for (pos = 0; pos < length(); ++pos)
-    {
-        if (ttlib::is_digit(at(pos)))
-            break;
-    }
-    if (pos >= length())
+    auto pos = ttlib::find_class(*this, tt::cls_digit);
+    if (pos == npos)
         return false;
-    else
-    {
-        remove_prefix(pos);
-        return true;
-    }
+    remove_prefix(pos);
+    return true;
 }
 
 bool cview::moveto_nondigit() noexcept
 {
-    if (empty())
-        return false;
-    size_t pos;
-    for (pos = 0; pos < length(); ++pos)
-    {
-        if (!ttlib::is_digit(at(pos)))
-            break;
-    }
-    if (pos >= length())
+    auto pos = ttlib::find_nonclass(*this, tt::cls_digit);
+    if (pos == npos)
         return false;
-    else
-    {
-        remove_prefix(pos);
-        return true;
-    }
+    remove_prefix(pos);
+    return true;
 }
 
 bool cview::moveto_extension() noexcept
@@ -294,6 +149,25 @@ bool cview::moveto_filename() noexcept
     return true;
 }
 
+bool cview::advance(size_t count) noexcept
+{
+    auto pos = ttlib::utf8_offset(*this, count);
+    if (pos == npos)
+        return false;
+    remove_prefix(pos);
+    return true;
+}
+
+bool cview::retreat(size_t count, const char* begin) noexcept
+{
+    assert(begin && begin <= data());
+    auto pos = ttlib::utf8_offset_back(std::string_view(begin, static_cast<size_t>(data() - begin)), count);
+    if (pos == npos)
+        return false;
+    *this = cview(begin + pos, static_cast<size_t>(data() + size() - begin) - pos);
+    return true;
+}
+
 ttlib::cview cview::extension() const noexcept
 {
     if (empty())
@@ -385,41 +259,37 @@ size_t cview::find_oneof(const std::string& set) const
 {
     if (set.empty())
         return tt::npos;
-    auto pFound = std::strpbrk(c_str(), set.c_str());
-    if (!pFound)
-        return tt::npos;
-    return (static_cast<size_t>(pFound - c_str()));
+    return ttlib::charset(set).find_oneof(*this);
 }
 
 size_t cview::find_oneof(cview set, size_t start) const
 {
     if (set.empty())
         return tt::npos;
-    auto view_start = subview(start);
-    auto pFound = std::strpbrk(view_start, set);
-    if (!pFound)
-        return tt::npos;
-    return (static_cast<size_t>(pFound - view_start.c_str()));
+
+    // Unlike find_first_in(), this has always returned the offset from start
+    auto pos = ttlib::charset(set).find_oneof(*this, start);
+    return (pos == tt::npos) ? tt::npos : pos - start;
+}
+
+size_t cview::find_first_in(const ttlib::charset& set, size_t start) const
+{
+    return set.find_oneof(*this, start);
 }
 
 size_t cview::find_space(size_t start) const
 {
-    if (start >= length())
-        return npos;
-    auto pFound = std::strpbrk(c_str() + start, " \t\r\n\f");
-    if (!pFound)
-        return npos;
-    return (static_cast<size_t>(pFound - c_str()));
+    return ttlib::find_class(*this, tt::cls_space, start);
 }
 
 size_t cview::find_nonspace(size_t start) const
 {
-    for (; start < length(); ++start)
-    {
-        if (!std::strchr(" \t\r\n\f", at(start)))
-            break;
-    }
-    return start;
+    // Unlike find_space(), this returns the length of the string rather than npos if there are no
+    // non-whitespace characters.
+    auto pos = ttlib::find_nonclass(*this, tt::cls_space, start);
+    if (pos != npos)
+        return pos;
+    return (start > length()) ? start : length();
 }
 
 size_t cview::stepover(size_t start) const
@@ -441,20 +311,7 @@ std::wstring cview::to_utf16() const
 
 int cview::comparei(std::string_view str) const
 {
-    auto main = begin();
-    auto sub = str.begin();
-    while (sub != str.end())
-    {
-        auto diff = std::tolower(main[0]) - std::tolower(sub[0]);
-        if (diff != 0)
-            return diff;
-        ++main;
-        ++sub;
-        if (main == end())
-            return (sub != str.end() ? -1 : 0);
-    }
-
-    return (main != end() ? 1 : 0);
+    return ttlib::comparei(*this, str);
 }
 
 std::string_view cview::subview(size_t start, size_t len) const
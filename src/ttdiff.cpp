@@ -0,0 +1,326 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttdiff.cpp
+// Purpose:   Line-by-line difference between two text files
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+#include <unordered_map>
+#include <utility>
+
+#include "ttdiff.h"  // Line-by-line difference between two text files
+#include "tthash.h"  // Seeded 64-bit string hash and incremental hasher
+
+using namespace ttlib;
+
+namespace
+{
+    // Any two lines that are the same according to checkcase have the same hash.
+    struct line_hash
+    {
+        tt::CASE checkcase;
+
+        size_t operator()(std::string_view line) const noexcept
+        {
+            if (checkcase == tt::CASE::exact)
+                return static_cast<size_t>(ttlib::get_hash64(line));
+            if (checkcase == tt::CASE::either)
+                return static_cast<size_t>(ttlib::get_hash64_nocase(line));
+            return static_cast<size_t>(ttlib::get_hash64_utf8(line));
+        }
+    };
+
+    struct line_equal
+    {
+        tt::CASE checkcase;
+
+        bool operator()(std::string_view line1, std::string_view line2) const
+        {
+            return ttlib::is_sameas(line1, line2, checkcase);
+        }
+    };
+
+    // Once this many differences have been found in a single range without finding the middle of the
+    // edit script, the range is split at the point that got furthest instead. The result is still a
+    // correct edit script, but it may no longer be the shortest one.
+    constexpr ptrdiff_t max_edit_cost = 1024;
+
+    // Marks the lines that are not part of the longest common subsequence of a and b.
+    class myers
+    {
+    public:
+        myers(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) :
+            a_changed(a.size(), false), b_changed(b.size(), false), m_a(a.data()), m_b(b.data())
+        {
+        }
+
+        void compare(ptrdiff_t a_lo, ptrdiff_t a_hi, ptrdiff_t b_lo, ptrdiff_t b_hi);
+
+        std::vector<bool> a_changed;
+        std::vector<bool> b_changed;
+
+    protected:
+        // Returns the point (relative to a and b) where the shortest edit script crosses the middle
+        // diagonal, or { -1, -1 } if a and b have nothing in common.
+        std::pair<ptrdiff_t, ptrdiff_t> bisect(const uint32_t* a, ptrdiff_t n, const uint32_t* b, ptrdiff_t m);
+
+        void mark(std::vector<bool>& changed, ptrdiff_t lo, ptrdiff_t hi)
+        {
+            for (; lo < hi; ++lo)
+                changed[static_cast<size_t>(lo)] = true;
+        }
+
+    private:
+        const uint32_t* m_a;
+        const uint32_t* m_b;
+
+        // Furthest x reached on each diagonal, searching forward from the start and backward from the
+        // end. The vectors are only allocated once, and reused for every range.
+        std::vector<ptrdiff_t> m_forward;
+        std::vector<ptrdiff_t> m_reverse;
+    };
+
+    void myers::compare(ptrdiff_t a_lo, ptrdiff_t a_hi, ptrdiff_t b_lo, ptrdiff_t b_hi)
+    {
+        while (a_lo < a_hi && b_lo < b_hi && m_a[a_lo] == m_b[b_lo])
+        {
+            ++a_lo;
+            ++b_lo;
+        }
+        while (a_lo < a_hi && b_lo < b_hi && m_a[a_hi - 1] == m_b[b_hi - 1])
+        {
+            --a_hi;
+            --b_hi;
+        }
+
+        if (a_lo == a_hi || b_lo == b_hi)
+        {
+            mark(a_changed, a_lo, a_hi);
+            mark(b_changed, b_lo, b_hi);
+            return;
+        }
+
+        auto [x, y] = bisect(m_a + a_lo, a_hi - a_lo, m_b + b_lo, b_hi - b_lo);
+        if (x < 0 || (x == 0 && y == 0) || (x == a_hi - a_lo && y == b_hi - b_lo))
+        {
+            mark(a_changed, a_lo, a_hi);
+            mark(b_changed, b_lo, b_hi);
+            return;
+        }
+
+        compare(a_lo, a_lo + x, b_lo, b_lo + y);
+        compare(a_lo + x, a_hi, b_lo + y, b_hi);
+    }
+
+    std::pair<ptrdiff_t, ptrdiff_t> myers::bisect(const uint32_t* a, ptrdiff_t n, const uint32_t* b, ptrdiff_t m)
+    {
+        const ptrdiff_t max_d = (n + m + 1) / 2;
+        const ptrdiff_t offset = max_d;
+        const ptrdiff_t length = 2 * max_d + 2;
+        m_forward.assign(static_cast<size_t>(length), -1);
+        m_reverse.assign(static_cast<size_t>(length), -1);
+        auto forward = m_forward.data();
+        auto reverse = m_reverse.data();
+        forward[offset + 1] = 0;
+        reverse[offset + 1] = 0;
+
+        // If the total number of differences is odd, the forward search will be the one to reach the
+        // middle first.
+        const ptrdiff_t delta = n - m;
+        const bool check_forward = (delta & 1) != 0;
+
+        // Diagonals that have gone past the right or bottom edge don't need to be searched again.
+        ptrdiff_t k1_start = 0;
+        ptrdiff_t k1_end = 0;
+        ptrdiff_t k2_start = 0;
+        ptrdiff_t k2_end = 0;
+
+        for (ptrdiff_t d = 0; d < max_d; ++d)
+        {
+            for (ptrdiff_t k1 = -d + k1_start; k1 <= d - k1_end; k1 += 2)
+            {
+                auto k1_offset = offset + k1;
+                ptrdiff_t x1;
+                if (k1 == -d || (k1 != d && forward[k1_offset - 1] < forward[k1_offset + 1]))
+                    x1 = forward[k1_offset + 1];
+                else
+                    x1 = forward[k1_offset - 1] + 1;
+                auto y1 = x1 - k1;
+                while (x1 < n && y1 < m && a[x1] == b[y1])
+                {
+                    ++x1;
+                    ++y1;
+                }
+                forward[k1_offset] = x1;
+
+                if (x1 > n)
+                    k1_end += 2;
+                else if (y1 > m)
+                    k1_start += 2;
+                else if (check_forward)
+                {
+                    auto k2_offset = offset + delta - k1;
+                    if (k2_offset >= 0 && k2_offset < length && reverse[k2_offset] != -1 &&
+                        x1 >= n - reverse[k2_offset])
+                    {
+                        return { x1, y1 };
+                    }
+                }
+            }
+
+            for (ptrdiff_t k2 = -d + k2_start; k2 <= d - k2_end; k2 += 2)
+            {
+                auto k2_offset = offset + k2;
+                ptrdiff_t x2;
+                if (k2 == -d || (k2 != d && reverse[k2_offset - 1] < reverse[k2_offset + 1]))
+                    x2 = reverse[k2_offset + 1];
+                else
+                    x2 = reverse[k2_offset - 1] + 1;
+                auto y2 = x2 - k2;
+                while (x2 < n && y2 < m && a[n - x2 - 1] == b[m - y2 - 1])
+                {
+                    ++x2;
+                    ++y2;
+                }
+                reverse[k2_offset] = x2;
+
+                if (x2 > n)
+                    k2_end += 2;
+                else if (y2 > m)
+                    k2_start += 2;
+                else if (!check_forward)
+                {
+                    auto k1_offset = offset + delta - k2;
+                    if (k1_offset >= 0 && k1_offset < length && forward[k1_offset] != -1)
+                    {
+                        auto x1 = forward[k1_offset];
+                        if (x1 >= n - x2)
+                            return { x1, x1 - (k1_offset - offset) };
+                    }
+                }
+            }
+
+            if (d >= max_edit_cost)
+            {
+                // Give up on finding the middle, and split at the forward diagonal that got the
+                // furthest.
+                ptrdiff_t best_x = -1;
+                ptrdiff_t best_y = -1;
+                for (ptrdiff_t k1 = -d + k1_start; k1 <= d - k1_end; k1 += 2)
+                {
+                    auto x1 = forward[offset + k1];
+                    auto y1 = x1 - k1;
+                    if (x1 <= n && y1 >= 0 && y1 <= m && x1 + y1 > best_x + best_y)
+                    {
+                        best_x = x1;
+                        best_y = y1;
+                    }
+                }
+                return { best_x, best_y };
+            }
+        }
+        return { -1, -1 };
+    }
+}  // anonymous namespace
+
+std::vector<diff_hunk> ttlib::diff_lines(const std::vector<std::string_view>& old_lines,
+                                         const std::vector<std::string_view>& new_lines, tt::CASE checkcase)
+{
+    // Replace every line with an id so that the diff only has to compare integers. in_old and in_new
+    // record which file(s) each id appears in.
+    std::unordered_map<std::string_view, uint32_t, line_hash, line_equal> ids(
+        old_lines.size() + new_lines.size(), line_hash { checkcase }, line_equal { checkcase });
+    std::vector<bool> in_old;
+    std::vector<bool> in_new;
+    auto get_id = [&](std::string_view line)
+    {
+        auto [iter, added] = ids.emplace(line, static_cast<uint32_t>(ids.size()));
+        if (added)
+        {
+            in_old.push_back(false);
+            in_new.push_back(false);
+        }
+        return iter->second;
+    };
+
+    std::vector<uint32_t> old_ids;
+    old_ids.reserve(old_lines.size());
+    for (auto& line: old_lines)
+    {
+        old_ids.push_back(get_id(line));
+        in_old[old_ids.back()] = true;
+    }
+
+    std::vector<uint32_t> new_ids;
+    new_ids.reserve(new_lines.size());
+    for (auto& line: new_lines)
+    {
+        new_ids.push_back(get_id(line));
+        in_new[new_ids.back()] = true;
+    }
+
+    // A line that is only in one of the files can never be matched, so it's removed before running the
+    // diff. The shortest edit script is the same with or without these lines, but without them two
+    // files that have little in common don't take quadratic time.
+    std::vector<uint32_t> a;
+    std::vector<size_t> a_lines;
+    for (size_t pos = 0; pos < old_ids.size(); ++pos)
+    {
+        if (in_new[old_ids[pos]])
+        {
+            a.push_back(old_ids[pos]);
+            a_lines.push_back(pos);
+        }
+    }
+
+    std::vector<uint32_t> b;
+    std::vector<size_t> b_lines;
+    for (size_t pos = 0; pos < new_ids.size(); ++pos)
+    {
+        if (in_old[new_ids[pos]])
+        {
+            b.push_back(new_ids[pos]);
+            b_lines.push_back(pos);
+        }
+    }
+
+    myers diff(a, b);
+    diff.compare(0, static_cast<ptrdiff_t>(a.size()), 0, static_cast<ptrdiff_t>(b.size()));
+
+    std::vector<bool> old_changed(old_ids.size(), true);
+    for (size_t pos = 0; pos < a.size(); ++pos)
+        old_changed[a_lines[pos]] = diff.a_changed[pos];
+    std::vector<bool> new_changed(new_ids.size(), true);
+    for (size_t pos = 0; pos < b.size(); ++pos)
+        new_changed[b_lines[pos]] = diff.b_changed[pos];
+
+    // Every unchanged line in the old file is matched with the unchanged line in the same position in
+    // the new file, so the hunks are the runs of changed lines between them.
+    std::vector<diff_hunk> hunks;
+    size_t old_pos = 0;
+    size_t new_pos = 0;
+    while (old_pos < old_changed.size() || new_pos < new_changed.size())
+    {
+        if (old_pos < old_changed.size() && new_pos < new_changed.size() && !old_changed[old_pos] &&
+            !new_changed[new_pos])
+        {
+            ++old_pos;
+            ++new_pos;
+            continue;
+        }
+
+        diff_hunk hunk;
+        hunk.old_line = old_pos;
+        hunk.new_line = new_pos;
+        while (old_pos < old_changed.size() && old_changed[old_pos])
+            ++old_pos;
+        while (new_pos < new_changed.size() && new_changed[new_pos])
+            ++new_pos;
+        hunk.old_count = old_pos - hunk.old_line;
+        hunk.new_count = new_pos - hunk.new_line;
+        hunk.type = !hunk.old_count ? tt::DIFF::inserted : !hunk.new_count ? tt::DIFF::deleted : tt::DIFF::changed;
+        hunks.push_back(hunk);
+    }
+    return hunks;
+}
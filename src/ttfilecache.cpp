@@ -0,0 +1,324 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttfilecache.cpp
+// Purpose:   Cache of file fingerprints, content hashes and line indexes
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <sys/stat.h>
+#endif
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#include "ttfilecache.h"   // Cache of file fingerprints, content hashes and line indexes
+#include "ttfilewriter.h"  // Buffered file writer that replaces the file atomically
+#include "ttlibspace.h"    // ttlib namespace functions and declarations
+#include "ttsimd.h"        // line_scanner, count_line_ends()
+#include "tttextfile.h"    // Classes for reading and writing text files
+
+using namespace ttlib;
+
+namespace
+{
+    // The cache file starts with cache_signature followed by cache_version, and ends with a hash of
+    // everything before it. The version must be changed whenever the format changes.
+    constexpr char cache_signature[8] = { 't', 't', 'F', 'C', 'A', 'C', 'H', 'E' };
+    constexpr uint64_t cache_version = 1;
+
+    // A file modified this recently (in nanoseconds) could be modified again without changing its
+    // modification time. 2 seconds covers the resolution of FAT file systems.
+    constexpr int64_t racy_interval = 2000000000;
+
+    int64_t current_time()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void put_u64(std::string& buffer, uint64_t value)
+    {
+        for (int byte = 0; byte < 8; ++byte)
+        {
+            buffer.push_back(static_cast<char>(value & 0xFF));
+            value >>= 8;
+        }
+    }
+
+    // Most line lengths fit in a single byte when stored 7 bits at a time
+    void put_varint(std::string& buffer, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        buffer.push_back(static_cast<char>(value));
+    }
+
+    // Reads values written by put_u64() and put_varint(). Every method returns false if there isn't
+    // enough data left.
+    class cache_reader
+    {
+    public:
+        cache_reader(std::string_view data) : m_pos(data.data()), m_end(data.data() + data.size()) {}
+
+        bool get_u64(uint64_t& value)
+        {
+            if (m_end - m_pos < 8)
+                return false;
+            value = 0;
+            for (int byte = 7; byte >= 0; --byte)
+                value = (value << 8) | static_cast<unsigned char>(m_pos[byte]);
+            m_pos += 8;
+            return true;
+        }
+
+        bool get_varint(uint64_t& value)
+        {
+            value = 0;
+            for (int shift = 0; shift < 64 && m_pos < m_end; shift += 7)
+            {
+                auto byte = static_cast<unsigned char>(*m_pos++);
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if (byte < 0x80)
+                    return true;
+            }
+            return false;
+        }
+
+        bool get_string(std::string& str)
+        {
+            uint64_t length;
+            if (!get_varint(length) || length > static_cast<uint64_t>(m_end - m_pos))
+                return false;
+            str.assign(m_pos, static_cast<size_t>(length));
+            m_pos += length;
+            return true;
+        }
+
+        bool empty() const noexcept { return m_pos == m_end; }
+
+    private:
+        const char* m_pos;
+        const char* m_end;
+    };
+}  // anonymous namespace
+
+bool filecache::get_fingerprint(std::string_view filename, fingerprint& stamp)
+{
+#if defined(_WIN32)
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExW(ttlib::utf8to16(filename).c_str(), GetFileExInfoStandard, &data))
+        return false;
+    stamp.size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+
+    // FILETIME is the number of 100 nanosecond intervals since 1601
+    auto ticks = (static_cast<int64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+                 data.ftLastWriteTime.dwLowDateTime;
+    stamp.mtime = (ticks - 116444736000000000LL) * 100;
+    stamp.inode = 0;
+    stamp.device = 0;
+#else
+    std::string name(filename);
+    struct stat info;
+    if (stat(name.c_str(), &info) != 0)
+        return false;
+    stamp.size = static_cast<uint64_t>(info.st_size);
+    #if defined(__APPLE__)
+    stamp.mtime = static_cast<int64_t>(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+    #else
+    stamp.mtime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    #endif
+    stamp.inode = static_cast<uint64_t>(info.st_ino);
+    stamp.device = static_cast<uint64_t>(info.st_dev);
+#endif  // _WIN32
+    return true;
+}
+
+const filecache::entry* filecache::find(std::string_view filename, const fingerprint& stamp) const
+{
+    auto found = m_entries.find(std::string(filename));
+    if (found == m_entries.end() || found->second.racy || found->second.stamp != stamp)
+        return nullptr;
+    return &found->second;
+}
+
+const filecache::entry& filecache::insert(std::string_view filename, const fingerprint& stamp, std::string_view text)
+{
+    auto& item = m_entries[std::string(filename)];
+    item.stamp = stamp;
+    item.hash = ttlib::get_hash64(text);
+    item.text_size = text.size();
+    item.racy = current_time() - stamp.mtime < racy_interval;
+    item.lines.clear();
+    item.line_count = 0;
+
+    // Lines are split exactly the same way as textfile::ParseLines() and viewfile::ParseLines()
+    item.lines.reserve(ttlib::count_line_ends(text.data(), text.size()));
+    ttlib::line_scanner scanner(text.data(), text.size());
+    size_t begin = 0;
+    size_t length;
+    for (auto end = scanner.next(length); end != tt::npos; end = scanner.next(length))
+    {
+        put_varint(item.lines, (static_cast<uint64_t>(end - begin) << 1) | (length == 2 ? 1 : 0));
+        ++item.line_count;
+        begin = end + length;
+    }
+
+    m_modified = true;
+    return item;
+}
+
+void filecache::erase(std::string_view filename)
+{
+    if (m_entries.erase(std::string(filename)))
+        m_modified = true;
+}
+
+void filecache::clear()
+{
+    if (!m_entries.empty())
+        m_modified = true;
+    m_entries.clear();
+}
+
+bool filecache::is_unchanged(std::string_view filename) const
+{
+    fingerprint stamp;
+    return get_fingerprint(filename, stamp) && find(filename, stamp);
+}
+
+bool filecache::get_hash(std::string_view filename, uint64_t& hash)
+{
+    fingerprint stamp;
+    if (!get_fingerprint(filename, stamp))
+        return false;
+    if (auto found = find(filename, stamp); found)
+    {
+        hash = found->hash;
+        return true;
+    }
+
+    // Reading the file through the cache replaces the entry for it
+    ttlib::viewfile file;
+    if (!file.ReadFile(filename, *this))
+        return false;
+    hash = m_entries[std::string(filename)].hash;
+    return true;
+}
+
+bool filecache::save(std::string_view cache_filename)
+{
+    std::string buffer(cache_signature, sizeof(cache_signature));
+    put_u64(buffer, cache_version);
+
+    size_t count = 0;
+    for (auto& [name, item]: m_entries)
+    {
+        if (!item.racy)
+            ++count;
+    }
+    put_u64(buffer, count);
+
+    for (auto& [name, item]: m_entries)
+    {
+        // The contents of a racy file can't be trusted the next time it is loaded
+        if (item.racy)
+            continue;
+
+        put_varint(buffer, name.size());
+        buffer.append(name);
+        put_u64(buffer, item.stamp.size);
+        put_u64(buffer, static_cast<uint64_t>(item.stamp.mtime));
+        put_u64(buffer, item.stamp.inode);
+        put_u64(buffer, item.stamp.device);
+        put_u64(buffer, item.hash);
+        put_u64(buffer, item.text_size);
+        put_varint(buffer, item.line_count);
+        put_varint(buffer, item.lines.size());
+        buffer.append(item.lines);
+    }
+    put_u64(buffer, ttlib::get_hash64(buffer));
+
+    ttlib::filewriter file;
+    if (!file.open(cache_filename))
+        return false;
+    file.write(buffer);
+    if (!file.commit())
+        return false;
+    m_modified = false;
+    return true;
+}
+
+bool filecache::load(std::string_view cache_filename)
+{
+    m_entries.clear();
+    m_modified = false;
+
+    std::ifstream file(std::string(cache_filename), std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        return false;
+    auto file_size = file.tellg();
+    if (file_size < static_cast<std::streamoff>(sizeof(cache_signature) + 3 * sizeof(uint64_t)))
+        return false;
+    std::string buffer(static_cast<size_t>(file_size), '\0');
+    file.seekg(0);
+    if (!file.read(buffer.data(), file_size))
+        return false;
+
+    // The hash at the end detects a cache that was truncated or damaged
+    std::string_view data(buffer);
+    uint64_t stored_hash;
+    cache_reader footer(data.substr(data.size() - sizeof(uint64_t)));
+    data.remove_suffix(sizeof(uint64_t));
+    if (!footer.get_u64(stored_hash) || stored_hash != ttlib::get_hash64(data) ||
+        std::memcmp(data.data(), cache_signature, sizeof(cache_signature)) != 0)
+    {
+        return false;
+    }
+    data.remove_prefix(sizeof(cache_signature));
+
+    cache_reader reader(data);
+    uint64_t version;
+    uint64_t count;
+    if (!reader.get_u64(version) || version != cache_version || !reader.get_u64(count))
+        return false;
+
+    auto fail = [this]()
+    {
+        m_entries.clear();
+        return false;
+    };
+
+    std::string name;
+    for (uint64_t index = 0; index < count; ++index)
+    {
+        entry item;
+        uint64_t mtime;
+        uint64_t line_count;
+        if (!reader.get_string(name) || !reader.get_u64(item.stamp.size) || !reader.get_u64(mtime) ||
+            !reader.get_u64(item.stamp.inode) || !reader.get_u64(item.stamp.device) || !reader.get_u64(item.hash) ||
+            !reader.get_u64(item.text_size) || !reader.get_varint(line_count) ||
+            !reader.get_string(item.lines))
+        {
+            return fail();
+        }
+        item.stamp.mtime = static_cast<int64_t>(mtime);
+        item.line_count = static_cast<size_t>(line_count);
+
+        // The line index itself is only checked when it is used (see entry::for_each_line())
+        if (item.line_count > item.lines.size())
+            return fail();
+        m_entries.emplace(std::move(name), std::move(item));
+    }
+    if (!reader.empty())
+        return fail();
+    return true;
+}
@@ -0,0 +1,140 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttfileloader.cpp
+// Purpose:   Loads multiple files at the same time on worker threads
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <cerrno>
+#endif
+
+#include <algorithm>
+#include <new>
+
+#include "ttfileloader.h"  // Loads multiple files at the same time on worker threads
+
+using namespace ttlib;
+
+namespace
+{
+    constexpr size_t min_default_threads = 4;
+
+    void reset_last_error()
+    {
+#if defined(_WIN32)
+        SetLastError(0);
+#else
+        errno = 0;
+#endif
+    }
+
+    // Returns the reason the last attempt to open or read a file on this thread failed
+    std::error_code last_error()
+    {
+#if defined(_WIN32)
+        if (auto code = GetLastError(); code)
+            return std::error_code(static_cast<int>(code), std::system_category());
+#else
+        if (errno)
+            return std::error_code(errno, std::generic_category());
+#endif
+        return std::make_error_code(std::errc::io_error);
+    }
+}  // anonymous namespace
+
+fileloader::fileloader(size_t thread_count)
+{
+    // Threads spend much of their time waiting for the disk, so even with only one or two CPUs,
+    // several threads are needed to keep more than one read in progress.
+    if (!thread_count)
+        thread_count = std::max<size_t>(std::thread::hardware_concurrency(), min_default_threads);
+    m_max_threads = thread_count;
+}
+
+fileloader::~fileloader()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_jobs.clear();
+    }
+    m_work_ready.notify_all();
+    for (auto& thread: m_threads)
+        thread.join();
+}
+
+void fileloader::add(std::string_view filename)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.emplace_back(m_added++, ttlib::cstr(filename));
+
+        // There's no point in having more threads than files
+        if (m_threads.size() < m_max_threads && m_threads.size() < m_added - m_returned)
+            m_threads.emplace_back(&fileloader::worker, this);
+    }
+    m_work_ready.notify_one();
+}
+
+bool fileloader::next(result& loaded)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_returned == m_added)
+        return false;
+    m_result_ready.wait(lock, [this] { return !m_results.empty(); });
+
+    loaded = std::move(m_results.front());
+    m_results.pop_front();
+    ++m_returned;
+    return true;
+}
+
+size_t fileloader::pending() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_added - m_returned;
+}
+
+void fileloader::worker()
+{
+    for (;;)
+    {
+        result loaded;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work_ready.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+            if (m_stop)
+                return;
+            loaded.index = m_jobs.front().first;
+            loaded.filename = std::move(m_jobs.front().second);
+            m_jobs.pop_front();
+        }
+
+        // An exception can't be allowed to escape the thread, so running out of memory is
+        // reported the same way as any other error.
+        try
+        {
+            auto file = std::make_unique<ttlib::viewfile>();
+            reset_last_error();
+            if (file->ReadFile(loaded.filename))
+                loaded.file = std::move(file);
+            else
+                loaded.error = last_error();
+        }
+        catch (const std::bad_alloc&)
+        {
+            loaded.file.reset();
+            loaded.error = std::make_error_code(std::errc::not_enough_memory);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_results.push_back(std::move(loaded));
+        }
+        m_result_ready.notify_one();
+    }
+}
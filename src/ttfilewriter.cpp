@@ -0,0 +1,263 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttfilewriter.cpp
+// Purpose:   Buffered file writer that replaces the file atomically
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <cerrno>
+    #include <cstdlib>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include <atomic>
+
+#include "ttfilewriter.h"  // Buffered file writer that replaces the file atomically
+#include "ttlibspace.h"    // ttlib namespace functions and declarations
+
+using namespace ttlib;
+
+namespace
+{
+    // Makes temporary filenames unique within the process -- the process id makes them unique
+    // between processes.
+    std::atomic<unsigned> temp_counter { 0 };
+
+    // Number of names to try before giving up on creating a temporary file
+    constexpr int max_temp_attempts = 100;
+}  // anonymous namespace
+
+bool filewriter::write(std::string_view str)
+{
+    if (m_failed || !is_open())
+        return false;
+
+    if (m_buffer.size() + str.size() > m_buffer_size)
+    {
+        if (!flush())
+            return false;
+
+        // Anything too large to buffer is written directly instead of being copied
+        if (str.size() >= m_buffer_size)
+        {
+            m_failed = !write_all(str.data(), str.size());
+            return !m_failed;
+        }
+    }
+
+    if (m_buffer.capacity() < m_buffer_size)
+        m_buffer.reserve(m_buffer_size);
+    m_buffer.append(str);
+    return true;
+}
+
+bool filewriter::flush()
+{
+    if (!m_buffer.empty())
+    {
+        m_failed = m_failed || !write_all(m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+    }
+    return !m_failed;
+}
+
+#if defined(_WIN32)
+
+bool filewriter::open(std::string_view filename)
+{
+    discard();
+    m_filename.assign(filename);
+    m_failed = false;
+
+    for (int attempt = 0; attempt < max_temp_attempts; ++attempt)
+    {
+        m_tempname = m_filename;
+        m_tempname << ".tmp" << static_cast<size_t>(GetCurrentProcessId()) << '_'
+                   << static_cast<size_t>(temp_counter++);
+        auto handle = CreateFileW(ttlib::utf8to16(m_tempname).c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (handle != INVALID_HANDLE_VALUE)
+        {
+            m_handle = reinterpret_cast<intptr_t>(handle);
+            return true;
+        }
+        if (GetLastError() != ERROR_FILE_EXISTS)
+            break;
+    }
+    m_tempname.clear();
+    return false;
+}
+
+bool filewriter::write_all(const char* data, size_t size) noexcept
+{
+    auto handle = reinterpret_cast<HANDLE>(m_handle);
+    while (size)
+    {
+        // WriteFile() can only write 4GB at a time
+        DWORD chunk = size > 0x40000000 ? 0x40000000 : static_cast<DWORD>(size);
+        DWORD written;
+        if (!::WriteFile(handle, data, chunk, &written, nullptr) || !written)
+            return false;
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+void filewriter::close_handle() noexcept
+{
+    if (is_open())
+    {
+        CloseHandle(reinterpret_cast<HANDLE>(m_handle));
+        m_handle = invalid_handle;
+    }
+}
+
+bool filewriter::commit(bool sync)
+{
+    if (!is_open())
+        return false;
+
+    auto handle = reinterpret_cast<HANDLE>(m_handle);
+    bool ok = flush() && (!sync || FlushFileBuffers(handle));
+    ok = CloseHandle(handle) && ok;
+    m_handle = invalid_handle;
+
+    DWORD flags = MOVEFILE_REPLACE_EXISTING | (sync ? MOVEFILE_WRITE_THROUGH : 0);
+    if (!ok || !MoveFileExW(ttlib::utf8to16(m_tempname).c_str(), ttlib::utf8to16(m_filename).c_str(), flags))
+    {
+        discard();
+        return false;
+    }
+    m_tempname.clear();
+    return true;
+}
+
+void filewriter::discard() noexcept
+{
+    close_handle();
+    if (!m_tempname.empty())
+    {
+        DeleteFileW(ttlib::utf8to16(m_tempname).c_str());
+        m_tempname.clear();
+    }
+    m_buffer.clear();
+}
+
+#else  // not _WIN32
+
+bool filewriter::open(std::string_view filename)
+{
+    discard();
+    m_filename.assign(filename);
+    m_failed = false;
+
+    // Renaming over a symbolic link would replace the link rather than the file it points to
+    struct stat info;
+    bool exists = lstat(m_filename.c_str(), &info) == 0;
+    if (exists && S_ISLNK(info.st_mode))
+    {
+        if (auto target = realpath(m_filename.c_str(), nullptr); target)
+        {
+            m_filename = target;
+            std::free(target);
+        }
+        exists = stat(m_filename.c_str(), &info) == 0;
+    }
+
+    for (int attempt = 0; attempt < max_temp_attempts; ++attempt)
+    {
+        m_tempname = m_filename;
+        m_tempname << ".tmp" << static_cast<size_t>(getpid()) << '_' << static_cast<size_t>(temp_counter++);
+        int fd = ::open(m_tempname.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+        if (fd >= 0)
+        {
+            // The new file keeps the permissions of the file it replaces
+            if (exists)
+                fchmod(fd, info.st_mode & 07777);
+            m_handle = fd;
+            return true;
+        }
+        if (errno != EEXIST)
+            break;
+    }
+    m_tempname.clear();
+    return false;
+}
+
+bool filewriter::write_all(const char* data, size_t size) noexcept
+{
+    while (size)
+    {
+        auto written = ::write(static_cast<int>(m_handle), data, size);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+void filewriter::close_handle() noexcept
+{
+    if (is_open())
+    {
+        ::close(static_cast<int>(m_handle));
+        m_handle = invalid_handle;
+    }
+}
+
+bool filewriter::commit(bool sync)
+{
+    if (!is_open())
+        return false;
+
+    int fd = static_cast<int>(m_handle);
+    bool ok = flush() && (!sync || fsync(fd) == 0);
+    ok = ::close(fd) == 0 && ok;
+    m_handle = invalid_handle;
+
+    if (!ok || rename(m_tempname.c_str(), m_filename.c_str()) != 0)
+    {
+        discard();
+        return false;
+    }
+    m_tempname.clear();
+
+    if (sync)
+    {
+        // The rename itself isn't durable until the directory has been flushed
+        auto slash = m_filename.find_last_of('/');
+        std::string dir = (slash == tt::npos) ? std::string(".") : m_filename.substr(0, slash ? slash : 1);
+        int dir_fd = ::open(dir.c_str(), O_RDONLY | O_CLOEXEC);
+        if (dir_fd >= 0)
+        {
+            fsync(dir_fd);
+            ::close(dir_fd);
+        }
+    }
+    return true;
+}
+
+void filewriter::discard() noexcept
+{
+    close_handle();
+    if (!m_tempname.empty())
+    {
+        unlink(m_tempname.c_str());
+        m_tempname.clear();
+    }
+    m_buffer.clear();
+}
+
+#endif  // _WIN32
@@ -0,0 +1,904 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttformat.cpp
+// Purpose:   Type-safe printf-style formatting without intermediate allocations
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+// The formatter is a template on its output so that the same code can append to a std::string or
+// fill a fixed-size buffer. Literal text between conversions is written in a single call, and every
+// converted value is built in a small stack buffer before being written with its padding.
+
+#include <cassert>
+#include <charconv>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <locale>
+
+#include "ttformat.h"  // Type-safe printf-style formatting without intermediate allocations
+
+using namespace ttlib;
+
+namespace
+{
+    // Output is collected in a stack buffer so that most strings are appended with a single call. flush()
+    // must be called when formatting is complete.
+    class STRING_OUTPUT
+    {
+    public:
+        STRING_OUTPUT(std::string& dest) : m_dest(dest) {}
+
+        void write(const char* text, size_t length)
+        {
+            // An empty string_view can have a null data() pointer, which memcpy() doesn't allow
+            if (!length)
+                return;
+            if (length > sizeof(m_buffer) - m_used)
+            {
+                flush();
+                if (length > sizeof(m_buffer))
+                {
+                    m_dest.append(text, length);
+                    return;
+                }
+            }
+            std::memcpy(m_buffer + m_used, text, length);
+            m_used += length;
+        }
+
+        void fill(char ch, size_t count)
+        {
+            if (count > sizeof(m_buffer) - m_used)
+            {
+                flush();
+                if (count > sizeof(m_buffer))
+                {
+                    m_dest.append(count, ch);
+                    return;
+                }
+            }
+            std::memset(m_buffer + m_used, ch, count);
+            m_used += count;
+        }
+
+        void flush()
+        {
+            m_dest.append(m_buffer, m_used);
+            m_used = 0;
+        }
+
+    private:
+        std::string& m_dest;
+        char m_buffer[256];
+        size_t m_used { 0 };
+    };
+
+    class BUFFER_OUTPUT
+    {
+    public:
+        // size must already have room reserved for a trailing zero
+        BUFFER_OUTPUT(char* buffer, size_t size) : m_buffer(buffer), m_size(size) {}
+
+        void write(const char* text, size_t length)
+        {
+            if (!length)
+                return;
+            if (m_total < m_size)
+                std::memcpy(m_buffer + m_total, text, (length < m_size - m_total) ? length : m_size - m_total);
+            m_total += length;
+        }
+
+        void fill(char ch, size_t count)
+        {
+            if (m_total < m_size)
+                std::memset(m_buffer + m_total, ch, (count < m_size - m_total) ? count : m_size - m_total);
+            m_total += count;
+        }
+
+        size_t total() const noexcept { return m_total; }
+
+    private:
+        char* m_buffer;
+        size_t m_size;
+        size_t m_total { 0 };
+    };
+
+    struct SPEC
+    {
+        size_t width { 0 };
+        size_t precision { static_cast<size_t>(-1) };
+        size_t int_size { 0 };  // non-zero if h or hh was specified
+        bool left { false };
+        bool zero { false };
+        bool plus { false };   // '+' -- positive numbers start with '+'
+        bool space { false };  // ' ' -- positive numbers start with a space
+        bool alt { false };    // '#' -- octal starts with 0, hex with 0x, floating point always has a '.'
+        bool kflag { false };
+        bool zflag { false };
+        char conversion { 0 };
+    };
+
+    struct GROUPING
+    {
+        char separator { ',' };
+        std::string sizes { "\3" };
+    };
+
+    // The locale is only queried the first time a %k conversion is used
+    const GROUPING& locale_grouping()
+    {
+        static const GROUPING grouping = []()
+        {
+            GROUPING result;
+            try
+            {
+                auto& punct = std::use_facet<std::numpunct<char>>(std::locale(""));
+                // Some locales (including "C") don't specify grouping, in which case the default is
+                // used since %k asked for grouping.
+                if (!punct.grouping().empty() && punct.grouping()[0] > 0)
+                {
+                    result.separator = punct.thousands_sep();
+                    result.sizes = punct.grouping();
+                }
+            }
+            catch (const std::exception& /* e */)
+            {
+            }
+            return result;
+        }();
+        return grouping;
+    }
+
+    // Inserts the locale's thousands separator into digits (which has no sign). The buffer must have
+    // room for the additional separators.
+    size_t group_digits(char* digits, size_t count)
+    {
+        auto& grouping = locale_grouping();
+
+        // Find out how many separators are needed
+        size_t separators = 0;
+        size_t remaining = count;
+        size_t group_idx = 0;
+        for (;;)
+        {
+            auto group = static_cast<unsigned char>(grouping.sizes[group_idx]);
+            if (group == 0 || group == CHAR_MAX || remaining <= group)
+                break;
+            remaining -= group;
+            ++separators;
+            if (group_idx + 1 < grouping.sizes.size())
+                ++group_idx;
+        }
+        if (!separators)
+            return count;
+
+        // Copy from the end, inserting separators
+        auto src = digits + count;
+        auto dst = digits + count + separators;
+        group_idx = 0;
+        for (size_t sep = 0; sep < separators; ++sep)
+        {
+            auto group = static_cast<unsigned char>(grouping.sizes[group_idx]);
+            for (size_t idx = 0; idx < group; ++idx)
+                *--dst = *--src;
+            *--dst = grouping.separator;
+            if (group_idx + 1 < grouping.sizes.size())
+                ++group_idx;
+        }
+        return count + separators;
+    }
+
+    constexpr char digit_pairs[] = "00010203040506070809"
+                                   "10111213141516171819"
+                                   "20212223242526272829"
+                                   "30313233343536373839"
+                                   "40414243444546474849"
+                                   "50515253545556575859"
+                                   "60616263646566676869"
+                                   "70717273747576777879"
+                                   "80818283848586878889"
+                                   "90919293949596979899";
+
+    size_t count_digits(uint64_t value) noexcept
+    {
+        size_t count = 1;
+        for (;;)
+        {
+            if (value < 10)
+                return count;
+            if (value < 100)
+                return count + 1;
+            if (value < 1000)
+                return count + 2;
+            if (value < 10000)
+                return count + 3;
+            value /= 10000;
+            count += 4;
+        }
+    }
+
+    // Writes the decimal digits of value and returns the number of digits written. Two digits are
+    // converted for each division.
+    size_t write_decimal(char* buffer, uint64_t value) noexcept
+    {
+        auto count = count_digits(value);
+        auto ptr = buffer + count;
+        while (value >= 100)
+        {
+            auto pair = static_cast<size_t>(value % 100) * 2;
+            value /= 100;
+            ptr -= 2;
+            ptr[0] = digit_pairs[pair];
+            ptr[1] = digit_pairs[pair + 1];
+        }
+        if (value >= 10)
+        {
+            ptr[-2] = digit_pairs[value * 2];
+            ptr[-1] = digit_pairs[value * 2 + 1];
+        }
+        else
+        {
+            ptr[-1] = static_cast<char>('0' + value);
+        }
+        return count;
+    }
+
+    size_t write_hex(char* buffer, uint64_t value, bool upper) noexcept
+    {
+        auto digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+        size_t count = 1;
+        for (auto remaining = value >> 4; remaining; remaining >>= 4)
+            ++count;
+        for (auto ptr = buffer + count; ptr > buffer; value >>= 4)
+            *--ptr = digits[value & 0xF];
+        return count;
+    }
+
+    template <typename OUTPUT>
+    void write_padded(OUTPUT& out, const SPEC& spec, const char* text, size_t length)
+    {
+        if (spec.width > length && !spec.left)
+            out.fill(' ', spec.width - length);
+        out.write(text, length);
+        if (spec.width > length && spec.left)
+            out.fill(' ', spec.width - length);
+    }
+
+    // prefix (a sign or "0x") is written before any zero padding. zeros is the number of zeros needed
+    // to give an integer the minimum number of digits set by its precision.
+    template <typename OUTPUT>
+    void write_number(OUTPUT& out, const SPEC& spec, std::string_view prefix, size_t zeros, const char* digits,
+                      size_t length)
+    {
+        auto total = prefix.size() + zeros + length;
+        if (spec.width <= total)
+        {
+            out.write(prefix.data(), prefix.size());
+            out.fill('0', zeros);
+            out.write(digits, length);
+        }
+        else if (spec.left)
+        {
+            out.write(prefix.data(), prefix.size());
+            out.fill('0', zeros);
+            out.write(digits, length);
+            out.fill(' ', spec.width - total);
+        }
+        else if (spec.zero)
+        {
+            out.write(prefix.data(), prefix.size());
+            out.fill('0', spec.width - total + zeros);
+            out.write(digits, length);
+        }
+        else
+        {
+            out.fill(' ', spec.width - total);
+            out.write(prefix.data(), prefix.size());
+            out.fill('0', zeros);
+            out.write(digits, length);
+        }
+    }
+
+    // Returns the sign to write before a number that isn't negative
+    std::string_view positive_sign(const SPEC& spec) noexcept
+    {
+        return spec.plus ? "+" : spec.space ? " " : "";
+    }
+
+    // Returns the number of bytes written to dest (which must have room for 4)
+    size_t encode_utf8(uint32_t code, char* dest)
+    {
+        if (code < 0x80)
+        {
+            dest[0] = static_cast<char>(code);
+            return 1;
+        }
+        else if (code < 0x800)
+        {
+            dest[0] = static_cast<char>(0xC0 | (code >> 6));
+            dest[1] = static_cast<char>(0x80 | (code & 0x3F));
+            return 2;
+        }
+        else if (code < 0x10000)
+        {
+            dest[0] = static_cast<char>(0xE0 | (code >> 12));
+            dest[1] = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            dest[2] = static_cast<char>(0x80 | (code & 0x3F));
+            return 3;
+        }
+        else if (code < 0x110000)
+        {
+            dest[0] = static_cast<char>(0xF0 | (code >> 18));
+            dest[1] = static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            dest[2] = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            dest[3] = static_cast<char>(0x80 | (code & 0x3F));
+            return 4;
+        }
+
+        // Replacement character
+        dest[0] = static_cast<char>(0xEF);
+        dest[1] = static_cast<char>(0xBF);
+        dest[2] = static_cast<char>(0xBD);
+        return 3;
+    }
+
+    // Returns the next code point in str, advancing pos past it. Surrogate pairs are combined when
+    // wchar_t is 16 bits.
+    uint32_t next_code_point(std::wstring_view str, size_t& pos)
+    {
+        uint32_t code = static_cast<uint32_t>(str[pos++]);
+        if constexpr (sizeof(wchar_t) == 2)
+        {
+            code &= 0xFFFF;
+            if (code >= 0xD800 && code < 0xDC00 && pos < str.size())
+            {
+                auto low = static_cast<uint32_t>(str[pos]) & 0xFFFF;
+                if (low >= 0xDC00 && low < 0xE000)
+                {
+                    ++pos;
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+            }
+        }
+        return code;
+    }
+
+    // Writes str in quotes, escaping quotes and backslashes the same way std::quoted() does.
+    template <typename OUTPUT>
+    void write_quoted(OUTPUT& out, std::string_view str)
+    {
+        out.write("\"", 1);
+        size_t start = 0;
+        for (size_t pos = 0; pos < str.size(); ++pos)
+        {
+            if (str[pos] == '"' || str[pos] == '\\')
+            {
+                out.write(str.data() + start, pos - start);
+                out.write("\\", 1);
+                start = pos;
+            }
+        }
+        out.write(str.data() + start, str.size() - start);
+        out.write("\"", 1);
+    }
+
+    template <typename OUTPUT>
+    void format_string(OUTPUT& out, const SPEC& spec, std::string_view str)
+    {
+        if (spec.precision < str.size())
+            str = str.substr(0, spec.precision);
+
+        size_t length = str.size();
+        if (spec.kflag)
+        {
+            length += 2;
+            for (auto ch: str)
+            {
+                if (ch == '"' || ch == '\\')
+                    ++length;
+            }
+        }
+
+        if (spec.width > length && !spec.left)
+            out.fill(' ', spec.width - length);
+        if (spec.kflag)
+            write_quoted(out, str);
+        else
+            out.write(str.data(), str.size());
+        if (spec.width > length && spec.left)
+            out.fill(' ', spec.width - length);
+    }
+
+    template <typename OUTPUT>
+    void format_wstring(OUTPUT& out, const SPEC& spec, std::wstring_view str)
+    {
+        // Convert in pieces small enough to keep on the stack. Padding and quoting require the
+        // entire string, so those are handled by a first pass that only computes the length.
+        char buffer[256];
+        if (spec.width || spec.kflag || spec.precision != static_cast<size_t>(-1))
+        {
+            size_t length = 0;
+            for (size_t pos = 0; pos < str.size();)
+            {
+                char utf8[4];
+                auto start = pos;
+                auto bytes = encode_utf8(next_code_point(str, pos), utf8);
+                if (length + bytes > spec.precision)
+                {
+                    str = str.substr(0, start);
+                    break;
+                }
+                length += bytes;
+                if (spec.kflag && (utf8[0] == '"' || utf8[0] == '\\'))
+                    ++length;
+            }
+            if (spec.kflag)
+                length += 2;
+            if (spec.width > length && !spec.left)
+                out.fill(' ', spec.width - length);
+            if (spec.kflag)
+                out.write("\"", 1);
+
+            size_t used = 0;
+            for (size_t pos = 0; pos < str.size();)
+            {
+                if (used + 5 > sizeof(buffer))
+                {
+                    out.write(buffer, used);
+                    used = 0;
+                }
+                auto code = next_code_point(str, pos);
+                if (spec.kflag && (code == '"' || code == '\\'))
+                    buffer[used++] = '\\';
+                used += encode_utf8(code, buffer + used);
+            }
+            out.write(buffer, used);
+
+            if (spec.kflag)
+                out.write("\"", 1);
+            if (spec.width > length && spec.left)
+                out.fill(' ', spec.width - length);
+            return;
+        }
+
+        size_t used = 0;
+        for (size_t pos = 0; pos < str.size();)
+        {
+            if (used + 4 > sizeof(buffer))
+            {
+                out.write(buffer, used);
+                used = 0;
+            }
+            used += encode_utf8(next_code_point(str, pos), buffer + used);
+        }
+        out.write(buffer, used);
+    }
+
+    template <typename OUTPUT>
+    void format_integer(OUTPUT& out, const SPEC& spec, const format_arg& arg)
+    {
+        // Enough for 64-bit octal, or 64-bit decimal with a separator between every digit
+        char buffer[48];
+        std::string_view prefix;
+
+        uint64_t value;
+        bool negative = false;
+        auto int_size = spec.int_size ? spec.int_size : arg.size();
+        if (arg.type() == format_arg::type_signed)
+        {
+            auto signed_value = arg.as_signed();
+            if (int_size == 1)
+                signed_value = static_cast<int8_t>(signed_value);
+            else if (int_size == 2)
+                signed_value = static_cast<int16_t>(signed_value);
+            negative = signed_value < 0;
+            value = negative ? 0 - static_cast<uint64_t>(signed_value) : static_cast<uint64_t>(signed_value);
+        }
+        else
+        {
+            value = arg.as_unsigned();
+        }
+
+        switch (spec.conversion)
+        {
+            case 'o':
+            case 'x':
+            case 'X':
+                // Negative values are displayed as the unsigned value of the original type
+                if (negative)
+                    value = 0 - value;
+                if (int_size && int_size < sizeof(value))
+                    value &= (static_cast<uint64_t>(1) << (int_size * 8)) - 1;
+                negative = false;
+                break;
+
+            case 'u':
+                if (negative)
+                    value = 0 - value;
+                if (int_size && int_size < sizeof(value))
+                    value &= (static_cast<uint64_t>(1) << (int_size * 8)) - 1;
+                negative = false;
+                break;
+
+            default:
+                prefix = negative ? "-" : positive_sign(spec);
+                break;
+        }
+
+        if (spec.zflag && value == static_cast<uint64_t>(static_cast<size_t>(-1)))
+        {
+            write_padded(out, spec, "-1", 2);
+            return;
+        }
+
+        size_t length;
+        if (spec.precision == 0 && value == 0)
+        {
+            // As with printf, a precision of zero displays a zero value as no digits at all
+            length = 0;
+        }
+        else if (spec.conversion == 'o')
+        {
+            length = static_cast<size_t>(std::to_chars(buffer, buffer + 24, value, 8).ptr - buffer);
+        }
+        else if (spec.conversion == 'x' || spec.conversion == 'X')
+        {
+            length = write_hex(buffer, value, spec.conversion == 'X');
+            if (spec.alt && value)
+                prefix = (spec.conversion == 'X') ? "0X" : "0x";
+        }
+        else
+        {
+            length = write_decimal(buffer, value);
+            if (spec.kflag)
+                length = group_digits(buffer, length);
+        }
+
+        // The precision is the minimum number of digits, and when it is specified the '0' flag is ignored
+        size_t zeros = 0;
+        SPEC number_spec = spec;
+        if (spec.precision != static_cast<size_t>(-1))
+        {
+            if (spec.precision > length)
+                zeros = spec.precision - length;
+            number_spec.zero = false;
+        }
+        if (spec.alt && spec.conversion == 'o' && !zeros && (!length || buffer[0] != '0'))
+            zeros = 1;
+
+        write_number(out, number_spec, prefix, zeros, buffer, length);
+    }
+
+    template <typename OUTPUT>
+    void format_double(OUTPUT& out, const SPEC& spec, double value)
+    {
+        char conversion = spec.conversion;
+        if (conversion != 'f' && conversion != 'F' && conversion != 'e' && conversion != 'E' && conversion != 'G')
+            conversion = 'g';
+        // Limiting the precision ensures that even the largest double fits in the buffer
+        int precision = -1;
+        if (spec.precision != static_cast<size_t>(-1))
+            precision = static_cast<int>(spec.precision < 100 ? spec.precision : 100);
+
+        char format[8] = { '%' };
+        size_t format_len = 1;
+        if (spec.alt)
+            format[format_len++] = '#';
+        if (precision >= 0)
+        {
+            format[format_len++] = '.';
+            format[format_len++] = '*';
+        }
+        format[format_len++] = conversion;
+
+        char buffer[512];
+        int length = (precision < 0) ? std::snprintf(buffer, sizeof(buffer), format, value) :
+                                       std::snprintf(buffer, sizeof(buffer), format, precision, value);
+        if (length < 0)
+            return;
+
+        std::string_view sign = positive_sign(spec);
+        const char* digits = buffer;
+        if (buffer[0] == '-')
+        {
+            sign = "-";
+            ++digits;
+            --length;
+        }
+
+        // Zero padding doesn't make sense for inf or nan
+        SPEC number_spec = spec;
+        if (!(digits[0] >= '0' && digits[0] <= '9'))
+            number_spec.zero = false;
+        write_number(out, number_spec, sign, 0, digits, static_cast<size_t>(length));
+    }
+
+    template <typename OUTPUT>
+    void format_pointer(OUTPUT& out, const SPEC& spec, const void* ptr)
+    {
+        char buffer[24] = { '0', 'x' };
+        auto result = std::to_chars(buffer + 2, buffer + sizeof(buffer), reinterpret_cast<uintptr_t>(ptr), 16);
+        write_padded(out, spec, buffer, static_cast<size_t>(result.ptr - buffer));
+    }
+
+    template <typename OUTPUT>
+    void format_char(OUTPUT& out, const SPEC& spec, const format_arg& arg)
+    {
+        char buffer[4];
+        size_t length = 1;
+        switch (arg.type())
+        {
+            case format_arg::type_char:
+                buffer[0] = arg.as_char();
+                break;
+
+            case format_arg::type_signed:
+                // A single-byte integer (e.g., int8_t or unsigned char) is written as that byte, the
+                // same as a char
+                if (arg.size() == 1 || arg.as_signed() < 0)
+                    buffer[0] = static_cast<char>(arg.as_signed());
+                else
+                    length = encode_utf8(static_cast<uint32_t>(arg.as_signed()), buffer);
+                break;
+
+            default:
+                if (arg.size() == 1)
+                    buffer[0] = static_cast<char>(arg.as_unsigned());
+                else
+                    length = encode_utf8(static_cast<uint32_t>(arg.as_unsigned()), buffer);
+                break;
+        }
+        write_padded(out, spec, buffer, length);
+    }
+
+    template <typename OUTPUT>
+    void format_arg_value(OUTPUT& out, const SPEC& spec, const format_arg& arg)
+    {
+        const char conversion = spec.conversion;
+        switch (arg.type())
+        {
+            case format_arg::type_signed:
+            case format_arg::type_unsigned:
+                if (conversion == 'c')
+                    format_char(out, spec, arg);
+                else if (conversion == 'f' || conversion == 'F' || conversion == 'e' || conversion == 'E' ||
+                         conversion == 'g' || conversion == 'G')
+                    format_double(out, spec,
+                                  arg.type() == format_arg::type_signed ? static_cast<double>(arg.as_signed()) :
+                                                                          static_cast<double>(arg.as_unsigned()));
+                else if (conversion == 'p')
+                    format_pointer(out, spec, reinterpret_cast<const void*>(static_cast<uintptr_t>(arg.as_unsigned())));
+                else
+                    format_integer(out, spec, arg);
+                break;
+
+            case format_arg::type_char:
+            case format_arg::type_wchar:
+                if (conversion == 'd' || conversion == 'i' || conversion == 'u' || conversion == 'o' ||
+                    conversion == 'x' || conversion == 'X')
+                {
+                    format_arg number = (arg.type() == format_arg::type_char) ?
+                                            format_arg(static_cast<signed char>(arg.as_char())) :
+                                            format_arg(static_cast<uint32_t>(arg.as_unsigned()));
+                    format_integer(out, spec, number);
+                }
+                else
+                {
+                    format_char(out, spec, arg);
+                }
+                break;
+
+            case format_arg::type_string:
+                format_string(out, spec, arg.as_string());
+                break;
+
+            case format_arg::type_wstring:
+                format_wstring(out, spec, arg.as_wstring());
+                break;
+
+            case format_arg::type_double:
+                format_double(out, spec, arg.as_double());
+                break;
+
+            case format_arg::type_pointer:
+                format_pointer(out, spec, arg.as_pointer());
+                break;
+
+            case format_arg::type_none:
+                break;
+        }
+    }
+
+    template <typename OUTPUT>
+    void format_impl(OUTPUT& out, std::string_view format, const format_arg* args, size_t count)
+    {
+        size_t arg_idx = 0;
+        size_t pos = 0;
+        while (pos < format.size())
+        {
+            auto percent = format.find('%', pos);
+            if (percent == std::string_view::npos)
+            {
+                out.write(format.data() + pos, format.size() - pos);
+                return;
+            }
+            out.write(format.data() + pos, percent - pos);
+            pos = percent + 1;
+            if (pos >= format.size())
+            {
+                assert(!"Format string ends with '%'");
+                return;
+            }
+
+            if (format[pos] == '%')
+            {
+                out.write("%", 1);
+                ++pos;
+                continue;
+            }
+
+            SPEC spec;
+            for (; pos < format.size(); ++pos)
+            {
+                if (format[pos] == 'k')
+                    spec.kflag = true;
+                else if (format[pos] == '-')
+                    spec.left = true;
+                else if (format[pos] == '0')
+                    spec.zero = true;
+                else if (format[pos] == '+')
+                    spec.plus = true;
+                else if (format[pos] == ' ')
+                    spec.space = true;
+                else if (format[pos] == '#')
+                    spec.alt = true;
+                else
+                    break;
+            }
+
+            // Length modifiers were documented as appearing before the field width
+            for (; pos < format.size(); ++pos)
+            {
+                auto ch = format[pos];
+                if (ch == 'h')
+                    spec.int_size = spec.int_size ? 1 : 2;
+                else if (ch == 'z')
+                    spec.zflag = true;
+                else if (ch != 'l' && ch != 'j' && ch != 't' && ch != 'L')
+                    break;
+            }
+
+            if (pos < format.size() && format[pos] == '-')
+            {
+                spec.left = true;
+                ++pos;
+            }
+            if (pos < format.size() && format[pos] == '0')
+            {
+                spec.zero = true;
+                ++pos;
+            }
+            for (; pos < format.size() && format[pos] >= '0' && format[pos] <= '9'; ++pos)
+                spec.width = spec.width * 10 + static_cast<size_t>(format[pos] - '0');
+
+            if (pos < format.size() && format[pos] == '.')
+            {
+                spec.precision = 0;
+                for (++pos; pos < format.size() && format[pos] >= '0' && format[pos] <= '9'; ++pos)
+                    spec.precision = spec.precision * 10 + static_cast<size_t>(format[pos] - '0');
+            }
+
+            for (; pos < format.size(); ++pos)
+            {
+                auto ch = format[pos];
+                if (ch == 'h')
+                    spec.int_size = spec.int_size ? 1 : 2;
+                else if (ch == 'z')
+                    spec.zflag = true;
+                else if (ch != 'l' && ch != 'j' && ch != 't' && ch != 'L')
+                    break;
+            }
+
+            if (pos >= format.size())
+            {
+                assert(!"Incomplete format specification");
+                return;
+            }
+            spec.conversion = format[pos++];
+            // Unsupported conversions are ignored, and do not use an argument
+            if (!std::strchr("csvdiuoxXpfFeEgG", spec.conversion))
+                continue;
+
+            if (arg_idx >= count)
+            {
+                assert(!"Not enough arguments for format string");
+                continue;
+            }
+            format_arg_value(out, spec, args[arg_idx++]);
+        }
+    }
+
+    // Returns true if any string argument points into dest's buffer
+    bool is_aliased(const std::string& dest, std::string_view format, const format_arg* args, size_t count)
+    {
+        auto begin = dest.data();
+        auto end = dest.data() + dest.capacity();
+        auto overlaps = [begin, end](const void* ptr)
+        {
+            auto chars = static_cast<const char*>(ptr);
+            return !std::less<const char*>()(chars, begin) && std::less<const char*>()(chars, end);
+        };
+
+        if (overlaps(format.data()))
+            return true;
+        for (size_t idx = 0; idx < count; ++idx)
+        {
+            if (args[idx].type() == format_arg::type_string && overlaps(args[idx].as_string().data()))
+                return true;
+        }
+        return false;
+    }
+}  // anonymous namespace
+
+void ttlib::vformat_append(std::string& dest, std::string_view format, const format_arg* args, size_t count)
+{
+    if (is_aliased(dest, format, args, count))
+    {
+        std::string result;
+        STRING_OUTPUT out(result);
+        format_impl(out, format, args, count);
+        out.flush();
+        dest += result;
+        return;
+    }
+
+    STRING_OUTPUT out(dest);
+    format_impl(out, format, args, count);
+    out.flush();
+}
+
+void ttlib::vformat_assign(std::string& dest, std::string_view format, const format_arg* args, size_t count)
+{
+    if (is_aliased(dest, format, args, count))
+    {
+        std::string result;
+        STRING_OUTPUT out(result);
+        format_impl(out, format, args, count);
+        out.flush();
+        dest = std::move(result);
+        return;
+    }
+
+    dest.clear();
+    STRING_OUTPUT out(dest);
+    format_impl(out, format, args, count);
+    out.flush();
+}
+
+size_t ttlib::vformat_to(char* buffer, size_t size, std::string_view format, const format_arg* args,
+                         size_t count) noexcept
+{
+    BUFFER_OUTPUT out(buffer, size ? size - 1 : 0);
+    format_impl(out, format, args, count);
+    if (size)
+        buffer[out.total() < size ? out.total() : size - 1] = 0;
+    return out.total();
+}
+
+char* ttlib::itoa_digits(char* buffer, uint64_t value, bool negative, bool format) noexcept
+{
+    if (negative)
+        *buffer++ = '-';
+    auto length = write_decimal(buffer, value);
+    if (format)
+        length = group_digits(buffer, length);
+    return buffer + length;
+}
+
+char* ttlib::hextoa_digits(char* buffer, uint64_t value, bool upper) noexcept
+{
+    return buffer + write_hex(buffer, value, upper);
+}
@@ -0,0 +1,269 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      tthash.cpp
+// Purpose:   Seeded 64-bit string hash and incremental hasher
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+// The algorithm is wyhash (final version 4) by Wang Yi, which has been placed in the public domain.
+// Input longer than 48 bytes is processed in 48-byte blocks using three independent lanes so that
+// the multiplies can overlap. Whatever is left is processed 16 bytes at a time, and the final 16
+// bytes of the input (which may overlap data that was already processed) are mixed with the
+// length to produce the result.
+
+#include <cstring>
+
+#include "tthash.h"  // Seeded 64-bit string hash and incremental hasher
+#include "ttsimd.h"  // fold_ascii()
+
+#if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h>
+#endif
+
+using namespace ttlib;
+
+namespace
+{
+    // Shared with tt::hash64() so that compile-time hashes match
+    using tt::hash_detail::secret;
+
+    // Replaces a and b with the low and high 64 bits of a * b
+    inline void multiply(uint64_t& a, uint64_t& b) noexcept
+    {
+#if defined(__SIZEOF_INT128__)
+        __uint128_t result = a;
+        result *= b;
+        a = static_cast<uint64_t>(result);
+        b = static_cast<uint64_t>(result >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        a = _umul128(a, b, &b);
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+        uint64_t high = __umulh(a, b);
+        a = a * b;
+        b = high;
+#else
+        uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a), lb = static_cast<uint32_t>(b);
+        uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+        uint64_t c = t < rl;
+        uint64_t lo = t + (rm1 << 32);
+        c += lo < t;
+        uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+        a = lo;
+        b = hi;
+#endif
+    }
+
+    inline uint64_t mix(uint64_t a, uint64_t b) noexcept
+    {
+        multiply(a, b);
+        return a ^ b;
+    }
+
+    // The hash is defined using little-endian reads. memcpy() compiles into a single load.
+    inline uint64_t read64(const unsigned char* ptr) noexcept
+    {
+        uint64_t value;
+        std::memcpy(&value, ptr, sizeof(value));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+        value = __builtin_bswap64(value);
+#endif
+        return value;
+    }
+
+    inline uint64_t read32(const unsigned char* ptr) noexcept
+    {
+        uint32_t value;
+        std::memcpy(&value, ptr, sizeof(value));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+        value = __builtin_bswap32(value);
+#endif
+        return value;
+    }
+
+    inline uint64_t read_small(const unsigned char* ptr, size_t length) noexcept
+    {
+        return (static_cast<uint64_t>(ptr[0]) << 16) | (static_cast<uint64_t>(ptr[length >> 1]) << 8) | ptr[length - 1];
+    }
+
+    inline uint64_t initial_seed(uint64_t seed) noexcept
+    {
+        return seed ^ mix(seed ^ secret[0], secret[1]);
+    }
+
+    // Hashes input of 16 bytes or less
+    inline void read_short(const unsigned char* ptr, size_t length, uint64_t& a, uint64_t& b) noexcept
+    {
+        if (length >= 4)
+        {
+            a = (read32(ptr) << 32) | read32(ptr + ((length >> 3) << 2));
+            b = (read32(ptr + length - 4) << 32) | read32(ptr + length - 4 - ((length >> 3) << 2));
+        }
+        else if (length > 0)
+        {
+            a = read_small(ptr, length);
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+    }
+
+    inline uint64_t finish(uint64_t a, uint64_t b, uint64_t seed, uint64_t length) noexcept
+    {
+        a ^= secret[1];
+        b ^= seed;
+        multiply(a, b);
+        return mix(a ^ secret[0] ^ length, b ^ secret[1]);
+    }
+}  // anonymous namespace
+
+uint64_t ttlib::get_hash64(std::string_view str, uint64_t seed) noexcept
+{
+    auto ptr = reinterpret_cast<const unsigned char*>(str.data());
+    size_t length = str.size();
+    seed = initial_seed(seed);
+
+    uint64_t a, b;
+    if (length <= 16)
+    {
+        read_short(ptr, length, a, b);
+    }
+    else
+    {
+        size_t remaining = length;
+        if (remaining > 48)
+        {
+            uint64_t see1 = seed, see2 = seed;
+            do
+            {
+                seed = mix(read64(ptr) ^ secret[1], read64(ptr + 8) ^ seed);
+                see1 = mix(read64(ptr + 16) ^ secret[2], read64(ptr + 24) ^ see1);
+                see2 = mix(read64(ptr + 32) ^ secret[3], read64(ptr + 40) ^ see2);
+                ptr += 48;
+                remaining -= 48;
+            } while (remaining > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (remaining > 16)
+        {
+            seed = mix(read64(ptr) ^ secret[1], read64(ptr + 8) ^ seed);
+            ptr += 16;
+            remaining -= 16;
+        }
+        a = read64(ptr + remaining - 16);
+        b = read64(ptr + remaining - 8);
+    }
+    return finish(a, b, seed, length);
+}
+
+uint64_t ttlib::get_hash64_nocase(std::string_view str, uint64_t seed) noexcept
+{
+    // Fold into a stack buffer one piece at a time. Most strings fit in a single piece, which can be
+    // hashed directly.
+    unsigned char folded[256];
+    auto ptr = reinterpret_cast<const unsigned char*>(str.data());
+    if (str.size() <= sizeof(folded))
+    {
+        for (size_t idx = 0; idx < str.size(); ++idx)
+            folded[idx] = fold_ascii(ptr[idx]);
+        return get_hash64(std::string_view(reinterpret_cast<const char*>(folded), str.size()), seed);
+    }
+
+    hasher hash(seed);
+    for (size_t remaining = str.size(); remaining;)
+    {
+        auto count = (remaining < sizeof(folded)) ? remaining : sizeof(folded);
+        for (size_t idx = 0; idx < count; ++idx)
+            folded[idx] = fold_ascii(ptr[idx]);
+        hash.update(folded, count);
+        ptr += count;
+        remaining -= count;
+    }
+    return hash.digest();
+}
+
+void hasher::reset(uint64_t seed) noexcept
+{
+    m_seed = initial_seed(seed);
+    m_see1 = m_seed;
+    m_see2 = m_seed;
+    m_total = 0;
+    m_buf_len = 0;
+}
+
+void hasher::process_block(const unsigned char* block) noexcept
+{
+    m_seed = mix(read64(block) ^ secret[1], read64(block + 8) ^ m_seed);
+    m_see1 = mix(read64(block + 16) ^ secret[2], read64(block + 24) ^ m_see1);
+    m_see2 = mix(read64(block + 32) ^ secret[3], read64(block + 40) ^ m_see2);
+}
+
+void hasher::update(const void* data, size_t length) noexcept
+{
+    auto ptr = static_cast<const unsigned char*>(data);
+    m_total += length;
+
+    if (m_buf_len)
+    {
+        auto copy = (length < sizeof(m_buffer) - m_buf_len) ? length : sizeof(m_buffer) - m_buf_len;
+        std::memcpy(m_buffer + m_buf_len, ptr, copy);
+        m_buf_len += copy;
+        ptr += copy;
+        length -= copy;
+
+        // The block can only be processed if there is more input after it
+        if (!length)
+            return;
+        process_block(m_buffer);
+        std::memcpy(m_last, m_buffer + sizeof(m_buffer) - sizeof(m_last), sizeof(m_last));
+        m_buf_len = 0;
+    }
+
+    if (length > sizeof(m_buffer))
+    {
+        do
+        {
+            process_block(ptr);
+            ptr += sizeof(m_buffer);
+            length -= sizeof(m_buffer);
+        } while (length > sizeof(m_buffer));
+        std::memcpy(m_last, ptr - sizeof(m_last), sizeof(m_last));
+    }
+
+    std::memcpy(m_buffer, ptr, length);
+    m_buf_len = length;
+}
+
+uint64_t hasher::digest() const noexcept
+{
+    uint64_t a, b;
+    if (m_total <= 16)
+    {
+        read_short(m_buffer, m_buf_len, a, b);
+        return finish(a, b, m_seed, m_total);
+    }
+
+    uint64_t seed = m_seed;
+    if (m_total > sizeof(m_buffer))
+        seed ^= m_see1 ^ m_see2;
+
+    // Place the end of the previous block in front of the remaining input so that the final 16 bytes
+    // can always be read from one place.
+    unsigned char tail[sizeof(m_last) + sizeof(m_buffer)];
+    std::memcpy(tail, m_last, sizeof(m_last));
+    std::memcpy(tail + sizeof(m_last), m_buffer, m_buf_len);
+
+    const unsigned char* ptr = tail + sizeof(m_last);
+    size_t remaining = m_buf_len;
+    while (remaining > 16)
+    {
+        seed = mix(read64(ptr) ^ secret[1], read64(ptr + 8) ^ seed);
+        ptr += 16;
+        remaining -= 16;
+    }
+    a = read64(ptr + remaining - 16);
+    b = read64(ptr + remaining - 8);
+    return finish(a, b, seed, m_total);
+}
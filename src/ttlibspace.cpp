@@ -8,11 +8,12 @@
 
 #include <cassert>
 #include <cctype>
-#include <locale>
 
 #include "ttcstr.h"
 #include "ttcview.h"
 #include "ttlibspace.h"
+#include "ttnumparse.h"  // Fast integer and floating-point parsing over string views
+#include "ttsimd.h"
 
 using namespace ttlib;
 using namespace tt;
@@ -49,15 +50,8 @@ size_t ttlib::get_hash(std::string_view str) noexcept
 
 std::string_view ttlib::find_space(std::string_view str) noexcept
 {
-    if (str.empty())
-        return {};
-    size_t pos;
-    for (pos = 0; pos < str.length(); ++pos)
-    {
-        if (ttlib::is_whitespace(str.at(pos)))
-            break;
-    }
-    if (pos >= str.length())
+    auto pos = ttlib::find_class(str, tt::cls_space);
+    if (pos == tt::npos)
         return {};
     else
         return str.substr(pos);
@@ -65,24 +59,13 @@ std::string_view ttlib::find_space(std::string_view str) noexcept
 
 size_t ttlib::find_space_pos(std::string_view str)
 {
-    auto view = ttlib::find_space(str);
-    if (view.empty())
-        return tt::npos;
-    else
-        return (str.size() - view.size());
+    return ttlib::find_class(str, tt::cls_space);
 }
 
 std::string_view ttlib::find_nonspace(std::string_view str) noexcept
 {
-    if (str.empty())
-        return {};
-    size_t pos;
-    for (pos = 0; pos < str.length(); ++pos)
-    {
-        if (!ttlib::is_whitespace(str.at(pos)))
-            break;
-    }
-    if (pos >= str.length())
+    auto pos = ttlib::find_nonclass(str, tt::cls_space);
+    if (pos == tt::npos)
         return {};
     else
         return str.substr(pos);
@@ -90,33 +73,13 @@ std::string_view ttlib::find_nonspace(std::string_view str) noexcept
 
 size_t ttlib::find_nonspace_pos(std::string_view str) noexcept
 {
-    auto view = ttlib::find_nonspace(str);
-    if (view.empty())
-        return tt::npos;
-    else
-        return (str.size() - view.size());
+    return ttlib::find_nonclass(str, tt::cls_space);
 }
 
 std::string_view ttlib::stepover(std::string_view str) noexcept
 {
-    if (str.empty())
-        return {};
-
-    size_t pos;
-    for (pos = 0; pos < str.length(); ++pos)
-    {
-        if (ttlib::is_whitespace(str.at(pos)))
-            break;
-    }
-    if (pos >= str.length())
-        return {};
-
-    for (; pos < str.length(); ++pos)
-    {
-        if (!ttlib::is_whitespace(str.at(pos)))
-            break;
-    }
-    if (pos >= str.length())
+    auto pos = ttlib::stepover_pos(str);
+    if (pos == tt::npos)
         return {};
     else
         return str.substr(pos);
@@ -124,24 +87,16 @@ std::string_view ttlib::stepover(std::string_view str) noexcept
 
 size_t ttlib::stepover_pos(std::string_view str) noexcept
 {
-    auto view = ttlib::stepover(str);
-    if (view.empty())
+    auto pos = ttlib::find_class(str, tt::cls_space);
+    if (pos == tt::npos)
         return tt::npos;
-    else
-        return (str.size() - view.size());
+    return ttlib::find_nonclass(str, tt::cls_space, pos);
 }
 
 ttlib::cview ttlib::view_space(const std::string& str, size_t startpos) noexcept
 {
-    if (str.empty() || startpos > str.length())
-        return ttlib::cview(ttlib::emptystring.c_str(), 0);
-    size_t pos;
-    for (pos = startpos; pos < str.length(); ++pos)
-    {
-        if (ttlib::is_whitespace(str.at(pos)))
-            break;
-    }
-    if (pos >= str.length())
+    auto pos = ttlib::find_class(str, tt::cls_space, startpos);
+    if (pos == tt::npos)
         return ttlib::cview(ttlib::emptystring.c_str(), 0);
     else
         return ttlib::cview(str.c_str() + pos, str.length() - pos);
@@ -149,15 +104,8 @@ ttlib::cview ttlib::view_space(const std::string& str, size_t startpos) noexcept
 
 ttlib::cview ttlib::view_nonspace(const std::string& str, size_t startpos) noexcept
 {
-    if (str.empty())
-        return ttlib::cview(ttlib::emptystring.c_str(), 0);
-    size_t pos;
-    for (pos = startpos; pos < str.length(); ++pos)
-    {
-        if (!ttlib::is_whitespace(str.at(pos)))
-            break;
-    }
-    if (pos >= str.length())
+    auto pos = ttlib::find_nonclass(str, tt::cls_space, startpos);
+    if (pos == tt::npos)
         return ttlib::cview(ttlib::emptystring.c_str(), 0);
     else
         return ttlib::cview(str.c_str() + pos, str.length() - pos);
@@ -165,24 +113,10 @@ ttlib::cview ttlib::view_nonspace(const std::string& str, size_t startpos) noexc
 
 ttlib::cview ttlib::view_stepover(const std::string& str, size_t startpos) noexcept
 {
-    if (str.empty())
-        return ttlib::cview(ttlib::emptystring.c_str(), 0);
-
-    size_t pos;
-    for (pos = startpos; pos < str.length(); ++pos)
-    {
-        if (ttlib::is_whitespace(str.at(pos)))
-            break;
-    }
-    if (pos >= str.length())
-        return ttlib::cview(ttlib::emptystring.c_str(), 0);
-
-    for (; pos < str.length(); ++pos)
-    {
-        if (!ttlib::is_whitespace(str.at(pos)))
-            break;
-    }
-    if (pos >= str.length())
+    auto pos = ttlib::find_class(str, tt::cls_space, startpos);
+    if (pos != tt::npos)
+        pos = ttlib::find_nonclass(str, tt::cls_space, pos);
+    if (pos == tt::npos)
         return ttlib::cview(ttlib::emptystring.c_str(), 0);
     else
         return ttlib::cview(str.c_str() + pos, str.length() - pos);
@@ -193,40 +127,20 @@ bool ttlib::is_sameprefix(std::string_view strMain, std::string_view strSub, CAS
     if (strSub.empty())
         return strMain.empty();
 
+    // Case folding can change the number of bytes a character uses, so the lengths can't be compared first
+    if (checkcase == CASE::utf8)
+        return ttlib::is_sameprefix_utf8(strMain, strSub);
+
     if (strMain.empty() || strMain.length() < strSub.length())
         return false;
 
     if (checkcase == CASE::exact)
-    {
-        auto iterMain = strMain.begin();
-        for (auto iterSub: strSub)
-        {
-            if (*iterMain++ != iterSub)
-                return false;
-        }
-        return true;
-    }
+        return (strMain.compare(0, strSub.length(), strSub) == 0);
     else if (checkcase == CASE::either)
-    {
-        auto iterMain = strMain.begin();
-        for (auto iterSub: strSub)
-        {
-            if (std::tolower(*iterMain++) != std::tolower(iterSub))
-                return false;
-        }
-        return true;
-    }
-    else if (checkcase == CASE::utf8)
-    {
-        auto utf8locale = std::locale("en_US.utf8");
-        auto iterMain = strMain.begin();
-        for (auto iterSub: strSub)
-        {
-            if (std::tolower(*iterMain++, utf8locale) != std::tolower(iterSub, utf8locale))
-                return false;
-        }
-        return true;
-    }
+        return (ttlib::mismatch_nocase(reinterpret_cast<const unsigned char*>(strMain.data()),
+                                       reinterpret_cast<const unsigned char*>(strSub.data()),
+                                       strSub.length()) == strSub.length());
+
     assert(!"Unknown CASE value");
     return false;
 }
@@ -245,24 +159,10 @@ std::string_view ttlib::find_str(std::string_view main, std::string_view sub, CA
         return {};
     }
 
-    auto chLower = std::tolower(sub[0]);
+    auto pos = (checkcase == CASE::utf8) ? ttlib::find_utf8(main, sub) : ttlib::find_nocase(main, sub);
+    if (pos != tt::npos)
+        return main.substr(pos);
 
-    for (auto pos = 0U; pos < main.length(); ++pos)
-    {
-        if (std::tolower(main.at(pos)) == chLower)
-        {
-            size_t posSub;
-            for (posSub = 1; posSub < sub.length(); ++posSub)
-            {
-                if (pos + posSub >= main.length())
-                    return {};
-                if (std::tolower(main.at(pos + posSub)) != std::tolower(sub.at(posSub)))
-                    break;
-            }
-            if (posSub >= sub.length())
-                return main.substr(pos);
-        }
-    }
     return {};
 }
 
@@ -282,6 +182,9 @@ bool ttlib::contains(std::string_view main, std::string_view sub, CASE checkcase
 
 bool ttlib::is_sameas(std::string_view str1, std::string_view str2, CASE checkcase)
 {
+    if (checkcase == CASE::utf8)
+        return ttlib::is_sameas_utf8(str1, str2);
+
     if (str1.size() != str2.size())
         return false;
 
@@ -291,69 +194,32 @@ bool ttlib::is_sameas(std::string_view str1, std::string_view str2, CASE checkca
     if (checkcase == CASE::exact)
         return (str1.compare(str2) == 0);
 
-    auto main = str1.begin();
-    auto sub = str2.begin();
-    while (sub != str2.end())
-    {
-        auto diff = std::tolower(main[0]) - std::tolower(sub[0]);
-        if (diff != 0)
-            return false;
-        ++main;
-        ++sub;
-        if (main == str1.end())
-            return (sub != str2.end() ? false : true);
-    }
-
-    return (main != str1.end() ? false : true);
+    return (ttlib::mismatch_nocase(reinterpret_cast<const unsigned char*>(str1.data()),
+                                   reinterpret_cast<const unsigned char*>(str2.data()), str1.size()) == str1.size());
 }
 
-int ttlib::atoi(std::string_view str) noexcept
+int ttlib::comparei(std::string_view str1, std::string_view str2) noexcept
 {
-    if (str.empty())
-        return 0;
-
-    str = ttlib::find_nonspace(str);
-
-    int total = 0;
-    size_t pos = 0;
-
-    if (str[0] == '0' && str.length() > 1 && (str[1] == 'x' || str[1] == 'X'))
-    {
-        pos += 2;  // skip over 0x prefix in hexadecimal strings
-
-        for (; pos < str.size(); ++pos)
-        {
-            auto c = str[pos];
-            if (c >= '0' && c <= '9')
-                total = 16 * total + (c - '0');
-            else if (c >= 'a' && c <= 'f')
-                total = total * 16 + c - 'a' + 10;
-            else if (c >= 'A' && c <= 'F')
-                total = total * 16 + c - 'A' + 10;
-            else
-                break;
-        }
-        return total;
-    }
-
-    bool negative = false;
-    if (str[pos] == '-')
+    auto len = (str1.size() < str2.size()) ? str1.size() : str2.size();
+    auto pos = ttlib::mismatch_nocase(reinterpret_cast<const unsigned char*>(str1.data()),
+                                      reinterpret_cast<const unsigned char*>(str2.data()), len);
+    if (pos < len)
     {
-        negative = true;
-        ++pos;
-    }
-    else if (str[pos] == '+')
-    {
-        negative = false;
-        ++pos;
+        // Non-ASCII characters are compared as unsigned values, the same as std::string::compare()
+        return static_cast<int>(fold_ascii(static_cast<unsigned char>(str1[pos]))) -
+               static_cast<int>(fold_ascii(static_cast<unsigned char>(str2[pos])));
     }
 
-    for (; pos < str.size() && str[pos] >= '0' && str[pos] <= '9'; ++pos)
-    {
-        total = 10 * total + (str[pos] - '0');
-    }
+    if (str1.size() == str2.size())
+        return 0;
+    return (str1.size() < str2.size()) ? -1 : 1;
+}
 
-    return (negative ? -total : total);
+int ttlib::atoi(std::string_view str) noexcept
+{
+    // Values are parsed as 64-bit so that hexadecimal values such as 0xFFFFFFFF are converted to an
+    // int the same way they always have been (-1 in this case).
+    return static_cast<int>(ttlib::parse_int64(ttlib::find_nonspace(str)).value);
 }
 
 std::string_view ttlib::find_extension(std::string_view str)
@@ -487,128 +353,16 @@ bool ttlib::file_exists(std::string_view filename)
 ttlib::cstr ttlib::itoa(int val, bool format)
 {
     ttlib::cstr str;
-    if (format)
-        str.Format("%kd", val);
-    else
-        str.Format("%d", val);
+    ttlib::itoa_append(str, val, format);
     return str;
 }
 
 ttlib::cstr ttlib::itoa(size_t val, bool format)
 {
+    // Matches %zu, which displays tt::npos as -1
+    if (val == tt::npos)
+        return ttlib::cstr("-1");
     ttlib::cstr str;
-    if (format)
-        str.Format("%kzu", val);
-    else
-        str.Format("%zu", val);
+    ttlib::itoa_append(str, val, format);
     return str;
 }
-
-#define UINT8(ch)  static_cast<uint8_t>(ch)
-#define CHAR8(ch)  static_cast<char>(ch)
-#define CHAR16(ch) static_cast<char16_t>(ch)
-
-ttlib::cstr ttlib::utf16to8(std::wstring_view str)
-{
-    ttlib::cstr str8;
-    ttlib::utf16to8(str, str8);
-    return str8;
-}
-
-void ttlib::utf16to8(std::wstring_view str, std::string& dest)
-{
-    for (size_t pos = 0; pos < str.size(); ++pos)
-    {
-        uint32_t val = (str[pos] & 0xFFFF);
-        if (val >= 0xD800 && val <= 0xDBFF)
-        {
-            val = (val << 10) + (str[++pos] & 0xFFFF) + 0xFCA02400;
-        }
-
-        if (val < 0x80)
-        {
-            dest.push_back(CHAR8(val));
-        }
-        else if (val < 0x800)
-        {
-            dest.push_back(CHAR8((val >> 6) | 0xC0));
-            dest.push_back(CHAR8((val & 0x3f) | 0x80));
-        }
-        else if (val < 0x10000)
-        {
-            dest.push_back(CHAR8((val >> 12) | 0xE0));
-            dest.push_back(CHAR8(((val >> 6) & 0x3F) | 0x80));
-            dest.push_back(CHAR8((val & 0x3f) | 0x80));
-        }
-        else
-        {
-            dest.push_back(CHAR8((val >> 18) | 0xF0));
-            dest.push_back(CHAR8(((val >> 12) & 0x3F) | 0x80));
-            dest.push_back(CHAR8(((val >> 6) & 0x3F) | 0x80));
-            dest.push_back(CHAR8((val & 0x3f) | 0x80));
-        }
-    }
-}
-
-std::wstring ttlib::utf8to16(std::string_view str)
-{
-    std::wstring str16;
-    ttlib::utf8to16(str, str16);
-    return str16;
-}
-
-void ttlib::utf8to16(std::string_view str, std::wstring& dest)
-{
-    for (size_t pos = 0; pos < str.length(); ++pos)
-    {
-        if (UINT8(str[pos]) < 0x80)
-            dest.push_back(CHAR16(str[pos]));
-        else
-        {
-            uint32_t val = (str[pos] & 0xFF);
-            if ((UINT8(str[pos]) >> 5) == 6)
-            {
-                assertm(pos + 1 < str.size(), "Invalid UTF8 string");
-                if (pos + 1 < str.size())
-                {
-                    val = ((val << 6) & 0x7FF) + (str[++pos] & 0x3F);
-                }
-            }
-
-            else if ((UINT8(str[pos]) >> 4) == 14)
-            {
-                assertm(pos + 2 < str.size(), "Invalid UTF8 string");
-                if (pos + 2 < str.size())
-                {
-                    val = ((val << 12) & 0xFFFF) + ((str[++pos] << 6) & 0xFFF);
-                    val += (str[++pos] & 0x3F);
-                }
-            }
-
-            else if ((UINT8(str[pos]) >> 3) == 30)
-            {
-                assertm(pos + 3 < str.size(), "Invalid UTF8 string");
-                if (pos + 3 < str.size())
-                {
-                    val = ((val << 18) & 0x1FFFFF) + ((str[++pos] << 12) & 0x3FFFF);
-                    val += (str[++pos] << 6) & 0xFFF;
-                    val += (str[++pos] & 0x3F);
-                }
-            }
-            else
-            {
-                assertm(str[pos], "Invalid UTF8 string");
-            }
-
-            if (val > 0xFFFF)
-            {
-                dest.push_back(CHAR16((val >> 10) + 0xD7C0));
-                dest.push_back(CHAR16((val & 0x3FF) + 0xDC00));
-            }
-            else
-            {
-                dest.push_back(CHAR16(val));
-            }
-        }
-    }
-}
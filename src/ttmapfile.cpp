@@ -0,0 +1,124 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttmapfile.cpp
+// Purpose:   Read-only memory-mapped file
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include <string>
+
+#include "ttlibspace.h"  // ttlib namespace functions and declarations
+#include "ttmapfile.h"   // Read-only memory-mapped file
+
+using namespace ttlib;
+
+#if defined(_WIN32)
+
+bool mapfile::open(std::string_view filename)
+{
+    close();
+
+    // FILE_SHARE_DELETE allows the file to be deleted or renamed while it is mapped
+    auto file = CreateFileW(ttlib::utf8to16(filename).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &size) || size.QuadPart <= 0 ||
+        static_cast<unsigned long long>(size.QuadPart) > static_cast<size_t>(-1))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    // The view keeps the file and the mapping open, so both handles can be closed once the view exists.
+    auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+        return false;
+    auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!view)
+        return false;
+
+    m_data = static_cast<const char*>(view);
+    m_size = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+void mapfile::close() noexcept
+{
+    if (m_data)
+    {
+        UnmapViewOfFile(m_data);
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
+
+#else  // not _WIN32
+
+bool mapfile::open(std::string_view filename)
+{
+    close();
+
+    // Opening a pipe can block until there is a writer, and closing it again can kill the writer with
+    // SIGPIPE, so the file is only opened if it's a regular file.
+    std::string name(filename);
+    struct stat info;
+    if (stat(name.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+        return false;
+
+    int fd = ::open(name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size <= 0 ||
+        static_cast<unsigned long long>(info.st_size) > static_cast<size_t>(-1))
+    {
+        ::close(fd);
+        return false;
+    }
+    auto size = static_cast<size_t>(info.st_size);
+
+    int flags = MAP_PRIVATE;
+    #if defined(MAP_POPULATE)
+    // Read the entire file in now rather than faulting each page in separately
+    flags |= MAP_POPULATE;
+    #endif
+    auto view = mmap(nullptr, size, PROT_READ, flags, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED)
+        return false;
+
+    #if !defined(MAP_POPULATE) && defined(MADV_WILLNEED)
+    madvise(view, size, MADV_WILLNEED);
+    #endif
+
+    m_data = static_cast<const char*>(view);
+    m_size = size;
+    return true;
+}
+
+void mapfile::close() noexcept
+{
+    if (m_data)
+    {
+        munmap(const_cast<char*>(m_data), m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
+
+#endif  // _WIN32
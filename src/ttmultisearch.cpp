@@ -0,0 +1,191 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttmultisearch.cpp
+// Purpose:   Search for any number of strings in a single pass
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+// compile() builds a trie of the patterns, then walks it breadth-first to compute the failure link of
+// every state. Rather than keeping the failure links, each missing transition is replaced with the
+// transition of the failure state, turning the trie into a DFA. Each state's list of matching patterns
+// includes the patterns of its failure state, so a search never has to look anywhere but the current
+// state.
+
+#include <algorithm>
+
+#include "ttmultisearch.h"  // Search for any number of strings in a single pass
+#include "ttsimd.h"         // fold_ascii()
+
+using namespace ttlib;
+
+namespace
+{
+    // Marks a transition that doesn't exist yet while the trie is being built
+    constexpr uint32_t no_state = UINT32_MAX;
+}  // anonymous namespace
+
+void multisearcher::compile()
+{
+    const bool nocase = (m_case != tt::CASE::exact);
+
+    // Assign a class to every character that appears in a pattern. Class 0 is for everything else.
+    std::fill(std::begin(m_class), std::end(m_class), static_cast<uint16_t>(0));
+    m_classes = 1;
+    for (auto& pattern: m_patterns)
+    {
+        for (auto ch: pattern)
+        {
+            auto uch = nocase ? fold_ascii(static_cast<unsigned char>(ch)) : static_cast<unsigned char>(ch);
+            if (!m_class[uch])
+                m_class[uch] = static_cast<uint16_t>(m_classes++);
+        }
+    }
+    if (nocase)
+    {
+        for (int ch = 'A'; ch <= 'Z'; ++ch)
+            m_class[ch] = m_class[ch | 0x20];
+    }
+
+    // Build the trie
+    m_delta.assign(m_classes, no_state);
+    std::vector<std::vector<uint32_t>> outputs(1);
+    m_non_empty = 0;
+    for (size_t idx = 0; idx < m_patterns.size(); ++idx)
+    {
+        auto& pattern = m_patterns[idx];
+        if (pattern.empty())
+            continue;
+        ++m_non_empty;
+
+        size_t state = 0;
+        for (auto ch: pattern)
+        {
+            auto& next = m_delta[state * m_classes + m_class[static_cast<unsigned char>(ch)]];
+            if (next == no_state)
+            {
+                next = static_cast<uint32_t>(outputs.size());
+                outputs.emplace_back();
+                m_delta.resize(m_delta.size() + m_classes, no_state);
+            }
+            // m_delta may have been reallocated, so it can't be accessed through next
+            state = m_delta[state * m_classes + m_class[static_cast<unsigned char>(ch)]];
+        }
+        outputs[state].push_back(static_cast<uint32_t>(idx));
+    }
+
+    // Breadth-first walk to fill in failure transitions. A state's failure state is always closer
+    // to the root, so it is complete before the state is processed.
+    std::vector<uint32_t> fail(outputs.size(), 0);
+    std::vector<uint32_t> queue;
+    queue.reserve(outputs.size());
+    for (size_t cls = 0; cls < m_classes; ++cls)
+    {
+        auto& next = m_delta[cls];
+        if (next == no_state)
+            next = 0;
+        else
+            queue.push_back(next);
+    }
+
+    for (size_t head = 0; head < queue.size(); ++head)
+    {
+        auto state = queue[head];
+        auto& out = outputs[state];
+        auto& fail_out = outputs[fail[state]];
+        out.insert(out.end(), fail_out.begin(), fail_out.end());
+
+        for (size_t cls = 0; cls < m_classes; ++cls)
+        {
+            auto& next = m_delta[state * m_classes + cls];
+            auto fail_next = m_delta[fail[state] * m_classes + cls];
+            if (next == no_state)
+            {
+                next = fail_next;
+            }
+            else
+            {
+                fail[next] = fail_next;
+                queue.push_back(next);
+            }
+        }
+    }
+
+    m_out_start.clear();
+    m_out_ids.clear();
+    m_out_start.reserve(outputs.size() + 1);
+    for (auto& out: outputs)
+    {
+        m_out_start.push_back(static_cast<uint32_t>(m_out_ids.size()));
+        m_out_ids.insert(m_out_ids.end(), out.begin(), out.end());
+    }
+    m_out_start.push_back(static_cast<uint32_t>(m_out_ids.size()));
+}
+
+multisearcher::match multisearcher::find(std::string_view text, size_t start) const noexcept
+{
+    if (m_delta.empty() || m_out_ids.empty())
+        return { tt::npos, tt::npos };
+
+    uint32_t state = 0;
+    for (size_t pos = start; pos < text.size(); ++pos)
+    {
+        state = m_delta[state * m_classes + m_class[static_cast<unsigned char>(text[pos])]];
+        if (m_out_start[state] != m_out_start[state + 1])
+        {
+            // The state's own pattern comes first, and it is longer than any inherited from a failure state
+            auto pattern = m_out_ids[m_out_start[state]];
+            return { pos + 1 - m_patterns[pattern].size(), pattern };
+        }
+    }
+    return { tt::npos, tt::npos };
+}
+
+std::vector<multisearcher::match> multisearcher::find_all(std::string_view text) const
+{
+    std::vector<match> matches;
+    if (m_delta.empty() || m_out_ids.empty())
+        return matches;
+
+    uint32_t state = 0;
+    for (size_t pos = 0; pos < text.size(); ++pos)
+    {
+        state = m_delta[state * m_classes + m_class[static_cast<unsigned char>(text[pos])]];
+        for (auto idx = m_out_start[state]; idx < m_out_start[state + 1]; ++idx)
+        {
+            auto pattern = m_out_ids[idx];
+            matches.push_back({ pos + 1 - m_patterns[pattern].size(), pattern });
+        }
+    }
+    return matches;
+}
+
+bool multisearcher::contains_all(std::string_view text) const
+{
+    if (!m_non_empty)
+        return false;
+
+    std::vector<bool> found(m_patterns.size(), false);
+    size_t remaining = m_non_empty;
+    uint32_t state = 0;
+    for (size_t pos = 0; pos < text.size(); ++pos)
+    {
+        state = m_delta[state * m_classes + m_class[static_cast<unsigned char>(text[pos])]];
+        for (auto idx = m_out_start[state]; idx < m_out_start[state + 1]; ++idx)
+        {
+            auto pattern = m_out_ids[idx];
+            if (!found[pattern])
+            {
+                found[pattern] = true;
+                if (--remaining == 0)
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool ttlib::strContains(std::string_view str, const ttlib::multisearcher& patterns)
+{
+    return patterns.contains(str);
+}
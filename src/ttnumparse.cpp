@@ -0,0 +1,401 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttnumparse.cpp
+// Purpose:   Fast integer and floating-point parsing over string views
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+// Decimal digits are converted 8 at a time: the 8 characters are loaded as a single 64-bit value,
+// checked to see if they are all digits, and then combined into a number with three multiplies.
+//
+// Most floating-point values have no more than 15 significant digits and a small exponent. Both the
+// digits and the power of 10 can then be represented exactly as doubles, so a single multiply or
+// divide gives the correctly rounded result. Anything else is handed to std::from_chars().
+
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+#if !defined(__cpp_lib_to_chars)
+    #include <cerrno>
+    #include <cstdlib>
+    #include <string>
+#endif
+
+#include "ttnumparse.h"  // Fast integer and floating-point parsing over string views
+
+using namespace ttlib;
+
+namespace
+{
+    // Returns 8 characters as a little-endian 64-bit value
+    inline uint64_t load_eight(const char* ptr) noexcept
+    {
+        uint64_t value;
+        std::memcpy(&value, ptr, sizeof(value));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+        value = __builtin_bswap64(value);
+#endif
+        return value;
+    }
+
+    inline bool is_eight_digits(uint64_t value) noexcept
+    {
+        // The high 4 bits of every byte must be 3, and adding 6 to each byte must not change that
+        return ((value & 0xF0F0F0F0F0F0F0F0) | (((value + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+               0x3333333333333333;
+    }
+
+    inline uint32_t parse_eight_digits(uint64_t value) noexcept
+    {
+        constexpr uint64_t mask = 0x000000FF000000FF;
+        constexpr uint64_t mul1 = 100 + (1000000ull << 32);
+        constexpr uint64_t mul2 = 1 + (10000ull << 32);
+        value -= 0x3030303030303030;
+        value = (value * 10) + (value >> 8);  // combine pairs of digits
+        value = (((value & mask) * mul1) + (((value >> 16) & mask) * mul2)) >> 32;
+        return static_cast<uint32_t>(value);
+    }
+
+    constexpr bool is_digit(char ch) noexcept
+    {
+        return static_cast<unsigned char>(ch - '0') < 10;
+    }
+
+    inline int hex_value(char ch) noexcept
+    {
+        if (is_digit(ch))
+            return ch - '0';
+        auto lower = static_cast<unsigned char>(ch | 0x20);
+        if (lower >= 'a' && lower <= 'f')
+            return lower - 'a' + 10;
+        return -1;
+    }
+
+    struct DIGITS
+    {
+        uint64_t value { 0 };
+        const char* end { nullptr };  // nullptr if there are no digits
+        bool overflow { false };
+    };
+
+    DIGITS scan_decimal(const char* ptr, const char* end) noexcept
+    {
+        DIGITS digits;
+        if (ptr >= end || !is_digit(*ptr))
+            return digits;
+
+        // Leading zeros don't count towards the 19 digits that are guaranteed to fit
+        while (ptr < end && *ptr == '0')
+            ++ptr;
+
+        // After two blocks there are 16 significant digits, and a third block could overflow
+        auto significant = ptr;
+        while (end - ptr >= 8 && ptr - significant < 16)
+        {
+            auto block = load_eight(ptr);
+            if (!is_eight_digits(block))
+                break;
+            digits.value = digits.value * 100000000 + parse_eight_digits(block);
+            ptr += 8;
+        }
+
+        // Any 19 digits will fit, so there's no need to check for overflow until then
+        auto safe_end = (end - significant > 19) ? significant + 19 : end;
+        for (; ptr < safe_end && is_digit(*ptr); ++ptr)
+            digits.value = digits.value * 10 + static_cast<unsigned>(*ptr - '0');
+
+        for (; ptr < end && is_digit(*ptr); ++ptr)
+        {
+            auto digit = static_cast<unsigned>(*ptr - '0');
+            if (digits.overflow)
+                continue;
+            if (digits.value > (std::numeric_limits<uint64_t>::max() - digit) / 10)
+                digits.overflow = true;
+            else
+                digits.value = digits.value * 10 + digit;
+        }
+        digits.end = ptr;
+        return digits;
+    }
+
+    // ptr points to the first character after the "0x" prefix, which must be a hex digit
+    DIGITS scan_hex(const char* ptr, const char* end) noexcept
+    {
+        DIGITS digits;
+        for (int nibble; ptr < end && (nibble = hex_value(*ptr)) >= 0; ++ptr)
+        {
+            if (digits.value >> 60)
+                digits.overflow = true;
+            else
+                digits.value = (digits.value << 4) | static_cast<uint64_t>(nibble);
+        }
+        digits.end = ptr;
+        return digits;
+    }
+
+    // Parses the optional sign, the optional "0x" prefix and the digits. Returns the magnitude.
+    DIGITS scan_integer(std::string_view str, bool& negative) noexcept
+    {
+        auto ptr = str.data();
+        auto end = ptr + str.size();
+        negative = false;
+        if (ptr < end && (*ptr == '-' || *ptr == '+'))
+        {
+            negative = (*ptr == '-');
+            ++ptr;
+        }
+
+        // Without a hex digit after it, the 'x' isn't part of the number
+        if (end - ptr >= 3 && ptr[0] == '0' && (ptr[1] | 0x20) == 'x' && hex_value(ptr[2]) >= 0)
+            return scan_hex(ptr + 2, end);
+        return scan_decimal(ptr, end);
+    }
+
+    template <typename T>
+    number_result<T> parse_signed(std::string_view str) noexcept
+    {
+        number_result<T> result;
+        bool negative;
+        auto digits = scan_integer(str, negative);
+        if (!digits.end)
+            return result;
+        result.length = static_cast<size_t>(digits.end - str.data());
+
+        // The magnitude of the minimum value is one larger than the maximum value
+        uint64_t limit = static_cast<uint64_t>(std::numeric_limits<T>::max()) + (negative ? 1 : 0);
+        if (digits.overflow || digits.value > limit)
+        {
+            result.value = negative ? std::numeric_limits<T>::min() : std::numeric_limits<T>::max();
+            result.error = std::errc::result_out_of_range;
+        }
+        else
+        {
+            result.value = negative ? static_cast<T>(0 - digits.value) : static_cast<T>(digits.value);
+            result.error = std::errc();
+        }
+        return result;
+    }
+
+    // Powers of 10 that can be represented exactly as a double
+    constexpr double exact_powers[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    // Handles everything that can't take the fast path, including inf and nan
+    std::errc parse_double_slow(const char* begin, const char* end, double& value, const char*& stop) noexcept
+    {
+#if defined(__cpp_lib_to_chars)
+        auto result = std::from_chars(begin, end, value);
+        stop = result.ptr;
+        return result.ec;
+#else
+        // strtod() requires a zero-terminated string, and uses the current locale's decimal point
+        try
+        {
+            std::string copy(begin, end);
+            char* copy_end;
+            errno = 0;
+            value = std::strtod(copy.c_str(), &copy_end);
+            stop = begin + (copy_end - copy.c_str());
+            if (stop == begin)
+                return std::errc::invalid_argument;
+            return (errno == ERANGE) ? std::errc::result_out_of_range : std::errc();
+        }
+        catch (const std::exception& /* e */)
+        {
+            stop = begin;
+            return std::errc::not_enough_memory;
+        }
+#endif
+    }
+}  // anonymous namespace
+
+number_result<int32_t> ttlib::parse_int32(std::string_view str) noexcept
+{
+    return parse_signed<int32_t>(str);
+}
+
+number_result<int64_t> ttlib::parse_int64(std::string_view str) noexcept
+{
+    return parse_signed<int64_t>(str);
+}
+
+number_result<uint64_t> ttlib::parse_uint64(std::string_view str) noexcept
+{
+    number_result<uint64_t> result;
+    if (!str.empty() && str[0] == '-')
+        return result;
+
+    bool negative;
+    auto digits = scan_integer(str, negative);
+    if (!digits.end)
+        return result;
+    result.length = static_cast<size_t>(digits.end - str.data());
+    if (digits.overflow)
+    {
+        result.value = std::numeric_limits<uint64_t>::max();
+        result.error = std::errc::result_out_of_range;
+    }
+    else
+    {
+        result.value = digits.value;
+        result.error = std::errc();
+    }
+    return result;
+}
+
+number_result<double> ttlib::parse_double(std::string_view str) noexcept
+{
+    number_result<double> result;
+    auto begin = str.data();
+    auto end = begin + str.size();
+    auto ptr = begin;
+
+    bool negative = false;
+    if (ptr < end && (*ptr == '-' || *ptr == '+'))
+    {
+        negative = (*ptr == '-');
+        ++ptr;
+    }
+    auto number = ptr;
+
+    // from_chars() accepts its own leading '-', so a second sign has to be rejected before the text
+    // after the first one is ever passed to parse_double_slow()
+    if (number < end && (*number == '-' || *number == '+'))
+        return result;
+
+    // Collect up to 19 significant digits. Any digits after that only affect the exponent, and
+    // prevent the fast path from being used if they aren't zero.
+    uint64_t mantissa = 0;
+    int significant = 0;
+    int64_t exponent = 0;
+    bool truncated = false;
+    bool has_digits = false;
+
+    while (ptr < end && *ptr == '0')
+    {
+        has_digits = true;
+        ++ptr;
+    }
+    while (end - ptr >= 8 && significant <= 11)
+    {
+        auto block = load_eight(ptr);
+        if (!is_eight_digits(block))
+            break;
+        mantissa = mantissa * 100000000 + parse_eight_digits(block);
+        significant += 8;
+        has_digits = true;
+        ptr += 8;
+    }
+    for (; ptr < end && is_digit(*ptr); ++ptr)
+    {
+        has_digits = true;
+        if (significant < 19)
+        {
+            mantissa = mantissa * 10 + static_cast<unsigned>(*ptr - '0');
+            if (mantissa)
+                ++significant;
+        }
+        else
+        {
+            ++exponent;
+            truncated |= (*ptr != '0');
+        }
+    }
+
+    if (ptr < end && *ptr == '.')
+    {
+        auto fraction = ++ptr;
+        if (!mantissa)
+        {
+            while (ptr < end && *ptr == '0')
+                ++ptr;
+            exponent -= (ptr - fraction);
+        }
+        for (; ptr < end && is_digit(*ptr); ++ptr)
+        {
+            if (significant < 19)
+            {
+                mantissa = mantissa * 10 + static_cast<unsigned>(*ptr - '0');
+                if (mantissa)
+                    ++significant;
+                --exponent;
+            }
+            else
+            {
+                truncated |= (*ptr != '0');
+            }
+        }
+        has_digits = has_digits || ptr > fraction;
+    }
+
+    if (!has_digits)
+    {
+        // This may still be inf or nan
+        const char* stop;
+        result.error = parse_double_slow(number, end, result.value, stop);
+        if (result.error == std::errc::invalid_argument)
+        {
+            result.value = 0;
+            return result;
+        }
+        result.length = static_cast<size_t>(stop - begin);
+        if (negative)
+            result.value = -result.value;
+        return result;
+    }
+
+    if (ptr < end && (*ptr | 0x20) == 'e')
+    {
+        auto exp_ptr = ptr + 1;
+        bool exp_negative = false;
+        if (exp_ptr < end && (*exp_ptr == '-' || *exp_ptr == '+'))
+        {
+            exp_negative = (*exp_ptr == '-');
+            ++exp_ptr;
+        }
+
+        // If there are no digits, the 'e' isn't part of the number
+        if (exp_ptr < end && is_digit(*exp_ptr))
+        {
+            int64_t exp_value = 0;
+            for (; exp_ptr < end && is_digit(*exp_ptr); ++exp_ptr)
+            {
+                // Anything this large is already out of range
+                if (exp_value < 100000)
+                    exp_value = exp_value * 10 + (*exp_ptr - '0');
+            }
+            exponent += exp_negative ? -exp_value : exp_value;
+            ptr = exp_ptr;
+        }
+    }
+    result.length = static_cast<size_t>(ptr - begin);
+
+    if (!mantissa)
+    {
+        result.value = negative ? -0.0 : 0.0;
+        result.error = std::errc();
+        return result;
+    }
+
+    if (!truncated && mantissa <= (static_cast<uint64_t>(1) << 53) && exponent >= -22 && exponent <= 22)
+    {
+        auto value = static_cast<double>(mantissa);
+        value = (exponent < 0) ? value / exact_powers[-exponent] : value * exact_powers[exponent];
+        result.value = negative ? -value : value;
+        result.error = std::errc();
+        return result;
+    }
+
+    const char* stop;
+    result.error = parse_double_slow(number, ptr, result.value, stop);
+    if (result.error == std::errc::result_out_of_range)
+    {
+        // from_chars() doesn't set a value when the number is out of range
+        result.value = (exponent > 0) ? std::numeric_limits<double>::infinity() : 0.0;
+    }
+    if (negative)
+        result.value = -result.value;
+    return result;
+}
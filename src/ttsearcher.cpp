@@ -0,0 +1,267 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttsearcher.cpp
+// Purpose:   Precompiled search string for repeated searches
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+// compile() computes the Two-Way critical factorization of the needle once. On x86/x64 the search itself
+// uses the same SSE2/AVX2 first/last character filter as ttlib::find_nocase(), which only falls back to
+// Two-Way on pathological input -- the precomputed factorization means that fallback costs nothing to set
+// up. On other platforms, the needle is also compiled into a Horspool skip table which is combined with
+// Two-Way (the same combination glibc uses for long needles): most positions are rejected by looking at a
+// single character, while Two-Way still guarantees linear time.
+
+#include <algorithm>
+
+#include "ttsearcher.h"  // Precompiled search string for repeated searches
+#include "ttsimd.h"      // Internal SIMD helpers and search kernels
+
+using namespace ttlib;
+
+namespace
+{
+#if !defined(TTLIB_SIMD_X86)
+    // Needles shorter than this are searched for without a skip table
+    constexpr size_t min_skip_len = 4;
+
+    template <bool nocase>
+    inline bool same_char(unsigned char a, unsigned char b) noexcept
+    {
+        if constexpr (nocase)
+            return fold_ascii(a) == fold_ascii(b);
+        else
+            return a == b;
+    }
+
+    template <bool nocase>
+    size_t skip_search(const unsigned char* hay, size_t n, const unsigned char* needle, size_t m,
+                       const twoway_factor& factor, const uint32_t* skip) noexcept
+    {
+        const size_t suffix = factor.suffix;
+        const size_t period = factor.period;
+        size_t pos = 0;
+
+        if (factor.periodic)
+        {
+            size_t memory = 0;
+            while (pos + m <= n)
+            {
+                size_t shift = skip[hay[pos + m - 1]];
+                if (shift)
+                {
+                    // Skipping less than the period would throw away what memory says already matches
+                    if (memory && shift < period)
+                        shift = m - period;
+                    memory = 0;
+                    pos += shift;
+                    continue;
+                }
+
+                // The last character is known to match, so only compare up to it
+                size_t idx = std::max(suffix, memory);
+                while (idx < m - 1 && same_char<nocase>(needle[idx], hay[pos + idx]))
+                    ++idx;
+                if (idx >= m - 1)
+                {
+                    idx = suffix - 1;
+                    while (memory < idx + 1 && same_char<nocase>(needle[idx], hay[pos + idx]))
+                        --idx;
+                    if (idx + 1 < memory + 1)
+                        return pos;
+                    pos += period;
+                    memory = m - period;
+                }
+                else
+                {
+                    pos += idx - suffix + 1;
+                    memory = 0;
+                }
+            }
+        }
+        else
+        {
+            while (pos + m <= n)
+            {
+                size_t shift = skip[hay[pos + m - 1]];
+                if (shift)
+                {
+                    pos += shift;
+                    continue;
+                }
+
+                size_t idx = suffix;
+                while (idx < m - 1 && same_char<nocase>(needle[idx], hay[pos + idx]))
+                    ++idx;
+                if (idx >= m - 1)
+                {
+                    idx = suffix - 1;
+                    while (idx != tt::npos && same_char<nocase>(needle[idx], hay[pos + idx]))
+                        --idx;
+                    if (idx == tt::npos)
+                        return pos;
+                    pos += period;
+                }
+                else
+                {
+                    pos += idx - suffix + 1;
+                }
+            }
+        }
+        return tt::npos;
+    }
+#endif  // !TTLIB_SIMD_X86
+
+    bool is_ascii(std::string_view str) noexcept
+    {
+        for (auto ch: str)
+        {
+            if (static_cast<unsigned char>(ch) >= 0x80)
+                return false;
+        }
+        return true;
+    }
+
+    // Returns the number of bytes in the UTF8 sequence starting with lead. Invalid lead bytes are
+    // treated as a single character, the same as the case folding functions do.
+    size_t utf8_len(unsigned char lead) noexcept
+    {
+        if ((lead & 0xE0) == 0xC0)
+            return 2;
+        else if ((lead & 0xF0) == 0xE0)
+            return 3;
+        else if ((lead & 0xF8) == 0xF0)
+            return 4;
+        return 1;
+    }
+}  // anonymous namespace
+
+void searcher::compile(std::string_view needle, tt::CASE checkcase)
+{
+    m_needle.assign(needle);
+    m_case = checkcase;
+    m_codepoints = 0;
+
+    if (m_needle.empty())
+    {
+        m_method = METHOD::none;
+        return;
+    }
+
+    bool nocase = (checkcase != tt::CASE::exact);
+    if (checkcase == tt::CASE::utf8)
+    {
+        // An ASCII needle that can't match U+017F (long s) or U+212A (Kelvin sign) can only
+        // match ASCII characters, so it can be searched for the same way as tt::CASE::either.
+        bool ascii_only = is_ascii(m_needle);
+        if (ascii_only)
+        {
+            for (auto ch: m_needle)
+            {
+                auto folded = fold_ascii(static_cast<unsigned char>(ch));
+                if (folded == 'k' || folded == 's')
+                {
+                    ascii_only = false;
+                    break;
+                }
+            }
+        }
+
+        if (!ascii_only)
+        {
+            for (size_t pos = 0; pos < m_needle.size(); pos += utf8_len(static_cast<unsigned char>(m_needle[pos])))
+                ++m_codepoints;
+            m_method = METHOD::utf8;
+            return;
+        }
+    }
+
+    m_method = nocase ? METHOD::nocase : METHOD::exact;
+
+    auto chars = reinterpret_cast<const unsigned char*>(m_needle.data());
+    auto factor = twoway_factorize(chars, m_needle.size(), nocase);
+    m_suffix = factor.suffix;
+    m_period = factor.period;
+    m_periodic = factor.periodic;
+
+#if !defined(TTLIB_SIMD_X86)
+    // A character that doesn't appear in the needle (other than as the last character) means the
+    // entire needle can be shifted past it.
+    const size_t last = m_needle.size() - 1;
+    std::fill(std::begin(m_skip), std::end(m_skip), static_cast<uint32_t>(std::min<size_t>(m_needle.size(), UINT32_MAX)));
+    for (size_t idx = 0; idx < last; ++idx)
+    {
+        auto shift = static_cast<uint32_t>(std::min<size_t>(last - idx, UINT32_MAX));
+        if (nocase)
+        {
+            auto folded = fold_ascii(chars[idx]);
+            m_skip[folded] = shift;
+            if (folded >= 'a' && folded <= 'z')
+                m_skip[folded - 0x20] = shift;
+        }
+        else
+        {
+            m_skip[chars[idx]] = shift;
+        }
+    }
+    m_skip[chars[last]] = 0;
+    if (nocase)
+    {
+        auto folded = fold_ascii(chars[last]);
+        m_skip[folded] = 0;
+        if (folded >= 'a' && folded <= 'z')
+            m_skip[folded - 0x20] = 0;
+    }
+#endif  // !TTLIB_SIMD_X86
+}
+
+size_t searcher::find(std::string_view str, size_t start) const noexcept
+{
+    // A UTF8 needle can match text with fewer bytes (e.g., U+212A matches "k"), so find_utf8() checks
+    // its own bounds.
+    if (m_method == METHOD::utf8)
+        return ttlib::find_utf8(str, m_needle, start);
+    else if (m_method == METHOD::none)
+        return tt::npos;
+
+    if (start >= str.size() || m_needle.size() > str.size() - start)
+        return tt::npos;
+
+    const bool nocase = (m_method == METHOD::nocase);
+    auto hay = reinterpret_cast<const unsigned char*>(str.data());
+    auto chars = reinterpret_cast<const unsigned char*>(m_needle.data());
+    twoway_factor factor { m_suffix, m_period, m_periodic };
+
+#if defined(TTLIB_SIMD_X86)
+    return filter_search(hay, str.size(), chars, m_needle.size(), start, &factor, nocase);
+#else
+    if (m_needle.size() < min_skip_len)
+        return nocase ? ttlib::find_nocase(str, m_needle, start) : str.find(m_needle, start);
+
+    auto found = nocase ? skip_search<true>(hay + start, str.size() - start, chars, m_needle.size(), factor, m_skip) :
+                          skip_search<false>(hay + start, str.size() - start, chars, m_needle.size(), factor, m_skip);
+    return (found == tt::npos) ? tt::npos : start + found;
+#endif
+}
+
+std::vector<size_t> searcher::find_all(std::string_view str) const
+{
+    std::vector<size_t> matches;
+    for (auto pos = find(str); pos != tt::npos; pos = find(str, pos))
+    {
+        matches.push_back(pos);
+        if (m_method != METHOD::utf8)
+        {
+            pos += m_needle.size();
+        }
+        else
+        {
+            // Simple case folding maps one code point to one code point, so the match has the same
+            // number of code points as the needle even if the number of bytes is different.
+            for (size_t count = 0; count < m_codepoints && pos < str.size(); ++count)
+                pos += utf8_len(static_cast<unsigned char>(str[pos]));
+        }
+    }
+    return matches;
+}
@@ -0,0 +1,697 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttsimd.cpp
+// Purpose:   SIMD search kernels shared by the string classes
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+// The vector search first filters candidate positions by comparing the first and last
+// character of the needle against 16 (SSE2) or 32 (AVX2) haystack positions at a time. That is
+// very fast on real text, but a pathological haystack (e.g. "aaaa...ab" searching for "aa...ab")
+// can produce a candidate at every position. The filter therefore tracks how many bytes it has
+// spent verifying candidates, and once that exceeds twice the bytes scanned it hands the rest of
+// the haystack to the Two-Way algorithm, which guarantees linear worst-case time.
+
+#include <algorithm>
+#include <cstring>
+
+#include "ttlibspace.h"  // ttlib namespace functions and declarations
+#include "ttsimd.h"      // Internal SIMD helpers and search kernels
+
+using namespace ttlib;
+
+bool ttlib::has_avx2() noexcept
+{
+#if defined(TTLIB_SIMD_X86)
+    static const bool avx2 = []()
+    {
+    #if defined(_MSC_VER) && !defined(__clang__)
+        int regs[4];
+        __cpuid(regs, 0);
+        if (regs[0] < 7)
+            return false;
+        __cpuid(regs, 1);
+        // OSXSAVE and AVX must both be present before XGETBV can be used to check OS support
+        constexpr int osxsave_avx = (1 << 27) | (1 << 28);
+        if ((regs[2] & osxsave_avx) != osxsave_avx)
+            return false;
+        if ((_xgetbv(0) & 6) != 6)  // XMM and YMM state saved by the OS
+            return false;
+        __cpuidex(regs, 7, 0);
+        return (regs[1] & (1 << 5)) != 0;
+    #else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    #endif
+    }();
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+namespace
+{
+    template <bool nocase>
+    inline unsigned char canon(unsigned char ch) noexcept
+    {
+        if constexpr (nocase)
+            return fold_ascii(ch);
+        else
+            return ch;
+    }
+
+    bool equal_nocase(const unsigned char* a, const unsigned char* b, size_t len) noexcept
+    {
+        for (size_t idx = 0; idx < len; ++idx)
+        {
+            if (fold_ascii(a[idx]) != fold_ascii(b[idx]))
+                return false;
+        }
+        return true;
+    }
+
+    template <bool nocase>
+    twoway_factor factorize(const unsigned char* needle, size_t len) noexcept
+    {
+        twoway_factor factor;
+        if (len < 3)
+        {
+            factor.suffix = len - 1;
+            factor.period = 1;
+        }
+        else
+        {
+            // Maximal suffix using the normal ordering. max_suffix starts at -1 and relies on
+            // unsigned wrap-around when k is added to it.
+            size_t max_suffix = tt::npos;
+            size_t j = 0, k = 1, p = 1;
+            while (j + k < len)
+            {
+                auto a = canon<nocase>(needle[j + k]);
+                auto b = canon<nocase>(needle[max_suffix + k]);
+                if (a < b)
+                {
+                    j += k;
+                    k = 1;
+                    p = j - max_suffix;
+                }
+                else if (a == b)
+                {
+                    if (k != p)
+                        ++k;
+                    else
+                    {
+                        j += p;
+                        k = 1;
+                    }
+                }
+                else
+                {
+                    max_suffix = j++;
+                    k = p = 1;
+                }
+            }
+            size_t period = p;
+
+            // Maximal suffix using the reverse ordering
+            size_t max_suffix_rev = tt::npos;
+            j = 0;
+            k = p = 1;
+            while (j + k < len)
+            {
+                auto a = canon<nocase>(needle[j + k]);
+                auto b = canon<nocase>(needle[max_suffix_rev + k]);
+                if (b < a)
+                {
+                    j += k;
+                    k = 1;
+                    p = j - max_suffix_rev;
+                }
+                else if (a == b)
+                {
+                    if (k != p)
+                        ++k;
+                    else
+                    {
+                        j += p;
+                        k = 1;
+                    }
+                }
+                else
+                {
+                    max_suffix_rev = j++;
+                    k = p = 1;
+                }
+            }
+
+            // The longer of the two maximal suffixes gives the critical factorization
+            if (max_suffix_rev + 1 < max_suffix + 1)
+            {
+                factor.suffix = max_suffix + 1;
+                factor.period = period;
+            }
+            else
+            {
+                factor.suffix = max_suffix_rev + 1;
+                factor.period = p;
+            }
+        }
+
+        factor.periodic = factor.period + factor.suffix <= len;
+        if (factor.periodic)
+        {
+            for (size_t idx = 0; idx < factor.suffix; ++idx)
+            {
+                if (canon<nocase>(needle[idx]) != canon<nocase>(needle[idx + factor.period]))
+                {
+                    factor.periodic = false;
+                    break;
+                }
+            }
+        }
+        if (!factor.periodic)
+            factor.period = std::max(factor.suffix, len - factor.suffix) + 1;
+        return factor;
+    }
+
+    template <bool nocase>
+    size_t twoway(const unsigned char* hay, size_t n, const unsigned char* needle, size_t m,
+                  const twoway_factor& factor) noexcept
+    {
+        const size_t suffix = factor.suffix;
+        const size_t period = factor.period;
+        size_t pos = 0;
+
+        if (factor.periodic)
+        {
+            // A mismatch in the left half can only advance by the period, so remember how much of the
+            // right half is already known to match to avoid rescanning it.
+            size_t memory = 0;
+            while (pos + m <= n)
+            {
+                size_t idx = std::max(suffix, memory);
+                while (idx < m && canon<nocase>(needle[idx]) == canon<nocase>(hay[pos + idx]))
+                    ++idx;
+                if (idx >= m)
+                {
+                    idx = suffix - 1;
+                    while (memory < idx + 1 && canon<nocase>(needle[idx]) == canon<nocase>(hay[pos + idx]))
+                        --idx;
+                    if (idx + 1 < memory + 1)
+                        return pos;
+                    pos += period;
+                    memory = m - period;
+                }
+                else
+                {
+                    pos += idx - suffix + 1;
+                    memory = 0;
+                }
+            }
+        }
+        else
+        {
+            while (pos + m <= n)
+            {
+                size_t idx = suffix;
+                while (idx < m && canon<nocase>(needle[idx]) == canon<nocase>(hay[pos + idx]))
+                    ++idx;
+                if (idx >= m)
+                {
+                    idx = suffix - 1;
+                    while (idx != tt::npos && canon<nocase>(needle[idx]) == canon<nocase>(hay[pos + idx]))
+                        --idx;
+                    if (idx == tt::npos)
+                        return pos;
+                    pos += period;
+                }
+                else
+                {
+                    pos += idx - suffix + 1;
+                }
+            }
+        }
+        return tt::npos;
+    }
+
+    template <bool nocase>
+    bool equal_chars(const unsigned char* a, const unsigned char* b, size_t len) noexcept
+    {
+        if constexpr (nocase)
+            return equal_nocase(a, b, len);
+        else
+            return std::memcmp(a, b, len) == 0;
+    }
+
+    // Searches from pos to the end of the haystack using Two-Way. This is used for whatever the
+    // vector filter could not handle: the tail of the haystack and pathological inputs. If factor
+    // is nullptr, the needle is factorized first.
+    template <bool nocase>
+    size_t finish_search(const unsigned char* hay, size_t n, const unsigned char* needle, size_t m, size_t pos,
+                         const twoway_factor* factor) noexcept
+    {
+        if (pos + m > n)
+            return tt::npos;
+        auto found = factor ? twoway<nocase>(hay + pos, n - pos, needle, m, *factor) :
+                              twoway<nocase>(hay + pos, n - pos, needle, m, factorize<nocase>(needle, m));
+        return (found == tt::npos) ? tt::npos : pos + found;
+    }
+
+    // Once the verification work exceeds this, the filter gives up and switches to Two-Way
+    constexpr size_t verify_allowance = 4096;
+
+#if defined(TTLIB_SIMD_X86)
+
+    inline __m128i fold_sse2(__m128i chars) noexcept
+    {
+        // Shift 'A' to -128 so that a single signed compare can find 'A' through 'Z'
+        auto shifted = _mm_add_epi8(chars, _mm_set1_epi8(static_cast<char>(0x80 - 'A')));
+        auto upper = _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(0x80 - 'A' + 'Z' + 1)));
+        return _mm_or_si128(chars, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+    }
+
+    template <bool nocase>
+    inline __m128i canon_sse2(__m128i chars) noexcept
+    {
+        if constexpr (nocase)
+            return fold_sse2(chars);
+        else
+            return chars;
+    }
+
+    template <bool nocase>
+    size_t search_sse2(const unsigned char* hay, size_t n, const unsigned char* needle, size_t m, size_t pos,
+                       const twoway_factor* factor) noexcept
+    {
+        const auto first = _mm_set1_epi8(static_cast<char>(canon<nocase>(needle[0])));
+        const auto last = _mm_set1_epi8(static_cast<char>(canon<nocase>(needle[m - 1])));
+        const size_t begin = pos;
+        size_t work = 0;
+
+        for (; pos + m - 1 + 16 <= n; pos += 16)
+        {
+            auto block_first = canon_sse2<nocase>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + pos)));
+            auto block_last = canon_sse2<nocase>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + pos + m - 1)));
+            auto mask = static_cast<uint32_t>(
+                _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last))));
+            while (mask)
+            {
+                auto offset = pos + ctz32(mask);
+                if (m < 3 || equal_chars<nocase>(hay + offset + 1, needle + 1, m - 2))
+                    return offset;
+                work += m;
+                mask &= mask - 1;
+            }
+            if (work > 2 * (pos - begin) + verify_allowance)
+                return finish_search<nocase>(hay, n, needle, m, pos + 16, factor);
+        }
+        return finish_search<nocase>(hay, n, needle, m, pos, factor);
+    }
+
+    TT_TARGET_AVX2 inline __m256i fold_avx2(__m256i chars) noexcept
+    {
+        auto shifted = _mm256_add_epi8(chars, _mm256_set1_epi8(static_cast<char>(0x80 - 'A')));
+        auto upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(0x80 - 'A' + 'Z' + 1)), shifted);
+        return _mm256_or_si256(chars, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+    }
+
+    template <bool nocase>
+    TT_TARGET_AVX2 inline __m256i canon_avx2(__m256i chars) noexcept
+    {
+        if constexpr (nocase)
+            return fold_avx2(chars);
+        else
+            return chars;
+    }
+
+    template <bool nocase>
+    TT_TARGET_AVX2 size_t search_avx2(const unsigned char* hay, size_t n, const unsigned char* needle, size_t m,
+                                      size_t pos, const twoway_factor* factor) noexcept
+    {
+        const auto first = _mm256_set1_epi8(static_cast<char>(canon<nocase>(needle[0])));
+        const auto last = _mm256_set1_epi8(static_cast<char>(canon<nocase>(needle[m - 1])));
+        const size_t begin = pos;
+        size_t work = 0;
+
+        for (; pos + m - 1 + 32 <= n; pos += 32)
+        {
+            auto block_first = canon_avx2<nocase>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + pos)));
+            auto block_last =
+                canon_avx2<nocase>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + pos + m - 1)));
+            auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, last))));
+            while (mask)
+            {
+                auto offset = pos + ctz32(mask);
+                if (m < 3 || equal_chars<nocase>(hay + offset + 1, needle + 1, m - 2))
+                    return offset;
+                work += m;
+                mask &= mask - 1;
+            }
+            if (work > 2 * (pos - begin) + verify_allowance)
+                return finish_search<nocase>(hay, n, needle, m, pos + 32, factor);
+        }
+
+        // Let SSE2 handle anything left that is still wider than 16 bytes
+        _mm256_zeroupper();
+        return search_sse2<nocase>(hay, n, needle, m, pos, factor);
+    }
+
+    // Returns the offset of the first mismatch, or the offset where fewer than 16 bytes remain
+    size_t mismatch_sse2(const unsigned char* a, const unsigned char* b, size_t len) noexcept
+    {
+        size_t pos = 0;
+        for (; pos + 16 <= len; pos += 16)
+        {
+            auto block_a = fold_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + pos)));
+            auto block_b = fold_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + pos)));
+            auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block_a, block_b))) ^ 0xFFFF;
+            if (mask)
+                return pos + ctz32(mask);
+        }
+        return pos;
+    }
+
+    TT_TARGET_AVX2 size_t mismatch_avx2(const unsigned char* a, const unsigned char* b, size_t len) noexcept
+    {
+        size_t pos = 0;
+        for (; pos + 32 <= len; pos += 32)
+        {
+            auto block_a = fold_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + pos)));
+            auto block_b = fold_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + pos)));
+            auto mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block_a, block_b)));
+            if (mask)
+                return pos + ctz32(mask);
+        }
+        // Clear the upper halves of the AVX registers before running legacy SSE2 code to avoid a
+        // state transition penalty
+        _mm256_zeroupper();
+        return pos + mismatch_sse2(a + pos, b + pos, len - pos);
+    }
+
+    // Returns 0xFF for every character where (ch - first) <= count as an unsigned byte
+    inline __m128i in_range_sse2(__m128i chars, char first, char count) noexcept
+    {
+        auto offset = _mm_sub_epi8(chars, _mm_set1_epi8(first));
+        return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(count)), offset);
+    }
+
+    // Returns 0xFF for every character that belongs to one of the tt::CHARCLASS classes. This
+    // must produce the same result as tt::char_class_table.
+    inline __m128i classify_sse2(__m128i chars, uint8_t classes) noexcept
+    {
+        auto result = _mm_setzero_si128();
+        if (classes & tt::cls_space)
+        {
+            result = _mm_or_si128(result, in_range_sse2(chars, '\t', '\r' - '\t'));
+            result = _mm_or_si128(result, _mm_cmpeq_epi8(chars, _mm_set1_epi8(' ')));
+        }
+        if (classes & tt::cls_blank)
+        {
+            result = _mm_or_si128(result, _mm_cmpeq_epi8(chars, _mm_set1_epi8('\t')));
+            result = _mm_or_si128(result, _mm_cmpeq_epi8(chars, _mm_set1_epi8(' ')));
+        }
+        if (classes & (tt::cls_digit | tt::cls_xdigit))
+            result = _mm_or_si128(result, in_range_sse2(chars, '0', 9));
+        if (classes & tt::cls_upper)
+            result = _mm_or_si128(result, in_range_sse2(chars, 'A', 25));
+        if (classes & tt::cls_lower)
+            result = _mm_or_si128(result, in_range_sse2(chars, 'a', 25));
+        if (classes & tt::cls_xdigit)
+            result = _mm_or_si128(result, in_range_sse2(_mm_or_si128(chars, _mm_set1_epi8(0x20)), 'a', 5));
+        if (classes & tt::cls_cntrl)
+        {
+            result = _mm_or_si128(result, in_range_sse2(chars, 0, 0x1F));
+            result = _mm_or_si128(result, _mm_cmpeq_epi8(chars, _mm_set1_epi8(0x7F)));
+        }
+        if (classes & tt::cls_punct)
+        {
+            auto alnum = _mm_or_si128(in_range_sse2(chars, '0', 9),
+                                      _mm_or_si128(in_range_sse2(chars, 'A', 25), in_range_sse2(chars, 'a', 25)));
+            result = _mm_or_si128(result, _mm_andnot_si128(alnum, in_range_sse2(chars, '!', '~' - '!')));
+        }
+        return result;
+    }
+
+    // Returns the offset of the first character whose membership in classes matches want, or the
+    // offset where fewer than 16 characters remain.
+    size_t scan_class_sse2(const unsigned char* str, size_t len, size_t pos, uint8_t classes, bool want) noexcept
+    {
+        const uint32_t flip = want ? 0 : 0xFFFF;
+        for (; pos + 16 <= len; pos += 16)
+        {
+            auto block = classify_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(str + pos)), classes);
+            auto mask = static_cast<uint32_t>(_mm_movemask_epi8(block)) ^ flip;
+            if (mask)
+                return pos + ctz32(mask);
+        }
+        return pos;
+    }
+
+    TT_TARGET_AVX2 inline __m256i in_range_avx2(__m256i chars, char first, char count) noexcept
+    {
+        auto offset = _mm256_sub_epi8(chars, _mm256_set1_epi8(first));
+        return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(count)), offset);
+    }
+
+    TT_TARGET_AVX2 inline __m256i classify_avx2(__m256i chars, uint8_t classes) noexcept
+    {
+        auto result = _mm256_setzero_si256();
+        if (classes & tt::cls_space)
+        {
+            result = _mm256_or_si256(result, in_range_avx2(chars, '\t', '\r' - '\t'));
+            result = _mm256_or_si256(result, _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(' ')));
+        }
+        if (classes & tt::cls_blank)
+        {
+            result = _mm256_or_si256(result, _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('\t')));
+            result = _mm256_or_si256(result, _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(' ')));
+        }
+        if (classes & (tt::cls_digit | tt::cls_xdigit))
+            result = _mm256_or_si256(result, in_range_avx2(chars, '0', 9));
+        if (classes & tt::cls_upper)
+            result = _mm256_or_si256(result, in_range_avx2(chars, 'A', 25));
+        if (classes & tt::cls_lower)
+            result = _mm256_or_si256(result, in_range_avx2(chars, 'a', 25));
+        if (classes & tt::cls_xdigit)
+            result = _mm256_or_si256(result, in_range_avx2(_mm256_or_si256(chars, _mm256_set1_epi8(0x20)), 'a', 5));
+        if (classes & tt::cls_cntrl)
+        {
+            result = _mm256_or_si256(result, in_range_avx2(chars, 0, 0x1F));
+            result = _mm256_or_si256(result, _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(0x7F)));
+        }
+        if (classes & tt::cls_punct)
+        {
+            auto alnum = _mm256_or_si256(in_range_avx2(chars, '0', 9),
+                                         _mm256_or_si256(in_range_avx2(chars, 'A', 25), in_range_avx2(chars, 'a', 25)));
+            result = _mm256_or_si256(result, _mm256_andnot_si256(alnum, in_range_avx2(chars, '!', '~' - '!')));
+        }
+        return result;
+    }
+
+    TT_TARGET_AVX2 size_t scan_class_avx2(const unsigned char* str, size_t len, size_t pos, uint8_t classes,
+                                          bool want) noexcept
+    {
+        const uint32_t flip = want ? 0 : 0xFFFFFFFF;
+        for (; pos + 32 <= len; pos += 32)
+        {
+            auto block = classify_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + pos)), classes);
+            auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(block)) ^ flip;
+            if (mask)
+                return pos + ctz32(mask);
+        }
+        _mm256_zeroupper();
+        return scan_class_sse2(str, len, pos, classes, want);
+    }
+
+#endif  // TTLIB_SIMD_X86
+}  // anonymous namespace
+
+twoway_factor ttlib::twoway_factorize(const unsigned char* needle, size_t len, bool nocase) noexcept
+{
+    return nocase ? factorize<true>(needle, len) : factorize<false>(needle, len);
+}
+
+size_t ttlib::twoway_search(const unsigned char* hay, size_t n, const unsigned char* needle, size_t m,
+                            const twoway_factor& factor, bool nocase) noexcept
+{
+    return nocase ? twoway<true>(hay, n, needle, m, factor) : twoway<false>(hay, n, needle, m, factor);
+}
+
+size_t ttlib::mismatch_nocase(const unsigned char* a, const unsigned char* b, size_t len) noexcept
+{
+    size_t pos = 0;
+#if defined(TTLIB_SIMD_X86)
+    if (len >= 32 && has_avx2())
+        pos = mismatch_avx2(a, b, len);
+    else if (len >= 16)
+        pos = mismatch_sse2(a, b, len);
+#endif
+
+    // Finish whatever is left over (if the vector code found a mismatch, this stops immediately)
+    for (; pos < len; ++pos)
+    {
+        if (fold_ascii(a[pos]) != fold_ascii(b[pos]))
+            break;
+    }
+    return pos;
+}
+
+size_t ttlib::filter_search(const unsigned char* hay, size_t n, const unsigned char* needle, size_t m, size_t pos,
+                             const twoway_factor* factor, bool nocase) noexcept
+{
+#if defined(TTLIB_SIMD_X86)
+    if (has_avx2())
+        return nocase ? search_avx2<true>(hay, n, needle, m, pos, factor) :
+                        search_avx2<false>(hay, n, needle, m, pos, factor);
+    return nocase ? search_sse2<true>(hay, n, needle, m, pos, factor) : search_sse2<false>(hay, n, needle, m, pos, factor);
+#else
+    return nocase ? finish_search<true>(hay, n, needle, m, pos, factor) :
+                    finish_search<false>(hay, n, needle, m, pos, factor);
+#endif
+}
+
+size_t ttlib::find_nocase(std::string_view main, std::string_view sub, size_t start) noexcept
+{
+    if (sub.empty() || start >= main.size() || sub.size() > main.size() - start)
+        return tt::npos;
+
+    return filter_search(reinterpret_cast<const unsigned char*>(main.data()), main.size(),
+                         reinterpret_cast<const unsigned char*>(sub.data()), sub.size(), start, nullptr, true);
+}
+
+namespace
+{
+    size_t scan_class(std::string_view str, uint8_t classes, size_t start, bool want) noexcept
+    {
+        if (start >= str.size())
+            return tt::npos;
+
+        auto chars = reinterpret_cast<const unsigned char*>(str.data());
+        size_t pos = start;
+#if defined(TTLIB_SIMD_X86)
+        if (str.size() - pos >= 32 && has_avx2())
+            pos = scan_class_avx2(chars, str.size(), pos, classes, want);
+        else if (str.size() - pos >= 16)
+            pos = scan_class_sse2(chars, str.size(), pos, classes, want);
+#endif
+
+        // Finish whatever is left over (if the vector code found a match, this stops immediately)
+        for (; pos < str.size(); ++pos)
+        {
+            if (((tt::char_class_table[chars[pos]] & classes) != 0) == want)
+                return pos;
+        }
+        return tt::npos;
+    }
+}  // anonymous namespace
+
+namespace
+{
+#if defined(TTLIB_SIMD_X86)
+    // A line ends at every '\n', and at every '\r' that isn't followed by '\n'. The byte after each
+    // block is compared as well, so text must contain at least blocks * 32 + 1 bytes. Lines are
+    // summed in 8-bit lanes for up to 255 blocks at a time.
+    TT_TARGET_AVX2 size_t count_line_ends_avx2(const unsigned char* text, size_t blocks) noexcept
+    {
+        const __m256i cr = _mm256_set1_epi8('\r');
+        const __m256i lf = _mm256_set1_epi8('\n');
+        const __m256i zero = _mm256_setzero_si256();
+        size_t count = 0;
+        while (blocks)
+        {
+            size_t batch = blocks < 255 ? blocks : 255;
+            blocks -= batch;
+            __m256i sums = zero;
+            for (; batch; --batch, text += 32)
+            {
+                __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text));
+                __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + 1));
+                __m256i lone_cr = _mm256_andnot_si256(_mm256_cmpeq_epi8(next, lf), _mm256_cmpeq_epi8(chars, cr));
+                __m256i ends = _mm256_or_si256(_mm256_cmpeq_epi8(chars, lf), lone_cr);
+                sums = _mm256_sub_epi8(sums, ends);
+            }
+            alignas(32) uint64_t lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), _mm256_sad_epu8(sums, zero));
+            count += static_cast<size_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+        }
+        _mm256_zeroupper();
+        return count;
+    }
+
+    size_t count_line_ends_sse2(const unsigned char* text, size_t blocks) noexcept
+    {
+        const __m128i cr = _mm_set1_epi8('\r');
+        const __m128i lf = _mm_set1_epi8('\n');
+        const __m128i zero = _mm_setzero_si128();
+        size_t count = 0;
+        while (blocks)
+        {
+            size_t batch = blocks < 255 ? blocks : 255;
+            blocks -= batch;
+            __m128i sums = zero;
+            for (; batch; --batch, text += 16)
+            {
+                __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text));
+                __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + 1));
+                __m128i lone_cr = _mm_andnot_si128(_mm_cmpeq_epi8(next, lf), _mm_cmpeq_epi8(chars, cr));
+                __m128i ends = _mm_or_si128(_mm_cmpeq_epi8(chars, lf), lone_cr);
+                sums = _mm_sub_epi8(sums, ends);
+            }
+            __m128i total = _mm_sad_epu8(sums, zero);
+            count += static_cast<size_t>(_mm_cvtsi128_si32(total)) +
+                     static_cast<size_t>(_mm_cvtsi128_si32(_mm_srli_si128(total, 8)));
+        }
+        return count;
+    }
+#endif  // TTLIB_SIMD_X86
+}  // anonymous namespace
+
+size_t ttlib::count_line_ends(const char* text, size_t size) noexcept
+{
+    auto chars = reinterpret_cast<const unsigned char*>(text);
+    size_t count = 0;
+    size_t pos = 0;
+#if defined(TTLIB_SIMD_X86)
+    if (size > 32 && has_avx2())
+    {
+        pos = (size - 1) / 32 * 32;
+        count = count_line_ends_avx2(chars, pos / 32);
+    }
+    else if (size > 16)
+    {
+        pos = (size - 1) / 16 * 16;
+        count = count_line_ends_sse2(chars, pos / 16);
+    }
+#endif  // TTLIB_SIMD_X86
+
+    // Eight characters at a time. The following characters are loaded separately so that byte order
+    // doesn't matter.
+    for (; size - pos >= 9; pos += 8)
+    {
+        uint64_t word, next;
+        std::memcpy(&word, chars + pos, sizeof(word));
+        std::memcpy(&next, chars + pos + 1, sizeof(next));
+        uint64_t ends = swar_match(word, '\n') | (swar_match(word, '\r') & ~swar_match(next, '\n'));
+        count += static_cast<size_t>(((ends >> 7) * 0x0101010101010101ULL) >> 56);
+    }
+
+    for (; pos < size; ++pos)
+    {
+        if (chars[pos] == '\n' || (chars[pos] == '\r' && (pos + 1 == size || chars[pos + 1] != '\n')))
+            ++count;
+    }
+    return count;
+}
+
+size_t ttlib::find_class(std::string_view str, uint8_t classes, size_t start) noexcept
+{
+    return scan_class(str, classes, start, true);
+}
+
+size_t ttlib::find_nonclass(std::string_view str, uint8_t classes, size_t start) noexcept
+{
+    return scan_class(str, classes, start, false);
+}
@@ -0,0 +1,208 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttsimd.h
+// Purpose:   Internal SIMD helpers and search kernels
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+// This header is only used by the library's own source files -- it is not installed with the public headers.
+//
+// SSE2 is part of the x64 baseline, so SSE2 code paths are always compiled on x86/x64. AVX2 code paths are
+// compiled into separate functions (marked with TT_TARGET_AVX2) and are only called if has_avx2() returns true.
+// All other platforms use the scalar code paths.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #define TTLIB_SIMD_X86
+    #include <emmintrin.h>  // SSE2
+    #include <immintrin.h>  // AVX2
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h>
+
+    // MSVC allows AVX2 intrinsics in any function
+    #define TT_TARGET_AVX2
+#else
+    #define TT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace ttlib
+{
+    /// Returns true if both the CPU and the OS support AVX2. Always false on non-x86
+    /// platforms. The result is computed once and then cached.
+    bool has_avx2() noexcept;
+
+    /// Returns the index of the lowest set bit. mask must not be zero.
+    inline unsigned ctz32(uint32_t mask) noexcept
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+    }
+
+    /// Returns the index of the highest set bit. mask must not be zero.
+    inline unsigned high_bit32(uint32_t mask) noexcept
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long index;
+        _BitScanReverse(&index, mask);
+        return static_cast<unsigned>(index);
+#else
+        return 31 - static_cast<unsigned>(__builtin_clz(mask));
+#endif
+    }
+
+    /// Returns the number of set bits. Doesn't require the POPCNT instruction.
+    constexpr unsigned popcount32(uint32_t mask) noexcept
+    {
+        mask = mask - ((mask >> 1) & 0x55555555);
+        mask = (mask & 0x33333333) + ((mask >> 2) & 0x33333333);
+        mask = (mask + (mask >> 4)) & 0x0F0F0F0F;
+        return (mask * 0x01010101) >> 24;
+    }
+
+    /// Converts 'A' through 'Z' to lowercase -- all other values are returned unchanged.
+    constexpr unsigned char fold_ascii(unsigned char ch) noexcept
+    {
+        return (static_cast<unsigned char>(ch - 'A') < 26) ? static_cast<unsigned char>(ch | 0x20) : ch;
+    }
+
+    /// Returns the offset of the first byte where a and b differ after folding ASCII letters to
+    /// lowercase, or len if the first len bytes are the same. Compares 16 (SSE2) or 32 (AVX2)
+    /// bytes at a time.
+    size_t mismatch_nocase(const unsigned char* a, const unsigned char* b, size_t len) noexcept;
+
+    /// Critical factorization of a needle used by the Two-Way string search algorithm.
+    struct twoway_factor
+    {
+        size_t suffix;  // start of the right half of the needle
+        size_t period;  // period used to shift after a mismatch in the left half
+        bool periodic;  // true if the left half is a repeat of the period
+    };
+
+    /// Computes the critical factorization of needle. If nocase is true, ASCII letters are
+    /// folded to lowercase before comparing.
+    twoway_factor twoway_factorize(const unsigned char* needle, size_t len, bool nocase) noexcept;
+
+    /// Searches for needle in hay using a precomputed factorization. Returns the offset of the
+    /// first match or tt::npos. Runs in O(n + m) time using constant space.
+    size_t twoway_search(const unsigned char* hay, size_t n, const unsigned char* needle, size_t m,
+                         const twoway_factor& factor, bool nocase) noexcept;
+
+    /// Searches for needle in hay starting at pos by filtering on the first and last characters of the
+    /// needle using SSE2 or AVX2, falling back to Two-Way if the filter finds too many false positives.
+    /// If factor is nullptr, the needle is only factorized if the fallback is needed. On platforms
+    /// without SIMD support this is a plain Two-Way search.
+    size_t filter_search(const unsigned char* hay, size_t n, const unsigned char* needle, size_t m, size_t pos,
+                         const twoway_factor* factor, bool nocase) noexcept;
+
+    /// Returns the number of line endings in text. "\r\n" is a single line ending, as is a "\r" or
+    /// "\n" on its own.
+    size_t count_line_ends(const char* text, size_t size) noexcept;
+
+    /// Returns a word where each byte is 0x80 if the matching byte of word is ch, and zero if it
+    /// isn't. Used to check eight characters at a time without SIMD instructions.
+    constexpr uint64_t swar_match(uint64_t word, unsigned char ch) noexcept
+    {
+        constexpr uint64_t low7 = 0x7F7F7F7F7F7F7F7FULL;
+        uint64_t x = word ^ (0x0101010101010101ULL * ch);
+        return ~(((x & low7) + low7) | x | low7);
+    }
+
+#if defined(TTLIB_SIMD_X86)
+    /// Returns a bit for each '\r' or '\n' in the 32 bytes at text.
+    inline uint32_t line_end_mask(const char* text) noexcept
+    {
+        const __m128i cr = _mm_set1_epi8('\r');
+        const __m128i lf = _mm_set1_epi8('\n');
+        __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text));
+        __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + 16));
+        auto low_mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(low, cr), _mm_cmpeq_epi8(low, lf)));
+        auto high_mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(high, cr), _mm_cmpeq_epi8(high, lf)));
+        return static_cast<uint32_t>(low_mask) | (static_cast<uint32_t>(high_mask) << 16);
+    }
+#endif  // TTLIB_SIMD_X86
+
+    /// Finds each line ending ("\r\n", "\r" or "\n") in text. On x86/x64 32 bytes are checked at a time.
+    class line_scanner
+    {
+    public:
+        line_scanner(const char* text, size_t size) noexcept : m_text(text), m_size(size) {}
+
+        /// Returns the offset of the next line ending, or tt::npos if there are no more. length is
+        /// set to the number of characters in the line ending (1 or 2).
+        size_t next(size_t& length) noexcept
+        {
+            size_t pos;
+#if defined(TTLIB_SIMD_X86)
+            for (;;)
+            {
+                while (!m_mask)
+                {
+                    if (m_size - m_next_block < 32)
+                    {
+                        // Fewer than 32 characters are left, so they are checked one at a time
+                        pos = m_line_start > m_next_block ? m_line_start : m_next_block;
+                        for (; pos < m_size; ++pos)
+                        {
+                            if (m_text[pos] == '\r' || m_text[pos] == '\n')
+                                return found(pos, length);
+                        }
+                        return static_cast<size_t>(-1);
+                    }
+                    m_mask = line_end_mask(m_text + m_next_block);
+                    m_block = m_next_block;
+                    m_next_block += 32;
+                }
+
+                pos = m_block + ctz32(m_mask);
+                m_mask &= m_mask - 1;
+                if (pos >= m_line_start)  // otherwise it's the '\n' of a "\r\n"
+                    return found(pos, length);
+            }
+#else
+            pos = m_line_start;
+            for (uint64_t word; m_size - pos >= 8; pos += 8)
+            {
+                std::memcpy(&word, m_text + pos, sizeof(word));
+                if (swar_match(word, '\r') | swar_match(word, '\n'))
+                    break;
+            }
+            for (; pos < m_size; ++pos)
+            {
+                if (m_text[pos] == '\r' || m_text[pos] == '\n')
+                    return found(pos, length);
+            }
+            return static_cast<size_t>(-1);
+#endif  // TTLIB_SIMD_X86
+        }
+
+    private:
+        size_t found(size_t pos, size_t& length) noexcept
+        {
+            length = (m_text[pos] == '\r' && pos + 1 < m_size && m_text[pos + 1] == '\n') ? 2 : 1;
+            m_line_start = pos + length;
+            return pos;
+        }
+
+        const char* m_text;
+        size_t m_size;
+        size_t m_line_start { 0 };  // offset after the last line ending that was returned
+#if defined(TTLIB_SIMD_X86)
+        size_t m_block { 0 };       // offset of the block m_mask was computed from
+        size_t m_next_block { 0 };  // offset of the next block to check
+        uint32_t m_mask { 0 };      // line ending characters in the block that haven't been returned
+#endif  // TTLIB_SIMD_X86
+    };
+}  // namespace ttlib
@@ -8,65 +8,22 @@
 #include <cassert>
 #include <cctype>
 #include <cstring>
-#include <locale>
 
 #include "ttsview.h"
 
+#include "ttcharset.h"  // Precompiled set of characters for delimiter scanning
+#include "ttutf.h"      // Unicode conversion, validation and decoding
+
 using namespace ttlib;
 
 bool sview::is_sameas(std::string_view str, tt::CASE checkcase) const
 {
-    if (size() != str.size())
-        return false;
-
-    if (empty())
-        return str.empty();
-
-    // if both strings have the same length, then we can compare as a prefix.
-    return is_sameprefix(str, checkcase);
+    return ttlib::is_sameas(*this, str, checkcase);
 }
 
 bool sview::is_sameprefix(std::string_view str, tt::CASE checkcase) const
 {
-    if (str.empty())
-        return empty();
-
-    if (empty() || length() < str.length())
-        return false;
-
-    if (checkcase == tt::CASE::exact)
-    {
-        auto iterMain = begin();
-        for (auto iterSub: str)
-        {
-            if (*iterMain++ != iterSub)
-                return false;
-        }
-        return true;
-    }
-    else if (checkcase == tt::CASE::either)
-    {
-        auto iterMain = begin();
-        for (auto iterSub: str)
-        {
-            if (std::tolower(*iterMain++) != std::tolower(iterSub))
-                return false;
-        }
-        return true;
-    }
-    else if (checkcase == tt::CASE::utf8)
-    {
-        auto utf8locale = std::locale("en_US.utf8");
-        auto iterMain = begin();
-        for (auto iterSub: str)
-        {
-            if (std::tolower(*iterMain++, utf8locale) != std::tolower(iterSub, utf8locale))
-                return false;
-        }
-        return true;
-    }
-    assert(!"Unknown tt::CASE value");
-    return false;
+    return ttlib::is_sameprefix(*this, str, checkcase);
 }
 
 size_t sview::locate(std::string_view str, size_t posStart, tt::CASE checkcase) const
@@ -78,174 +35,72 @@ size_t sview::locate(std::string_view str, size_t posStart, tt::CASE checkcase)
         return find(str, posStart);
 
     if (checkcase == tt::CASE::either)
-    {
-        auto chLower = std::tolower(str[0]);
-        for (auto pos = posStart; pos < length(); ++pos)
-        {
-            if (std::tolower(at(pos)) == chLower)
-            {
-                size_t posSub;
-                for (posSub = 1; posSub < str.length(); ++posSub)
-                {
-                    if (pos + posSub >= length())
-                        return npos;
-                    if (std::tolower(at(pos + posSub)) != std::tolower(str.at(posSub)))
-                        break;
-                }
-                if (posSub >= str.length())
-                    return pos;
-            }
-        }
-    }
-    else
-    {
-        auto utf8locale = std::locale("en_US.utf8");
-        auto chLower = std::tolower(str[0], utf8locale);
-        for (auto pos = posStart; pos < length(); ++pos)
-        {
-            if (std::tolower(at(pos), utf8locale) == chLower)
-            {
-                size_t posSub;
-                for (posSub = 1; posSub < str.length(); ++posSub)
-                {
-                    if (pos + posSub >= length())
-                        return npos;
-                    if (std::tolower(at(pos + posSub), utf8locale) != std::tolower(str.at(posSub), utf8locale))
-                        break;
-                }
-                if (posSub >= str.length())
-                    return pos;
-            }
-        }
-    }
-    return npos;
+        return ttlib::find_nocase(*this, str, posStart);
+
+    return ttlib::find_utf8(*this, str, posStart);
 }
 
 bool sview::moveto_space() noexcept
 {
-    if (empty())
-        return false;
-    size_t pos;
-    for (pos = 0; pos < length(); ++pos)
-    {
-        if (ttlib::is_whitespace(at(pos)))
-            break;
-    }
-    if (pos >= length())
+    auto pos = ttlib::find_class(*this, tt::cls_space);
+    if (pos == npos)
         return false;
-    else
-    {
-        remove_prefix(pos);
-        return true;
-    }
+    remove_prefix(pos);
+    return true;
 }
 
 bool sview::moveto_nonspace() noexcept
 {
-    if (empty())
-        return false;
-    size_t pos;
-    for (pos = 0; pos < length(); ++pos)
-    {
-        if (!ttlib::is_whitespace(at(pos)))
-            break;
-    }
-    if (pos >= length())
+    auto pos = ttlib::find_nonclass(*this, tt::cls_space);
+    if (pos == npos)
         return false;
-    else
-    {
-        remove_prefix(pos);
-        return true;
-    }
+    remove_prefix(pos);
+    return true;
 }
 
 bool sview::moveto_nextword() noexcept
 {
-    if (empty())
-        return false;
-    size_t pos;
-    for (pos = 0; pos < length(); ++pos)
-    {
-        if (ttlib::is_whitespace(at(pos)))
-            break;
-    }
-    if (pos >= length())
+    auto pos = ttlib::find_class(*this, tt::cls_space);
+    if (pos == npos)
         return false;
 
     // whitespace found, look for non-whitespace
-    else
-    {
-        for (++pos; pos < length(); ++pos)
-        {
-            if (!ttlib::is_whitespace(at(pos)))
-                break;
-        }
-        if (pos >= length())
-            return false;
+    pos = ttlib::find_nonclass(*this, tt::cls_space, pos);
+    if (pos == npos)
+        return false;
 
-        remove_prefix(pos);
-        return true;
-    }
+    remove_prefix(pos);
+    return true;
 }
 
 sview sview::view_digit(size_t start) const
 {
-    for (; start < length(); ++start)
-    {
-        if (ttlib::is_digit(at(start)))
-            return subview(start);
-    }
-
-    return subview(length());
+    auto pos = ttlib::find_class(*this, tt::cls_digit, start);
+    return subview(pos != npos ? pos : length());
 }
 
 sview sview::view_nondigit(size_t start) const
 {
-    for (; start < length(); ++start)
-    {
-        if (!ttlib::is_digit(at(start)))
-            return subview(start);
-    }
-
-    return subview(length());
+    auto pos = ttlib::find_nonclass(*this, tt::cls_digit, start);
+    return subview(pos != npos ? pos : length());
 }
 
 bool sview::moveto_digit() noexcept
 {
-    if (empty())
-        return false;
-    size_t pos;
-    for (pos = 0; pos < length(); ++pos)
-    {
-        if (ttlib::is_digit(at(pos)))
-            break;
-    }
-    if (pos >= length())
+    auto pos = ttlib::find_class(*this, tt::cls_digit);
+    if (pos == npos)
         return false;
-    else
-    {
-        remove_prefix(pos);
-        return true;
-    }
+    remove_prefix(pos);
+    return true;
 }
 
 bool sview::moveto_nondigit() noexcept
 {
-    if (empty())
-        return false;
-    size_t pos;
-    for (pos = 0; pos < length(); ++pos)
-    {
-        if (!ttlib::is_digit(at(pos)))
-            break;
-    }
-    if (pos >= length())
+    auto pos = ttlib::find_nonclass(*this, tt::cls_digit);
+    if (pos == npos)
         return false;
-    else
-    {
-        remove_prefix(pos);
-        return true;
-    }
+    remove_prefix(pos);
+    return true;
 }
 
 bool sview::moveto_extension() noexcept
@@ -313,6 +168,25 @@ bool sview::moveto_substr(std::string_view substr, bool StepOverIfFound) noexcep
     return true;
 }
 
+bool sview::advance(size_t count) noexcept
+{
+    auto pos = ttlib::utf8_offset(*this, count);
+    if (pos == npos)
+        return false;
+    remove_prefix(pos);
+    return true;
+}
+
+bool sview::retreat(size_t count, const char* begin) noexcept
+{
+    assert(begin && begin <= data());
+    auto pos = ttlib::utf8_offset_back(std::string_view(begin, static_cast<size_t>(data() - begin)), count);
+    if (pos == npos)
+        return false;
+    *this = sview(begin + pos, static_cast<size_t>(data() + size() - begin) - pos);
+    return true;
+}
+
 ttlib::sview sview::extension() const noexcept
 {
     if (empty())
@@ -404,41 +278,29 @@ size_t sview::find_oneof(const std::string& set, size_t start) const
 {
     if (set.empty())
         return tt::npos;
-
-    for (start = 0; start < length(); ++start)
-    {
-        if (std::strchr(set.c_str(), at(start)))
-            break;
-    }
-    return (start < length() ? start : tt::npos);
+    return ttlib::charset(set).find_oneof(*this, start);
 }
 
 size_t sview::find_oneof(sview set, size_t start) const
 {
     if (set.empty())
         return tt::npos;
-    std::string copy(set);
-    return find_oneof(copy, start);
+    return ttlib::charset(set).find_oneof(*this, start);
+}
+
+size_t sview::find_first_in(const ttlib::charset& set, size_t start) const
+{
+    return set.find_oneof(*this, start);
 }
 
 size_t sview::find_space(size_t start) const
 {
-    for (; start < length(); ++start)
-    {
-        if (std::strchr(" \t\r\n\f", at(start)))
-            break;
-    }
-    return (start < length() ? start : tt::npos);
+    return ttlib::find_class(*this, tt::cls_space, start);
 }
 
 size_t sview::find_nonspace(size_t start) const
 {
-    for (; start < length(); ++start)
-    {
-        if (!std::strchr(" \t\r\n\f", at(start)))
-            break;
-    }
-    return (start < length() ? start : tt::npos);
+    return ttlib::find_nonclass(*this, tt::cls_space, start);
 }
 
 size_t sview::stepover(size_t start) const
@@ -460,20 +322,7 @@ std::wstring sview::to_utf16() const
 
 int sview::comparei(std::string_view str) const
 {
-    auto main = begin();
-    auto sub = str.begin();
-    while (sub != str.end())
-    {
-        auto diff = std::tolower(main[0]) - std::tolower(sub[0]);
-        if (diff != 0)
-            return diff;
-        ++main;
-        ++sub;
-        if (main == end())
-            return (sub != str.end() ? -1 : 0);
-    }
-
-    return (main != end() ? 1 : 0);
+    return ttlib::comparei(*this, str);
 }
 
 /**
@@ -538,15 +387,8 @@ sview sview::subview(size_t start, size_t len) const
 
 sview sview::find_space(std::string_view str) noexcept
 {
-    if (str.empty())
-        return ttlib::emptystring;
-    size_t pos;
-    for (pos = 0; pos < str.length(); ++pos)
-    {
-        if (ttlib::is_whitespace(str.at(pos)))
-            break;
-    }
-    if (pos >= str.length())
+    auto pos = ttlib::find_class(str, tt::cls_space);
+    if (pos == tt::npos)
         return ttlib::emptystring;
     else
         return sview(str.data() + pos, str.length() - pos);
@@ -554,15 +396,8 @@ sview sview::find_space(std::string_view str) noexcept
 
 sview sview::find_nonspace(std::string_view str) noexcept
 {
-    if (str.empty())
-        return ttlib::emptystring;
-    size_t pos;
-    for (pos = 0; pos < str.length(); ++pos)
-    {
-        if (!ttlib::is_whitespace(str.at(pos)))
-            break;
-    }
-    if (pos >= str.length())
+    auto pos = ttlib::find_nonclass(str, tt::cls_space);
+    if (pos == tt::npos)
         return ttlib::emptystring;
     else
         return sview(str.data() + pos, str.length() - pos);
@@ -570,24 +405,8 @@ sview sview::find_nonspace(std::string_view str) noexcept
 
 sview sview::stepover(std::string_view str) noexcept
 {
-    if (str.empty())
-        return ttlib::emptystring;
-
-    size_t pos;
-    for (pos = 0; pos < str.length(); ++pos)
-    {
-        if (ttlib::is_whitespace(str.at(pos)))
-            break;
-    }
-    if (pos >= str.length())
-        return ttlib::emptystring;
-
-    for (; pos < str.length(); ++pos)
-    {
-        if (!ttlib::is_whitespace(str.at(pos)))
-            break;
-    }
-    if (pos >= str.length())
+    auto pos = ttlib::stepover_pos(str);
+    if (pos == tt::npos)
         return ttlib::emptystring;
     else
         return sview(str.data() + pos, str.length() - pos);
@@ -601,19 +420,9 @@ sview& sview::trim(tt::TRIM where)
     if (where == tt::TRIM::right || where == tt::TRIM::both)
     {
         auto len = length();
-        for (--len; len != std::string::npos; --len)
-        {
-            // char ch = at(len);
-            char ch = data()[len];
-            if (ch != ' ' && ch != '\t' && ch != '\r' && ch != '\n' && ch != '\f')
-            {
-                ++len;
-                break;
-            }
-        }
-
-        if (len < length())
-            remove_suffix(length() - len);
+        while (len > 0 && ttlib::is_whitespace(data()[len - 1]))
+            --len;
+        remove_suffix(length() - len);
     }
 
     // If trim(right) was called above, the string may now be empty -- front() fails on an empty string
@@ -624,13 +433,8 @@ sview& sview::trim(tt::TRIM where)
         if (!ttlib::is_whitespace(front()))
             return *this;
 
-        size_t pos;
-        for (pos = 1; pos < length(); ++pos)
-        {
-            if (!ttlib::is_whitespace(data()[pos]))
-                break;
-        }
-        remove_prefix(pos);
+        auto pos = ttlib::find_nonclass(*this, tt::cls_space, 1);
+        remove_prefix(pos != npos ? pos : length());
     }
 
     return *this;
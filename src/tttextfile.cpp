@@ -6,59 +6,292 @@
 // License:   Apache License -- see ../LICENSE
 /////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
 #include <fstream>
 
+#include "ttfilecache.h"   // Cache of file fingerprints, content hashes and line indexes
+#include "ttfilewriter.h"  // Buffered file writer that replaces the file atomically
 #include "ttlibspace.h"
+#include "ttmapfile.h"  // Read-only memory-mapped file
+#include "ttsearcher.h"
+#include "ttsimd.h"  // line_scanner, count_line_ends()
 #include "tttextfile.h"
+#include "ttutf.h"  // Unicode conversion, validation and decoding
 
 using namespace ttlib;
 using namespace tt;
 
-bool textfile::ReadFile(std::string_view filename)
+namespace
 {
-    m_filename.assign(filename);
-    clear();
-    std::ifstream file(m_filename, std::ios::binary);
-    if (!file.is_open())
-        return false;
-    std::string buf(std::istreambuf_iterator<char>(file), {});
-    if (buf.size() > 2)
+    // Files that need to be decoded are read in blocks of this size
+    constexpr size_t read_block_size = 64 * 1024;
+
+    // Number of bytes at the start of a file used to determine its encoding
+    constexpr size_t detect_sample_size = 4096;
+
+#if defined(_WIN32)
+    // Windows won't replace a file while a view of it is mapped, so a file that is still open in a
+    // viewfile couldn't be written (see the example at the top of tttextfile.h).
+    constexpr bool map_files = false;
+#else
+    constexpr bool map_files = true;
+#endif
+
+    // Returns the length of str up to and including the last line ending, or zero if there isn't one.
+    // A '\r' at the very end isn't included, since the next block may begin with the '\n' that
+    // completes it.
+    size_t complete_lines(std::string_view str)
+    {
+        auto pos = str.find_last_of("\r\n");
+        if (pos != tt::npos && pos + 1 == str.size() && str[pos] == '\r')
+            pos = pos ? str.find_last_of("\r\n", pos - 1) : tt::npos;
+        return (pos == tt::npos) ? 0 : pos + 1;
+    }
+
+    // Reserves buffer based on how much sample grew or shrank when it was decoded, plus a small
+    // margin, so that the buffer is rarely reallocated while size bytes are decoded into it.
+    void reserve_decoded(std::string& buffer, tt::ENCODING encoding, std::string_view sample, size_t size)
+    {
+        if (sample.empty())
+            return;
+        std::string decoded;
+        text_decoder(encoding).decode(sample, decoded);
+        buffer.reserve(size / sample.size() * decoded.size() + size / 32 + decoded.size());
+    }
+
+    // Makes room for count more lines. textfile::ReadFile() parses one block at a time, so the
+    // capacity is at least doubled to avoid reallocating for every block.
+    template <typename T>
+    void reserve_lines(std::vector<T>& lines, size_t count)
+    {
+        if (lines.size() + count > lines.capacity())
+            lines.reserve(std::max(lines.size() + count, lines.capacity() * 2));
+    }
+
+    // Reads the entire file into buffer, converting it to UTF8 and removing any byte order mark.
+    // invalid_utf8 is used the same way as textfile::ReadFile().
+    bool read_file(const std::string& filename, std::string& buffer, size_t* invalid_utf8)
     {
-        // Check for BOM LE or BOM UTF-8 -- other types are not supported.
-        if (buf[0] == static_cast<char>(0xFF) && buf[1] == static_cast<char>(0xFE))
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        size_t file_size = 0;
+        if (file.seekg(0, std::ios::end))
         {
-            // BOM LE format, so convert to utf-8 before parsing
-            auto utf8_buf = ttlib::utf16to8(reinterpret_cast<const wchar_t*>(buf.c_str() + 2));
-            ParseLines(utf8_buf);
+            auto file_end = file.tellg();
+            if (file_end > 0)
+                file_size = static_cast<size_t>(file_end);
+            file.seekg(0);
         }
-        else if (buf[0] == static_cast<char>(0xEF) && buf[1] == static_cast<char>(0xBB) && buf[1] == static_cast<char>(0xBF))
+        file.clear();
+
+        char sample[detect_sample_size];
+        file.read(sample, sizeof(sample));
+        auto sample_size = static_cast<size_t>(file.gcount());
+        size_t bom_size;
+        auto encoding = ttlib::detect_encoding(std::string_view(sample, sample_size), bom_size);
+        if (invalid_utf8 && encoding == tt::ENCODING::windows_1252)
+            encoding = tt::ENCODING::utf8;
+
+        std::string block(read_block_size, 0);
+        auto read_rest = [&](auto&& append)
+        {
+            append(std::string_view(sample + bom_size, sample_size - bom_size));
+            while (file)
+            {
+                file.read(block.data(), block.size());
+                append(std::string_view(block.data(), static_cast<size_t>(file.gcount())));
+            }
+        };
+
+        if (encoding == tt::ENCODING::utf8)
         {
-            // BOM utf-8 string, so skip over the BOM and process normally
-            ParseLines(buf.c_str() + 3);
+            // The rest of the file is read directly into the buffer if its size is known
+            buffer.assign(sample + bom_size, sample_size - bom_size);
+            if (file && file_size > sample_size)
+            {
+                auto used = buffer.size();
+                buffer.resize(used + file_size - sample_size);
+                file.read(buffer.data() + used, static_cast<std::streamsize>(file_size - sample_size));
+                buffer.resize(used + static_cast<size_t>(file.gcount()));
+            }
+            while (file)
+            {
+                file.read(block.data(), block.size());
+                buffer.append(block.data(), static_cast<size_t>(file.gcount()));
+            }
+            if (invalid_utf8)
+            {
+                auto invalid = ttlib::find_invalid_utf8(buffer);
+                if (invalid != tt::npos)
+                {
+                    *invalid_utf8 = bom_size + invalid;
+                    buffer.clear();
+                    return false;
+                }
+            }
         }
         else
         {
-            ParseLines(buf);
+            reserve_decoded(buffer, encoding, std::string_view(sample + bom_size, sample_size - bom_size),
+                            file_size > bom_size ? file_size - bom_size : 0);
+            text_decoder decoder(encoding);
+            read_rest([&](std::string_view data) { decoder.decode(data, buffer); });
+            decoder.finish(buffer);
         }
+        return true;
     }
-    else
+
+    template <typename T, typename U>
+    bool same_lines(const T& file, const U& other, tt::CASE checkcase)
+    {
+        if (file.size() != other.size())
+            return false;
+
+        // Unless checkcase is CASE::utf8, lines that are the same always have the same length.
+        // Comparing every length first finds most changes without reading any of the text.
+        if (checkcase != tt::CASE::utf8)
+        {
+            for (size_t pos = 0; pos < file.size(); ++pos)
+            {
+                if (std::string_view(file[pos]).size() != std::string_view(other[pos]).size())
+                    return false;
+            }
+        }
+
+        for (size_t pos = 0; pos < file.size(); ++pos)
+        {
+            if (!ttlib::is_sameas(file[pos], other[pos], checkcase))
+                return false;
+        }
+        return true;
+    }
+
+    // Returns the cache entry for the file, hashing and indexing text first if the file has changed
+    // since it was cached.
+    const filecache::entry& cached_lines(filecache& cache, std::string_view filename,
+                                         const filecache::fingerprint& stamp, std::string_view text)
+    {
+        auto entry = cache.find(filename, stamp);
+        if (!entry || entry->text_size != text.size())
+            entry = &cache.insert(filename, stamp, text);
+        return *entry;
+    }
+}  // anonymous namespace
+
+bool textfile::ReadFile(std::string_view filename, size_t* invalid_utf8)
+{
+    m_filename.assign(filename);
+    clear();
+    if (invalid_utf8)
+        *invalid_utf8 = tt::npos;
+    std::ifstream file(m_filename, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    // The file is decoded and parsed one block at a time, so only the lines and a single block are
+    // ever in memory. text holds decoded text that hasn't been parsed yet, which begins with any
+    // partial line left over from the previous block.
+    std::string block(read_block_size, 0);
+    std::string text;
+    text_decoder decoder;
+    size_t text_offset = 0;  // offset in the file of text[0] (only used for UTF-8 files)
+    bool check_utf8 = false;
+
+    auto is_valid = [&](std::string_view lines)
     {
-        // A file with only 2 bytes or less is probably worthless, but parse it anyway.
-        ParseLines(buf);
+        if (!check_utf8)
+            return true;
+        auto invalid = ttlib::find_invalid_utf8(lines);
+        if (invalid == tt::npos)
+            return true;
+        *invalid_utf8 = text_offset + invalid;
+        clear();
+        return false;
+    };
+
+    for (bool first = true;; first = false)
+    {
+        file.read(block.data(), block.size());
+        std::string_view data(block.data(), static_cast<size_t>(file.gcount()));
+        if (first)
+        {
+            size_t bom_size;
+            auto encoding = ttlib::detect_encoding(data, bom_size);
+            // If the caller wants invalid UTF-8 reported, it isn't converted from Windows-1252
+            if (invalid_utf8 && encoding == tt::ENCODING::windows_1252)
+                encoding = tt::ENCODING::utf8;
+            decoder = text_decoder(encoding);
+            data.remove_prefix(bom_size);
+            text_offset = bom_size;
+            // Files in any other encoding are converted, so only UTF-8 files can be invalid
+            check_utf8 = invalid_utf8 && decoder.encoding() == tt::ENCODING::utf8;
+        }
+        if (data.empty())
+            break;
+
+        // Only the newly decoded text can contain the last line ending (or the '\n' after a '\r'
+        // that was left at the end of the previous block).
+        auto search_start = text.empty() ? 0 : text.size() - 1;
+        decoder.decode(data, text);
+        auto length = complete_lines(std::string_view(text).substr(search_start));
+        if (length)
+        {
+            length += search_start;
+            // Line endings are ASCII, so complete lines never split a UTF-8 sequence
+            if (!is_valid(std::string_view(text).substr(0, length)))
+                return false;
+            ParseLines(std::string_view(text).substr(0, length));
+            text.erase(0, length);
+            text_offset += length;
+        }
+
+        if (!file)
+            break;
     }
+
+    decoder.finish(text);
+    if (!is_valid(text))
+        return false;
+    ParseLines(text);
     return true;
 }
 
-bool textfile::WriteFile(const std::string& filename) const
+bool textfile::WriteFile(const std::string& filename, bool sync) const
 {
-    std::ofstream file(filename, std::ios::binary);
-    if (!file.is_open())
+    ttlib::filewriter file;
+    if (!file.open(filename))
         return false;
-    for (auto iter: *this)
+    for (auto& iter: *this)
     {
-        file << iter << '\n';
+        file.write(iter);
+        file.write('\n');
     }
 
+    return file.commit(sync);
+}
+
+bool textfile::ReadFile(std::string_view filename, ttlib::filecache& cache)
+{
+    m_filename.assign(filename);
+    clear();
+
+    // The fingerprint is retrieved before the file is read, so that a change made while the file is
+    // being read will be noticed the next time.
+    filecache::fingerprint stamp;
+    std::string text;
+    if (!filecache::get_fingerprint(m_filename, stamp) || !read_file(m_filename, text, nullptr))
+        return false;
+
+    auto& entry = cached_lines(cache, m_filename, stamp, text);
+    reserve(entry.line_count);
+    if (!entry.for_each_line([&](size_t offset, size_t length)
+                             { emplace_back(std::string_view(text.data() + offset, length)); }))
+    {
+        clear();
+        ParseLines(text);
+    }
     return true;
 }
 
@@ -96,47 +329,28 @@ void textfile::ReadArray(const char** begin, size_t count)
 
 void textfile::ParseLines(std::string_view str)
 {
-    size_t posBeginLine = 0;
-    for (size_t pos = 0; pos < str.size(); ++pos)
-    {
-        if (str[pos] == '\r')
-        {
-            emplace_back();
-            if (pos > posBeginLine)
-            {
-                back().assign(str.substr(posBeginLine, pos - posBeginLine));
-            }
-            else
-            {
-                back().assign(ttlib::emptystring);
-            }
+    reserve_lines(*this, ttlib::count_line_ends(str.data(), str.size()));
 
-            // Some Apple format files only use \r. Windows files tend to use \r\n.
-            if (pos + 1 < str.size() && str[pos + 1] == '\n')
-                ++pos;
-            posBeginLine = pos + 1;
-        }
-        else if (str[pos] == '\n')
-        {
-            emplace_back();
-            if (pos > posBeginLine)
-            {
-                back().assign(str.substr(posBeginLine, pos - posBeginLine));
-            }
-            else
-            {
-                back().assign(ttlib::emptystring);
-            }
-            posBeginLine = pos + 1;
-        }
+    ttlib::line_scanner scanner(str.data(), str.size());
+    size_t begin = 0;
+    size_t length;
+    for (auto end = scanner.next(length); end != tt::npos; end = scanner.next(length))
+    {
+        emplace_back(str.substr(begin, end - begin));
+        begin = end + length;
     }
 }
 
 size_t textfile::FindLineContaining(std::string_view str, size_t start, tt::CASE checkcase) const
+{
+    return FindLineContaining(ttlib::searcher(str, checkcase), start);
+}
+
+size_t textfile::FindLineContaining(const ttlib::searcher& search, size_t start) const
 {
     for (; start < size(); ++start)
     {
-        if (at(start).contains(str, checkcase))
+        if (search.contains(at(start)))
             return start;
     }
     return tt::npos;
@@ -155,78 +369,109 @@ size_t textfile::ReplaceInLine(std::string_view orgStr, std::string_view newStr,
     return tt::npos;
 }
 
-bool textfile::is_sameas(viewfile other, CASE checkcase) const
+bool textfile::is_sameas(const viewfile& other, CASE checkcase) const
 {
-    if (size() != other.size())
-        return false;
+    return same_lines(*this, other, checkcase);
+}
 
-    size_t pos = 0;
-    for (; pos < other.size(); ++pos)
-    {
-        if (!at(pos).is_sameas(other[pos], checkcase))
-            break;
-    }
-    return (pos == size());
+bool textfile::is_sameas(const textfile& other, CASE checkcase) const
+{
+    return same_lines(*this, other, checkcase);
+}
+
+/////////////////////// ttViewFile /////////////////////////////////
+
+bool viewfile::ReadFile(std::string_view filename, size_t* invalid_utf8)
+{
+    if (!LoadFile(filename, invalid_utf8))
+        return false;
+    ParseLines(m_map ? m_mapped_text : std::string_view(m_buffer));
+    return true;
 }
 
-bool textfile::is_sameas(textfile other, CASE checkcase) const
+bool viewfile::ReadFile(std::string_view filename, ttlib::filecache& cache)
 {
-    if (size() != other.size())
+    // The fingerprint is retrieved before the file is read, so that a change made while the file is
+    // being read will be noticed the next time.
+    filecache::fingerprint stamp;
+    if (!filecache::get_fingerprint(filename, stamp) || !LoadFile(filename, nullptr))
         return false;
 
-    size_t pos = 0;
-    for (; pos < other.size(); ++pos)
+    std::string_view text = m_map ? m_mapped_text : std::string_view(m_buffer);
+    auto& entry = cached_lines(cache, m_filename, stamp, text);
+    reserve(entry.line_count);
+    auto add_line = [&](size_t offset, size_t length)
     {
-        if (!at(pos).is_sameas(other[pos], checkcase))
-            break;
+        if (length)
+            emplace_back(text.data() + offset, length);
+        else
+            emplace_back(nullptr, 0);
+    };
+    if (!entry.for_each_line(add_line))
+    {
+        clear();
+        ParseLines(text);
     }
-    return (pos == size());
+    return true;
 }
 
-/////////////////////// ttViewFile /////////////////////////////////
-
-bool viewfile::ReadFile(std::string_view filename)
+bool viewfile::LoadFile(std::string_view filename, size_t* invalid_utf8)
 {
     m_filename.assign(filename);
 
     clear();
-    std::ifstream file(m_filename, std::ios::binary);
-    if (!file.is_open())
-        return false;
-    m_buffer.assign(std::istreambuf_iterator<char>(file), {});
-    if (m_buffer.size() > 2)
+    m_buffer.clear();
+    m_map.reset();
+    m_mapped_text = {};
+    if (invalid_utf8)
+        *invalid_utf8 = tt::npos;
+
+    auto map = map_files ? std::make_shared<ttlib::mapfile>() : nullptr;
+    if (map && map->open(m_filename))
     {
-        // Check for BOM LE or BOM UTF-8 -- other types are not supported.
-        if (m_buffer[0] == static_cast<char>(0xFF) && m_buffer[1] == static_cast<char>(0xFE))
-        {
-            // BOM LE format, so convert to utf-8 before parsing
-            auto utf8_buf = ttlib::utf16to8(reinterpret_cast<const wchar_t*>(m_buffer.c_str() + 2));
-            m_buffer.clear();
-            m_buffer = std::move(utf8_buf);
-            ParseLines(m_buffer);
-        }
-        else if (m_buffer[0] == static_cast<char>(0xEF) && m_buffer[1] == static_cast<char>(0xBB) &&
-                 m_buffer[1] == static_cast<char>(0xBF))
-        {
-            // BOM utf-8 string, so skip over the BOM and process normally
-            ParseLines(m_buffer.c_str() + 3);
-        }
-        else
+        auto contents = map->view();
+        size_t bom_size;
+        auto encoding = ttlib::detect_encoding(contents.substr(0, detect_sample_size), bom_size);
+        if (invalid_utf8 && encoding == tt::ENCODING::windows_1252)
+            encoding = tt::ENCODING::utf8;
+        contents.remove_prefix(bom_size);
+
+        if (encoding == tt::ENCODING::utf8)
         {
-            ParseLines(m_buffer);
+            if (invalid_utf8)
+            {
+                auto invalid = ttlib::find_invalid_utf8(contents);
+                if (invalid != tt::npos)
+                {
+                    *invalid_utf8 = bom_size + invalid;
+                    return false;
+                }
+            }
+
+            // The lines point directly into the mapped file, which is kept open until the
+            // viewfile is destroyed or reused.
+            m_map = std::move(map);
+            m_mapped_text = contents;
+            return true;
         }
-    }
-    else
-    {
-        // A file with only 2 bytes or less is probably worthless, but parse it anyway.
-        ParseLines(m_buffer);
+
+        // Any other encoding is decoded into the buffer, after which the mapping isn't needed
+        reserve_decoded(m_buffer, encoding, contents.substr(0, detect_sample_size), contents.size());
+        text_decoder decoder(encoding);
+        for (size_t pos = 0; pos < contents.size(); pos += read_block_size)
+            decoder.decode(contents.substr(pos, read_block_size), m_buffer);
+        decoder.finish(m_buffer);
+        return true;
     }
 
-    return true;
+    // The file can't be mapped (e.g., it's a pipe or it's empty), so it is read normally
+    return read_file(m_filename, m_buffer, invalid_utf8);
 }
 
 void viewfile::ReadString(std::string_view str)
 {
+    m_map.reset();
+    m_mapped_text = {};
     if (!str.empty())
     {
         m_buffer.assign(str);
@@ -234,127 +479,348 @@ void viewfile::ReadString(std::string_view str)
     }
 }
 
-bool viewfile::WriteFile(const std::string& filename) const
+bool viewfile::WriteFile(const std::string& filename, bool sync) const
 {
-    std::ofstream file(filename, std::ios::binary);
-    if (!file.is_open())
+    ttlib::filewriter file;
+    if (!file.open(filename))
         return false;
-    for (auto iter: *this)
+    for (auto& iter: *this)
     {
-        file << iter << '\n';
+        file.write(iter);
+        file.write('\n');
     }
 
-    return true;
+    return file.commit(sync);
 }
 
 void viewfile::ParseLines(std::string_view str)
 {
-    size_t posBeginLine = 0;
-    for (size_t pos = 0; pos < str.size(); ++pos)
+    reserve_lines(*this, ttlib::count_line_ends(str.data(), str.size()));
+
+    ttlib::line_scanner scanner(str.data(), str.size());
+    size_t begin = 0;
+    size_t length;
+    for (auto end = scanner.next(length); end != tt::npos; end = scanner.next(length))
     {
-        if (str[pos] == '\r')
-        {
-            if (pos > posBeginLine)
-            {
-                emplace_back(str.data() + posBeginLine, pos - posBeginLine);
-            }
-            else
-            {
-                emplace_back(nullptr, 0);
-            }
+        if (end > begin)
+            emplace_back(str.data() + begin, end - begin);
+        else
+            emplace_back(nullptr, 0);
+        begin = end + length;
+    }
+}
 
-            // Some Apple format files only use \r. Windows files tend to use \r\n.
-            if (pos + 1 < str.size() && str[pos + 1] == '\n')
-                ++pos;
-            posBeginLine = pos + 1;
-        }
-        else if (str[pos] == '\n')
-        {
-            if (pos > posBeginLine)
-            {
-                emplace_back(str.data() + posBeginLine, pos - posBeginLine);
-            }
-            else
-            {
-                emplace_back(nullptr, 0);
-            }
-            posBeginLine = pos + 1;
-        }
+ttlib::cstr& viewfile::GetBuffer()
+{
+    if (m_map)
+    {
+        // The caller may change the buffer, so the lines need to point to a copy of the file
+        m_buffer.assign(m_mapped_text);
+        m_map.reset();
+        m_mapped_text = {};
+        clear();
+        ParseLines(m_buffer);
     }
+    return m_buffer;
 }
 
 void viewfile::ParseBuffer()
 {
     clear();
+    ParseLines(m_map ? m_mapped_text : std::string_view(m_buffer));
+}
+
+size_t viewfile::FindLineContaining(std::string_view str, size_t start, tt::CASE checkcase) const
+{
+    return FindLineContaining(ttlib::searcher(str, checkcase), start);
+}
+
+size_t viewfile::FindLineContaining(const ttlib::searcher& search, size_t start) const
+{
+    for (; start < size(); ++start)
+    {
+        if (search.contains(at(start)))
+            return start;
+    }
+    return tt::npos;
+}
+
+bool viewfile::is_sameas(const viewfile& other, CASE checkcase) const
+{
+    return same_lines(*this, other, checkcase);
+}
+
+bool viewfile::is_sameas(const textfile& other, CASE checkcase) const
+{
+    return same_lines(*this, other, checkcase);
+}
+
+/////////////////////// linereader /////////////////////////////////
+
+bool linereader::open(std::string_view filename)
+{
+    close();
+    m_filename.assign(filename);
+    m_file.open(m_filename, std::ios::binary);
+    if (!m_file.is_open())
+        return false;
+
+    // The first block is read as is so that its encoding can be determined
+    m_eof = false;
+    m_block.resize(std::max(m_block_size, detect_sample_size));
+    m_file.read(m_block.data(), m_block.size());
+    std::string_view data(m_block.data(), static_cast<size_t>(m_file.gcount()));
+    size_t bom_size;
+    m_decoder = text_decoder(ttlib::detect_encoding(data.substr(0, detect_sample_size), bom_size));
+    data.remove_prefix(bom_size);
+
+    if (m_decoder.encoding() == tt::ENCODING::utf8)
+    {
+        m_window.assign(data);
+        std::string().swap(m_block);  // UTF8 blocks are read directly into the window
+    }
+    else
+    {
+        m_decoder.decode(data, m_window);
+    }
+    if (!m_file)
+    {
+        m_eof = true;
+        m_decoder.finish(m_window);
+    }
+    return true;
+}
+
+void linereader::close()
+{
+    if (m_file.is_open())
+        m_file.close();
+    m_file.clear();
+    m_window.clear();
+    m_pos = 0;
+    m_line_number = 0;
+    m_eof = true;
+}
+
+bool linereader::fill()
+{
+    if (m_eof)
+        return false;
+
+    m_window.erase(0, m_pos);
+    m_pos = 0;
+    if (m_decoder.encoding() == tt::ENCODING::utf8)
+    {
+        auto used = m_window.size();
+        m_window.resize(used + m_block_size);
+        m_file.read(m_window.data() + used, m_block_size);
+        m_window.resize(used + static_cast<size_t>(m_file.gcount()));
+    }
+    else
+    {
+        m_block.resize(m_block_size);
+        m_file.read(m_block.data(), m_block.size());
+        m_decoder.decode(std::string_view(m_block.data(), static_cast<size_t>(m_file.gcount())), m_window);
+    }
+
+    if (!m_file)
+    {
+        m_eof = true;
+        m_decoder.finish(m_window);
+    }
+    return true;
+}
 
-    size_t posBeginLine = 0;
-    for (size_t pos = 0; pos < m_buffer.size(); ++pos)
+bool linereader::getline(ttlib::sview& line)
+{
+    size_t start = m_pos;  // where to start looking for the line ending
+    for (;;)
     {
-        if (m_buffer[pos] == '\r')
+        ttlib::line_scanner scanner(m_window.data() + start, m_window.size() - start);
+        size_t length;
+        auto end = scanner.next(length);
+        if (end != tt::npos)
         {
-            if (pos > posBeginLine)
+            end += start;
+            // A '\r' at the end of the window may be the first half of a "\r\n"
+            if (end + 1 < m_window.size() || m_window[end] == '\n' || m_eof)
             {
-                emplace_back(m_buffer.data() + posBeginLine, pos - posBeginLine);
+                line = ttlib::sview(m_window.data() + m_pos, end - m_pos);
+                m_pos = end + length;
+                ++m_line_number;
+                return true;
             }
-            else
-            {
-                emplace_back(nullptr, 0);
-            }
-
-            // Some Apple format files only use \r. Windows files tend to use \r\n.
-            if (pos + 1 < m_buffer.size() && m_buffer[pos + 1] == '\n')
-                ++pos;
-            posBeginLine = pos + 1;
         }
-        else if (m_buffer[pos] == '\n')
+        else
         {
-            if (pos > posBeginLine)
-            {
-                emplace_back(m_buffer.data() + posBeginLine, pos - posBeginLine);
-            }
-            else
-            {
-                emplace_back(nullptr, 0);
-            }
-            posBeginLine = pos + 1;
+            end = m_window.size();
         }
+
+        // Only the unread text is kept, so the search resumes at the same place relative to it
+        start = end - m_pos;
+        if (!fill())
+            break;
     }
+
+    if (m_pos < m_window.size())
+    {
+        line = ttlib::sview(m_window.data() + m_pos, m_window.size() - m_pos);
+        m_pos = m_window.size();
+        ++m_line_number;
+        return true;
+    }
+    return false;
 }
 
-size_t viewfile::FindLineContaining(std::string_view str, size_t start, tt::CASE checkcase) const
+/////////////////////// compactfile /////////////////////////////////
+
+bool compactfile::ReadFile(std::string_view filename, size_t* invalid_utf8)
 {
-    for (; start < size(); ++start)
+    m_filename.assign(filename);
+    clear();
+    if (invalid_utf8)
+        *invalid_utf8 = tt::npos;
+
+    // The file is read directly into the arena, and each line refers to its text in place
+    if (!read_file(m_filename, m_arena, invalid_utf8) || m_arena.size() >= overflow_line)
     {
-        if (ttlib::contains(at(start), str, checkcase))
-            return start;
+        clear();
+        return false;
     }
-    return tt::npos;
+    ParseArena(0);
+    return true;
 }
 
-bool viewfile::is_sameas(viewfile other, CASE checkcase) const
+void compactfile::ReadString(std::string_view str)
 {
-    if (size() != other.size())
-        return false;
+    if (str.empty() || m_arena.size() + str.size() >= overflow_line)
+        return;
+    auto start = m_arena.size();
+    m_arena.append(str);
+    ParseArena(start);
+}
 
-    size_t pos = 0;
-    for (; pos < other.size(); ++pos)
+void compactfile::clear()
+{
+    m_arena.clear();
+    m_lines.clear();
+    m_overflow.clear();
+}
+
+void compactfile::ParseArena(size_t start)
+{
+    std::string_view str(m_arena.data() + start, m_arena.size() - start);
+    reserve_lines(m_lines, ttlib::count_line_ends(str.data(), str.size()));
+
+    ttlib::line_scanner scanner(str.data(), str.size());
+    size_t begin = 0;
+    size_t length;
+    for (auto end = scanner.next(length); end != tt::npos; end = scanner.next(length))
     {
-        if (!ttlib::is_sameas(at(pos), other[pos], checkcase))
-            break;
+        m_lines.push_back({ static_cast<uint32_t>(start + begin), static_cast<uint32_t>(end - begin) });
+        begin = end + length;
     }
-    return (pos == size());
 }
 
-bool viewfile::is_sameas(textfile other, CASE checkcase) const
+bool compactfile::WriteFile(const std::string& filename, bool sync) const
 {
-    if (size() != other.size())
+    ttlib::filewriter file;
+    if (!file.open(filename))
         return false;
+    for (auto iter: *this)
+    {
+        file.write(iter);
+        file.write('\n');
+    }
+
+    return file.commit(sync);
+}
 
-    size_t pos = 0;
-    for (; pos < other.size(); ++pos)
+ttlib::cstr& compactfile::edit(size_t pos)
+{
+    auto& line = m_lines.at(pos);
+    if (line.length != overflow_line)
     {
-        if (!ttlib::is_sameas(at(pos), other[pos], checkcase))
-            break;
+        m_overflow.emplace_back(std::string_view(m_arena.data() + line.offset, line.length));
+        line = { static_cast<uint32_t>(m_overflow.size() - 1), overflow_line };
     }
-    return (pos == size());
+    return m_overflow[line.offset];
+}
+
+void compactfile::emplace_back(std::string_view str)
+{
+    insertLine(size(), str);
 }
+
+ttlib::cstr& compactfile::insertEmptyLine(size_t pos)
+{
+    return insertLine(pos, std::string_view());
+}
+
+ttlib::cstr& compactfile::insertLine(size_t pos, std::string_view str)
+{
+    auto& line = m_overflow.emplace_back(str);
+    line_span span { static_cast<uint32_t>(m_overflow.size() - 1), overflow_line };
+    if (pos >= size())
+        m_lines.push_back(span);
+    else
+        m_lines.insert(m_lines.begin() + pos, span);
+    return line;
+}
+
+void compactfile::RemoveLine(size_t line)
+{
+    assert(line < size());
+    if (line >= size())
+        return;
+
+    // An edited line's string is freed, but it stays in m_overflow so that the other lines
+    // don't need to be renumbered.
+    if (m_lines[line].length == overflow_line)
+        ttlib::cstr().swap(m_overflow[m_lines[line].offset]);
+    m_lines.erase(m_lines.begin() + line);
+}
+
+size_t compactfile::FindLineContaining(std::string_view str, size_t start, tt::CASE checkcase) const
+{
+    return FindLineContaining(ttlib::searcher(str, checkcase), start);
+}
+
+size_t compactfile::FindLineContaining(const ttlib::searcher& search, size_t start) const
+{
+    for (; start < size(); ++start)
+    {
+        if (search.contains((*this)[start]))
+            return start;
+    }
+    return tt::npos;
+}
+
+size_t compactfile::ReplaceInLine(std::string_view orgStr, std::string_view newStr, size_t posLine, tt::CASE checkcase)
+{
+    for (; posLine < size(); ++posLine)
+    {
+        if ((*this)[posLine].contains(orgStr, checkcase))
+        {
+            edit(posLine).Replace(orgStr, newStr, false, checkcase);
+            return posLine;
+        }
+    }
+    return tt::npos;
+}
+
+bool compactfile::is_sameas(const compactfile& other, CASE checkcase) const
+{
+    return same_lines(*this, other, checkcase);
+}
+
+bool compactfile::is_sameas(const textfile& other, CASE checkcase) const
+{
+    return same_lines(*this, other, checkcase);
+}
+
+bool compactfile::is_sameas(const viewfile& other, CASE checkcase) const
+{
+    return same_lines(*this, other, checkcase);
+}
+
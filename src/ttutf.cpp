@@ -0,0 +1,1213 @@
+/////////////////////////////////////////////////////////////////////////////
+// Name:      ttutf.cpp
+// Purpose:   Unicode conversion, validation and decoding
+// Author:    Ralph Walden
+// Copyright: Copyright (c) 2022 KeyWorks Software (Ralph Walden)
+// License:   Apache License -- see ../LICENSE
+/////////////////////////////////////////////////////////////////////////////
+
+// The size of the converted string is computed first with a vectorized count that assumes the input is
+// valid, and the destination is resized once. The conversion then stops at the first invalid sequence,
+// in which case the count is repeated by decoding every character. Both the exact count and the
+// conversion are instantiated from the same template, so they can't disagree.
+//
+// ASCII is checked 16 characters at a time using SSE2. A block that is entirely ASCII is widened or
+// narrowed with a few instructions. Otherwise the leading ASCII characters are copied and the
+// first non-ASCII character is decoded with scalar code.
+
+#include <algorithm>
+#include <cstring>
+
+#include "ttcstr.h"      // cstr -- Classes for handling zero-terminated char strings.
+#include "ttlibspace.h"  // ttlib namespace functions and declarations
+#include "ttsimd.h"      // ctz32(), popcount32(), has_avx2()
+#include "ttutf.h"       // Unicode conversion, validation and decoding
+
+using namespace ttlib;
+
+namespace
+{
+    // Returned by the decoders for an invalid sequence
+    constexpr uint32_t bad_sequence = 0x110000;
+    constexpr uint32_t replacement_char = 0xFFFD;
+
+    inline bool is_continuation(unsigned char ch) noexcept
+    {
+        return (ch & 0xC0) == 0x80;
+    }
+
+    // Decodes the character at ptr and sets length to the number of bytes used. If the sequence is
+    // invalid, length is the number of bytes that should be replaced with a single U+FFFD (the maximal
+    // subpart of an invalid sequence, as recommended by the Unicode standard).
+    inline uint32_t decode_utf8(const unsigned char* ptr, const unsigned char* end, size_t& length) noexcept
+    {
+        unsigned lead = ptr[0];
+        size_t available = static_cast<size_t>(end - ptr);
+        length = 1;
+        if (lead < 0x80)
+            return lead;
+
+        if (lead >= 0xC2 && lead <= 0xDF)
+        {
+            if (available < 2 || !is_continuation(ptr[1]))
+                return bad_sequence;
+            length = 2;
+            return ((lead & 0x1F) << 6) | (ptr[1] & 0x3F);
+        }
+
+        // The valid range of the second byte rules out overlong encodings, surrogates and values
+        // above U+10FFFF.
+        unsigned low = 0x80, high = 0xBF;
+        if (lead >= 0xE0 && lead <= 0xEF)
+        {
+            if (lead == 0xE0)
+                low = 0xA0;
+            else if (lead == 0xED)
+                high = 0x9F;
+            if (available < 2 || ptr[1] < low || ptr[1] > high)
+                return bad_sequence;
+            length = 2;
+            if (available < 3 || !is_continuation(ptr[2]))
+                return bad_sequence;
+            length = 3;
+            return ((lead & 0x0F) << 12) | ((ptr[1] & 0x3F) << 6) | (ptr[2] & 0x3F);
+        }
+
+        if (lead >= 0xF0 && lead <= 0xF4)
+        {
+            if (lead == 0xF0)
+                low = 0x90;
+            else if (lead == 0xF4)
+                high = 0x8F;
+            if (available < 2 || ptr[1] < low || ptr[1] > high)
+                return bad_sequence;
+            length = 2;
+            if (available < 3 || !is_continuation(ptr[2]))
+                return bad_sequence;
+            length = 3;
+            if (available < 4 || !is_continuation(ptr[3]))
+                return bad_sequence;
+            length = 4;
+            return ((lead & 0x07) << 18) | ((ptr[1] & 0x3F) << 12) | ((ptr[2] & 0x3F) << 6) | (ptr[3] & 0x3F);
+        }
+
+        return bad_sequence;
+    }
+
+    // Decodes the character at ptr, combining surrogate pairs, and sets length to the number of
+    // wchar_t values used.
+    inline uint32_t decode_wide(const wchar_t* ptr, const wchar_t* end, size_t& length) noexcept
+    {
+        uint32_t unit = static_cast<uint32_t>(ptr[0]);
+        if constexpr (sizeof(wchar_t) == 2)
+            unit &= 0xFFFF;
+        length = 1;
+        if (unit < 0xD800 || (unit > 0xDFFF && unit < 0x110000))
+            return unit;
+
+        if (unit <= 0xDBFF && end - ptr > 1)
+        {
+            uint32_t next = static_cast<uint32_t>(ptr[1]);
+            if constexpr (sizeof(wchar_t) == 2)
+                next &= 0xFFFF;
+            if (next >= 0xDC00 && next <= 0xDFFF)
+            {
+                length = 2;
+                return ((unit - 0xD800) << 10) + (next - 0xDC00) + 0x10000;
+            }
+        }
+        return bad_sequence;
+    }
+
+    inline size_t utf8_length(uint32_t code) noexcept
+    {
+        return code < 0x80 ? 1 : code < 0x800 ? 2 : code < 0x10000 ? 3 : 4;
+    }
+
+    inline void encode_utf8(uint32_t code, char* dest) noexcept
+    {
+        if (code < 0x80)
+        {
+            dest[0] = static_cast<char>(code);
+        }
+        else if (code < 0x800)
+        {
+            dest[0] = static_cast<char>(0xC0 | (code >> 6));
+            dest[1] = static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else if (code < 0x10000)
+        {
+            dest[0] = static_cast<char>(0xE0 | (code >> 12));
+            dest[1] = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            dest[2] = static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else
+        {
+            dest[0] = static_cast<char>(0xF0 | (code >> 18));
+            dest[1] = static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            dest[2] = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            dest[3] = static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+#if defined(TTLIB_SIMD_X86)
+    // Widens 16 ASCII characters into dest
+    inline void widen_ascii(__m128i bytes, wchar_t* dest) noexcept
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i low = _mm_unpacklo_epi8(bytes, zero);
+        __m128i high = _mm_unpackhi_epi8(bytes, zero);
+        if constexpr (sizeof(wchar_t) == 2)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), low);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 8), high);
+        }
+        else
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_unpacklo_epi16(low, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 4), _mm_unpackhi_epi16(low, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 8), _mm_unpacklo_epi16(high, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 12), _mm_unpackhi_epi16(high, zero));
+        }
+    }
+
+    // Loads 16 wchar_t values, sets ascii to a 16-bit mask with a bit set for each value below 0x80,
+    // and returns the values packed into bytes (only meaningful for the ASCII values).
+    inline __m128i narrow_ascii(const wchar_t* src, uint32_t& ascii) noexcept
+    {
+        const __m128i zero = _mm_setzero_si128();
+        auto ptr = reinterpret_cast<const __m128i*>(src);
+        if constexpr (sizeof(wchar_t) == 2)
+        {
+            const __m128i non_ascii = _mm_set1_epi16(static_cast<short>(0xFF80));
+            __m128i first = _mm_loadu_si128(ptr);
+            __m128i second = _mm_loadu_si128(ptr + 1);
+            __m128i is_ascii = _mm_packs_epi16(_mm_cmpeq_epi16(_mm_and_si128(first, non_ascii), zero),
+                                               _mm_cmpeq_epi16(_mm_and_si128(second, non_ascii), zero));
+            ascii = static_cast<uint32_t>(_mm_movemask_epi8(is_ascii));
+            return _mm_packus_epi16(first, second);
+        }
+        else
+        {
+            const __m128i non_ascii = _mm_set1_epi32(static_cast<int>(0xFFFFFF80));
+            __m128i v0 = _mm_loadu_si128(ptr);
+            __m128i v1 = _mm_loadu_si128(ptr + 1);
+            __m128i v2 = _mm_loadu_si128(ptr + 2);
+            __m128i v3 = _mm_loadu_si128(ptr + 3);
+            __m128i low = _mm_packs_epi32(_mm_cmpeq_epi32(_mm_and_si128(v0, non_ascii), zero),
+                                          _mm_cmpeq_epi32(_mm_and_si128(v1, non_ascii), zero));
+            __m128i high = _mm_packs_epi32(_mm_cmpeq_epi32(_mm_and_si128(v2, non_ascii), zero),
+                                           _mm_cmpeq_epi32(_mm_and_si128(v3, non_ascii), zero));
+            ascii = static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(low, high)));
+            return _mm_packus_epi16(_mm_packs_epi32(v0, v1), _mm_packs_epi32(v2, v3));
+        }
+    }
+#endif  // TTLIB_SIMD_X86
+
+    // Returns the size of the converted string, assuming str is valid UTF8. Every byte that isn't a
+    // continuation byte starts a character, and if wchar_t is 2 bytes, each 4-byte sequence needs a
+    // surrogate pair.
+    size_t wide_size_if_valid(std::string_view str) noexcept
+    {
+        auto ptr = reinterpret_cast<const unsigned char*>(str.data());
+        auto end = ptr + str.size();
+        size_t count = 0;
+#if defined(TTLIB_SIMD_X86)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i last_continuation = _mm_set1_epi8(static_cast<char>(0xBF));
+        const __m128i before_four_byte = _mm_set1_epi8(static_cast<char>(0xEF));
+        while (end - ptr >= 16)
+        {
+            // Each byte counter is increased by at most 2 per block, so it can't overflow in 127 blocks
+            auto blocks = static_cast<size_t>(end - ptr) / 16;
+            if (blocks > 127)
+                blocks = 127;
+            __m128i sum = zero;
+            for (; blocks; --blocks, ptr += 16)
+            {
+                // Comparisons are signed: ASCII and 0xC0-0xFF are above 0xBF, and 0xF0-0xFF are the
+                // only negative values above 0xEF. Subtracting a true (-1) result adds one.
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+                sum = _mm_sub_epi8(sum, _mm_cmpgt_epi8(bytes, last_continuation));
+                if constexpr (sizeof(wchar_t) == 2)
+                {
+                    sum = _mm_sub_epi8(
+                        sum, _mm_and_si128(_mm_cmpgt_epi8(bytes, before_four_byte), _mm_cmplt_epi8(bytes, zero)));
+                }
+            }
+            __m128i totals = _mm_sad_epu8(sum, zero);
+            count += static_cast<size_t>(_mm_cvtsi128_si32(totals)) + static_cast<size_t>(_mm_extract_epi16(totals, 4));
+        }
+#endif  // TTLIB_SIMD_X86
+
+        for (; ptr < end; ++ptr)
+        {
+            count += !is_continuation(*ptr);
+            if (sizeof(wchar_t) == 2 && *ptr >= 0xF0)
+                ++count;
+        }
+        return count;
+    }
+
+    // Returns the size of the converted string, assuming str doesn't contain any unpaired surrogates.
+    // Each half of a surrogate pair adds 2, for a total of 4.
+    size_t utf8_size_if_valid(std::wstring_view str) noexcept
+    {
+        auto ptr = str.data();
+        auto end = ptr + str.size();
+        size_t count = 0;
+#if defined(TTLIB_SIMD_X86)
+        // Each 128-bit register holds this many wchar_t values
+        constexpr size_t lanes = 16 / sizeof(wchar_t);
+        constexpr size_t max_size = sizeof(wchar_t) == 2 ? 3 : 4;
+
+        const __m128i zero = _mm_setzero_si128();
+        while (static_cast<size_t>(end - ptr) >= lanes)
+        {
+            // 16-bit counters are decreased by at most 3 per block, so they can't overflow in 8192 blocks
+            auto blocks = static_cast<size_t>(end - ptr) / lanes;
+            if (blocks > 8192)
+                blocks = 8192;
+            count += blocks * lanes * max_size;
+
+            // Starting with the maximum size for every value, a true (-1) comparison subtracts one for
+            // each size threshold that the value is below, and for each surrogate.
+            __m128i sum = zero;
+            for (; blocks; --blocks, ptr += lanes)
+            {
+                __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+                if constexpr (sizeof(wchar_t) == 2)
+                {
+                    const __m128i below_800 = _mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xF800)));
+                    sum = _mm_add_epi16(
+                        sum, _mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xFF80))), zero));
+                    sum = _mm_add_epi16(sum, _mm_cmpeq_epi16(below_800, zero));
+                    sum = _mm_add_epi16(sum, _mm_cmpeq_epi16(below_800, _mm_set1_epi16(static_cast<short>(0xD800))));
+                }
+                else
+                {
+                    const __m128i below_800 = _mm_and_si128(units, _mm_set1_epi32(static_cast<int>(0xFFFFF800)));
+                    sum = _mm_add_epi32(
+                        sum, _mm_cmpeq_epi32(_mm_and_si128(units, _mm_set1_epi32(static_cast<int>(0xFFFFFF80))), zero));
+                    sum = _mm_add_epi32(sum, _mm_cmpeq_epi32(below_800, zero));
+                    sum = _mm_add_epi32(sum, _mm_cmpeq_epi32(below_800, _mm_set1_epi32(0xD800)));
+                    sum = _mm_add_epi32(
+                        sum, _mm_cmpeq_epi32(_mm_and_si128(units, _mm_set1_epi32(static_cast<int>(0xFFFF0000))), zero));
+                }
+            }
+
+            if constexpr (sizeof(wchar_t) == 2)
+                sum = _mm_madd_epi16(sum, _mm_set1_epi16(1));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+            count -= static_cast<size_t>(-_mm_cvtsi128_si32(sum));
+        }
+#endif  // TTLIB_SIMD_X86
+
+        for (; ptr < end; ++ptr)
+        {
+            uint32_t unit = static_cast<uint32_t>(*ptr);
+            if constexpr (sizeof(wchar_t) == 2)
+                unit &= 0xFFFF;
+            if (unit >= 0xD800 && unit <= 0xDFFF)
+                count += 2;
+            else
+                count += utf8_length(unit);
+        }
+        return count;
+    }
+
+    // If WRITE is false, dest is ignored and only the size of the output is computed. If STOP is true,
+    // the conversion stops at the first invalid sequence and returns tt::npos.
+    template <bool WRITE, bool STOP>
+    size_t utf8_to_wide(std::string_view str, wchar_t* dest, bool& valid) noexcept
+    {
+        auto ptr = reinterpret_cast<const unsigned char*>(str.data());
+        auto end = ptr + str.size();
+        size_t count = 0;
+        while (ptr < end)
+        {
+#if defined(TTLIB_SIMD_X86)
+            // Text that isn't mostly ASCII would waste time checking for ASCII after every character
+            if (*ptr < 0x80 && end - ptr >= 16)
+            {
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+                auto non_ascii = static_cast<uint32_t>(_mm_movemask_epi8(bytes));
+                if (!non_ascii)
+                {
+                    if constexpr (WRITE)
+                        widen_ascii(bytes, dest + count);
+                    ptr += 16;
+                    count += 16;
+                    continue;
+                }
+
+                auto ascii_count = ctz32(non_ascii);
+                if constexpr (WRITE)
+                {
+                    for (size_t idx = 0; idx < ascii_count; ++idx)
+                        dest[count + idx] = static_cast<wchar_t>(ptr[idx]);
+                }
+                ptr += ascii_count;
+                count += ascii_count;
+            }
+#endif  // TTLIB_SIMD_X86
+
+            size_t length;
+            auto code = decode_utf8(ptr, end, length);
+            ptr += length;
+            if (code == bad_sequence)
+            {
+                if constexpr (STOP)
+                    return tt::npos;
+                code = replacement_char;
+                valid = false;
+            }
+
+            if (sizeof(wchar_t) == 2 && code > 0xFFFF)
+            {
+                if constexpr (WRITE)
+                {
+                    dest[count] = static_cast<wchar_t>((code >> 10) + 0xD7C0);
+                    dest[count + 1] = static_cast<wchar_t>((code & 0x3FF) + 0xDC00);
+                }
+                count += 2;
+            }
+            else
+            {
+                if constexpr (WRITE)
+                    dest[count] = static_cast<wchar_t>(code);
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    template <bool WRITE, bool STOP>
+    size_t wide_to_utf8(std::wstring_view str, char* dest, bool& valid) noexcept
+    {
+        auto ptr = str.data();
+        auto end = ptr + str.size();
+        size_t count = 0;
+        while (ptr < end)
+        {
+#if defined(TTLIB_SIMD_X86)
+            if (static_cast<uint32_t>(*ptr) < 0x80 && end - ptr >= 16)
+            {
+                uint32_t ascii;
+                __m128i bytes = narrow_ascii(ptr, ascii);
+                if (ascii == 0xFFFF)
+                {
+                    if constexpr (WRITE)
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + count), bytes);
+                    ptr += 16;
+                    count += 16;
+                    continue;
+                }
+
+                auto ascii_count = ctz32(~ascii);
+                if constexpr (WRITE)
+                {
+                    for (size_t idx = 0; idx < ascii_count; ++idx)
+                        dest[count + idx] = static_cast<char>(ptr[idx]);
+                }
+                ptr += ascii_count;
+                count += ascii_count;
+            }
+#endif  // TTLIB_SIMD_X86
+
+            size_t length;
+            auto code = decode_wide(ptr, end, length);
+            ptr += length;
+            if (code == bad_sequence)
+            {
+                if constexpr (STOP)
+                    return tt::npos;
+                code = replacement_char;
+                valid = false;
+            }
+
+            if constexpr (WRITE)
+                encode_utf8(code, dest + count);
+            count += utf8_length(code);
+        }
+        return count;
+    }
+
+#if defined(TTLIB_SIMD_X86)
+    // Error bits for the validation lookup tables. Each pair of adjacent bytes is looked up by the high
+    // and low nibbles of the first byte and the high nibble of the second byte -- a bit that is set in
+    // all three results is an error.
+    constexpr uint8_t too_short = 1 << 0;   // lead byte followed by a lead byte or ASCII
+    constexpr uint8_t too_long = 1 << 1;    // ASCII followed by a continuation byte
+    constexpr uint8_t overlong_3 = 1 << 2;  // 11100000 100_____
+    constexpr uint8_t too_large = 1 << 3;   // 11110100 1001____ or 11110100 101_____ or 11110101+
+    constexpr uint8_t surrogate = 1 << 4;   // 11101101 101_____
+    constexpr uint8_t overlong_2 = 1 << 5;  // 1100000_ 10______
+    constexpr uint8_t too_large_1000 = 1 << 6;
+    constexpr uint8_t overlong_4 = 1 << 6;  // 11110000 1000____
+    constexpr uint8_t two_conts = 1 << 7;   // continuation followed by continuation
+    constexpr uint8_t carry = too_short | too_long | two_conts;
+
+    alignas(16) constexpr uint8_t byte1_high_table[16] = {
+        // 0_______ (ASCII)
+        too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+        // 10______ (continuation)
+        two_conts, two_conts, two_conts, two_conts,
+        // 1100____, 1101____ (2-byte lead)
+        too_short | overlong_2, too_short,
+        // 1110____ (3-byte lead)
+        too_short | overlong_3 | surrogate,
+        // 1111____ (4-byte lead)
+        too_short | too_large | too_large_1000 | overlong_4,
+    };
+
+    alignas(16) constexpr uint8_t byte1_low_table[16] = {
+        // ____0000
+        carry | overlong_3 | overlong_2 | overlong_4,
+        // ____0001
+        carry | overlong_2,
+        // ____001_
+        carry,
+        carry,
+        // ____0100
+        carry | too_large,
+        // ____0101 through ____1100
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        // ____1101
+        carry | too_large | too_large_1000 | surrogate,
+        // ____111_
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+    };
+
+    alignas(16) constexpr uint8_t byte2_high_table[16] = {
+        // 0_______ (ASCII)
+        too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+        // 1000____
+        too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4,
+        // 1001____
+        too_long | overlong_2 | two_conts | overlong_3 | too_large,
+        // 101_____
+        too_long | overlong_2 | two_conts | surrogate | too_large,
+        too_long | overlong_2 | two_conts | surrogate | too_large,
+        // 11______ (lead)
+        too_short, too_short, too_short, too_short,
+    };
+
+    TT_TARGET_AVX2 inline __m256i load_table(const uint8_t* table) noexcept
+    {
+        return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(table)));
+    }
+
+    // Returns non-zero bytes wherever input (preceded by the previous block) contains an error. Errors
+    // that depend on bytes after the end of input are handled by the caller.
+    TT_TARGET_AVX2 inline __m256i check_utf8_block(__m256i input, __m256i prev_input) noexcept
+    {
+        const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+
+        // The previous 1, 2 and 3 bytes for each byte position
+        __m256i carried = _mm256_permute2x128_si256(prev_input, input, 0x21);
+        __m256i prev1 = _mm256_alignr_epi8(input, carried, 15);
+        __m256i prev2 = _mm256_alignr_epi8(input, carried, 14);
+        __m256i prev3 = _mm256_alignr_epi8(input, carried, 13);
+
+        __m256i byte1_high =
+            _mm256_shuffle_epi8(load_table(byte1_high_table), _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble));
+        __m256i byte1_low = _mm256_shuffle_epi8(load_table(byte1_low_table), _mm256_and_si256(prev1, low_nibble));
+        __m256i byte2_high =
+            _mm256_shuffle_epi8(load_table(byte2_high_table), _mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble));
+        __m256i special_cases = _mm256_and_si256(_mm256_and_si256(byte1_high, byte1_low), byte2_high);
+
+        // Two continuation bytes are only valid as the 3rd byte after a 3 or 4-byte lead, or the 4th
+        // byte after a 4-byte lead. Only bytes of 0xE0 and above (or 0xF0 and above) have the high bit
+        // set after the subtraction.
+        __m256i is_third = _mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+        __m256i is_fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+        __m256i must_be_cont =
+            _mm256_and_si256(_mm256_or_si256(is_third, is_fourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+        return _mm256_xor_si256(must_be_cont, special_cases);
+    }
+
+    // Returns the offset of the first block that contains an error (the error may be up to 3 bytes
+    // before it), or tt::npos if str is valid. str must contain at least 32 bytes.
+    TT_TARGET_AVX2 size_t validate_avx2(const unsigned char* str, size_t size) noexcept
+    {
+        // A lead byte in the last 3 positions needs bytes from the next block
+        const __m256i max_value =
+            _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                             -1, -1, -1, -1, -1, -1, -1, static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1),
+                             static_cast<char>(0xC0 - 1));
+
+        __m256i prev_input = _mm256_setzero_si256();
+        __m256i prev_incomplete = _mm256_setzero_si256();
+        unsigned char tail[32];
+        size_t pos = 0;
+        for (;;)
+        {
+            const unsigned char* block = str + pos;
+            if (pos + 32 > size)
+            {
+                // The last partial block is padded with zeros, which are checked the same as ASCII
+                if (pos == size)
+                    break;
+                std::memset(tail, 0, sizeof(tail));
+                std::memcpy(tail, block, size - pos);
+                block = tail;
+            }
+
+            __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+            __m256i error;
+            if (!_mm256_movemask_epi8(input))
+            {
+                error = prev_incomplete;
+                prev_incomplete = _mm256_setzero_si256();
+            }
+            else
+            {
+                error = check_utf8_block(input, prev_input);
+                prev_incomplete = _mm256_subs_epu8(input, max_value);
+            }
+            if (!_mm256_testz_si256(error, error))
+            {
+                _mm256_zeroupper();
+                return pos;
+            }
+            prev_input = input;
+            if (block == tail)
+            {
+                pos = size;
+                break;
+            }
+            pos += 32;
+        }
+
+        bool incomplete = !_mm256_testz_si256(prev_incomplete, prev_incomplete);
+        _mm256_zeroupper();
+        return incomplete ? pos : tt::npos;
+    }
+#endif  // TTLIB_SIMD_X86
+
+    // Windows-1252 characters 0x80 through 0x9F. Undefined values map to the matching C1 control
+    // character, the same as the WHATWG encoding standard.
+    constexpr uint16_t windows_1252_table[32] = {
+        0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021, 0x02C6, 0x2030, 0x0160,
+        0x2039, 0x0152, 0x008D, 0x017D, 0x008F, 0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022,
+        0x2013, 0x2014, 0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+    };
+
+    inline uint32_t read16(const unsigned char* ptr, bool big_endian) noexcept
+    {
+        return big_endian ? (static_cast<uint32_t>(ptr[0]) << 8) | ptr[1] :
+                            (static_cast<uint32_t>(ptr[1]) << 8) | ptr[0];
+    }
+
+    inline uint32_t read32(const unsigned char* ptr, bool big_endian) noexcept
+    {
+        return big_endian ? (read16(ptr, true) << 16) | read16(ptr + 2, true) :
+                            (read16(ptr + 2, false) << 16) | read16(ptr, false);
+    }
+
+#if defined(TTLIB_SIMD_X86)
+    // Sums the lead bytes in 8-bit lanes for up to 255 blocks at a time before adding the lanes
+    // together. Continuation bytes (0x80-0xBF) are the only values below -64 as signed bytes.
+    TT_TARGET_AVX2 size_t count_leads_avx2(const unsigned char* ptr, size_t blocks) noexcept
+    {
+        const __m256i threshold = _mm256_set1_epi8(-65);
+        const __m256i zero = _mm256_setzero_si256();
+        size_t count = 0;
+        while (blocks)
+        {
+            size_t batch = blocks < 255 ? blocks : 255;
+            blocks -= batch;
+            __m256i sums = zero;
+            for (; batch; --batch, ptr += 32)
+            {
+                __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+                sums = _mm256_sub_epi8(sums, _mm256_cmpgt_epi8(input, threshold));
+            }
+            alignas(32) uint64_t lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), _mm256_sad_epu8(sums, zero));
+            count += static_cast<size_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+        }
+        _mm256_zeroupper();
+        return count;
+    }
+
+    size_t count_leads_sse2(const unsigned char* ptr, size_t blocks) noexcept
+    {
+        const __m128i threshold = _mm_set1_epi8(-65);
+        const __m128i zero = _mm_setzero_si128();
+        size_t count = 0;
+        while (blocks)
+        {
+            size_t batch = blocks < 255 ? blocks : 255;
+            blocks -= batch;
+            __m128i sums = zero;
+            for (; batch; --batch, ptr += 16)
+            {
+                __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+                sums = _mm_sub_epi8(sums, _mm_cmpgt_epi8(input, threshold));
+            }
+            __m128i total = _mm_sad_epu8(sums, zero);
+            count += static_cast<size_t>(_mm_cvtsi128_si32(total)) +
+                     static_cast<size_t>(_mm_cvtsi128_si32(_mm_srli_si128(total, 8)));
+        }
+        return count;
+    }
+
+    // Returns a bit for each of the 32 bytes at ptr that starts a character
+    inline uint32_t lead_mask(const unsigned char* ptr) noexcept
+    {
+        const __m128i threshold = _mm_set1_epi8(-65);
+        auto low = _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr)), threshold));
+        auto high =
+            _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + 16)), threshold));
+        return static_cast<uint32_t>(low) | (static_cast<uint32_t>(high) << 16);
+    }
+
+    // Returns the position of the nth (zero-based) lowest set bit. mask must have more than n bits set.
+    inline unsigned nth_low_bit(uint32_t mask, size_t n) noexcept
+    {
+        for (; n; --n)
+            mask &= mask - 1;
+        return ctz32(mask);
+    }
+
+    // Returns the position of the nth (zero-based) highest set bit. mask must have more than n bits set.
+    inline unsigned nth_high_bit(uint32_t mask, size_t n) noexcept
+    {
+        for (; n; --n)
+            mask &= ~(1u << high_bit32(mask));
+        return high_bit32(mask);
+    }
+#endif  // TTLIB_SIMD_X86
+
+    size_t count_leads(const unsigned char* ptr, size_t size) noexcept
+    {
+        size_t count = 0;
+#if defined(TTLIB_SIMD_X86)
+        if (size >= 32 && has_avx2())
+        {
+            count = count_leads_avx2(ptr, size / 32);
+            ptr += size / 32 * 32;
+            size %= 32;
+        }
+        count += count_leads_sse2(ptr, size / 16);
+        ptr += size / 16 * 16;
+        size %= 16;
+#endif  // TTLIB_SIMD_X86
+
+        for (; size; --size, ++ptr)
+            count += !is_continuation(*ptr);
+        return count;
+    }
+
+    // Below this many bytes, it's faster to check each block for the character than to count the
+    // characters in all of the blocks first.
+    constexpr size_t min_bulk_count = 256;
+}  // anonymous namespace
+
+size_t ttlib::find_invalid_utf8(std::string_view str) noexcept
+{
+    auto begin = reinterpret_cast<const unsigned char*>(str.data());
+    auto ptr = begin;
+    auto end = begin + str.size();
+
+#if defined(TTLIB_SIMD_X86)
+    if (str.size() >= 32 && has_avx2())
+    {
+        auto block = validate_avx2(begin, str.size());
+        if (block == tt::npos)
+            return tt::npos;
+
+        // Everything before the block is valid, so the error is in the block or in a sequence that
+        // started in the previous 3 bytes. Continuation bytes are skipped to find a character that
+        // starts within those 3 bytes.
+        ptr = begin + (block > 3 ? block - 3 : 0);
+        while (ptr < begin + block && is_continuation(*ptr))
+            ++ptr;
+    }
+#endif  // TTLIB_SIMD_X86
+
+    while (ptr < end)
+    {
+#if defined(TTLIB_SIMD_X86)
+        if (*ptr < 0x80 && end - ptr >= 16)
+        {
+            auto non_ascii =
+                static_cast<uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr))));
+            if (!non_ascii)
+            {
+                ptr += 16;
+                continue;
+            }
+            ptr += ctz32(non_ascii);
+        }
+#endif  // TTLIB_SIMD_X86
+
+        size_t length;
+        if (decode_utf8(ptr, end, length) == bad_sequence)
+            return static_cast<size_t>(ptr - begin);
+        ptr += length;
+    }
+    return tt::npos;
+}
+
+size_t ttlib::utf16_size(std::string_view str) noexcept
+{
+    bool valid = true;
+    return utf8_to_wide<false, false>(str, nullptr, valid);
+}
+
+size_t ttlib::utf8_size(std::wstring_view str) noexcept
+{
+    bool valid = true;
+    return wide_to_utf8<false, false>(str, nullptr, valid);
+}
+
+size_t ttlib::utf8_count(std::string_view str) noexcept
+{
+    return count_leads(reinterpret_cast<const unsigned char*>(str.data()), str.size());
+}
+
+size_t ttlib::utf8_offset(std::string_view str, size_t index) noexcept
+{
+    auto begin = reinterpret_cast<const unsigned char*>(str.data());
+    auto ptr = begin;
+    auto end = begin + str.size();
+
+    // Every character is at least one byte, so the character can't be within the next index bytes.
+    // Those bytes are counted in bulk, which is repeated until the character is close.
+    for (;;)
+    {
+        size_t skip = std::min(index, static_cast<size_t>(end - ptr)) & ~static_cast<size_t>(31);
+        if (skip < min_bulk_count)
+            break;
+        index -= count_leads(ptr, skip);
+        ptr += skip;
+    }
+
+#if defined(TTLIB_SIMD_X86)
+    while (end - ptr >= 32)
+    {
+        auto mask = lead_mask(ptr);
+        auto count = popcount32(mask);
+        if (count > index)
+            return static_cast<size_t>(ptr - begin) + nth_low_bit(mask, index);
+        index -= count;
+        ptr += 32;
+    }
+#endif  // TTLIB_SIMD_X86
+
+    for (; ptr < end; ++ptr)
+    {
+        if (!is_continuation(*ptr))
+        {
+            if (!index)
+                return static_cast<size_t>(ptr - begin);
+            --index;
+        }
+    }
+    return index ? tt::npos : str.size();
+}
+
+size_t ttlib::utf8_offset_back(std::string_view str, size_t count) noexcept
+{
+    if (!count)
+        return str.size();
+
+    auto begin = reinterpret_cast<const unsigned char*>(str.data());
+    auto end = begin + str.size();
+
+    // The character starts at least count bytes before the end. If all of those bytes are
+    // characters, then the first one is the character.
+    for (;;)
+    {
+        size_t skip = std::min(count, static_cast<size_t>(end - begin)) & ~static_cast<size_t>(31);
+        if (skip < min_bulk_count)
+            break;
+        end -= skip;
+        count -= count_leads(end, skip);
+        if (!count)
+            return static_cast<size_t>(end - begin);
+    }
+
+#if defined(TTLIB_SIMD_X86)
+    while (end - begin >= 32)
+    {
+        end -= 32;
+        auto mask = lead_mask(end);
+        auto leads = popcount32(mask);
+        if (leads >= count)
+            return static_cast<size_t>(end - begin) + nth_high_bit(mask, count - 1);
+        count -= leads;
+    }
+#endif  // TTLIB_SIMD_X86
+
+    while (end > begin)
+    {
+        --end;
+        if (!is_continuation(*end) && !--count)
+            return static_cast<size_t>(end - begin);
+    }
+    return tt::npos;
+}
+
+void utf8_index::build(std::string_view str, size_t interval)
+{
+    m_str = str;
+    m_interval = interval ? interval : 1;
+    m_offsets.clear();
+    m_offsets.reserve(str.size() / m_interval + 1);
+    m_count = 0;
+
+    auto pos = utf8_offset(str, 0);
+    for (;;)
+    {
+        m_offsets.push_back(pos);
+        auto next = utf8_offset(str.substr(pos), m_interval);
+        if (next == tt::npos)
+            break;
+        pos += next;
+        m_count += m_interval;
+    }
+    m_count += utf8_count(str.substr(pos));
+}
+
+size_t utf8_index::offset(size_t index) const noexcept
+{
+    if (index > m_count)
+        return tt::npos;
+    if (m_offsets.empty())
+        return 0;
+
+    auto base = m_offsets[index / m_interval];
+    return base + utf8_offset(m_str.substr(base), index % m_interval);
+}
+
+size_t utf8_index::index(size_t offset) const noexcept
+{
+    offset = std::min(offset, m_str.size());
+    auto next = std::upper_bound(m_offsets.begin(), m_offsets.end(), offset);
+    if (next == m_offsets.begin())
+        return 0;
+
+    auto block = static_cast<size_t>(next - m_offsets.begin()) - 1;
+    auto base = m_offsets[block];
+    return block * m_interval + utf8_count(m_str.substr(base, offset - base));
+}
+
+bool ttlib::utf8to16(std::string_view str, std::wstring& dest)
+{
+    auto offset = dest.size();
+    bool valid = true;
+    dest.resize(offset + wide_size_if_valid(str));
+    if (utf8_to_wide<true, true>(str, dest.data() + offset, valid) != tt::npos)
+        return true;
+
+    dest.resize(offset + utf8_to_wide<false, false>(str, nullptr, valid));
+    utf8_to_wide<true, false>(str, dest.data() + offset, valid);
+    return false;
+}
+
+bool ttlib::utf16to8(std::wstring_view str, std::string& dest)
+{
+    auto offset = dest.size();
+    bool valid = true;
+    dest.resize(offset + utf8_size_if_valid(str));
+    if (wide_to_utf8<true, true>(str, dest.data() + offset, valid) != tt::npos)
+        return true;
+
+    dest.resize(offset + wide_to_utf8<false, false>(str, nullptr, valid));
+    wide_to_utf8<true, false>(str, dest.data() + offset, valid);
+    return false;
+}
+
+std::wstring ttlib::utf8to16(std::string_view str)
+{
+    std::wstring str16;
+    ttlib::utf8to16(str, str16);
+    return str16;
+}
+
+ttlib::cstr ttlib::utf16to8(std::wstring_view str)
+{
+    ttlib::cstr str8;
+    ttlib::utf16to8(str, str8);
+    return str8;
+}
+
+tt::ENCODING ttlib::detect_encoding(std::string_view start, size_t& bom_size) noexcept
+{
+    auto bytes = reinterpret_cast<const unsigned char*>(start.data());
+    auto has_prefix = [&](std::string_view prefix)
+    {
+        return start.size() >= prefix.size() && start.substr(0, prefix.size()) == prefix;
+    };
+
+    // UTF-32LE must be checked before UTF-16LE since they start with the same two bytes
+    using namespace std::literals;
+    struct BOM
+    {
+        std::string_view bytes;
+        tt::ENCODING encoding;
+    };
+    static constexpr BOM boms[] = {
+        { "\xEF\xBB\xBF"sv, tt::ENCODING::utf8 },         { "\xFF\xFE\x00\x00"sv, tt::ENCODING::utf32le },
+        { "\x00\x00\xFE\xFF"sv, tt::ENCODING::utf32be }, { "\xFF\xFE"sv, tt::ENCODING::utf16le },
+        { "\xFE\xFF"sv, tt::ENCODING::utf16be },
+    };
+    for (auto& bom: boms)
+    {
+        if (has_prefix(bom.bytes))
+        {
+            bom_size = bom.bytes.size();
+            return bom.encoding;
+        }
+    }
+    bom_size = 0;
+
+    // Without a BOM, UTF-16 and UTF-32 text is recognized by the zero bytes in the high half of
+    // each character -- zeros are rare in the other encodings.
+    constexpr size_t sample_size = 4096;
+    size_t quads = (start.size() < sample_size ? start.size() : sample_size) / 4;
+    size_t zeros[4] = {};
+    for (size_t idx = 0; idx < quads * 4; ++idx)
+    {
+        if (!bytes[idx])
+            ++zeros[idx & 3];
+    }
+    if (quads && zeros[0] + zeros[1] + zeros[2] + zeros[3] > quads / 2)
+    {
+        if (zeros[3] == quads && zeros[2] >= quads / 2 && zeros[0] < quads / 2)
+            return tt::ENCODING::utf32le;
+        if (zeros[0] == quads && zeros[1] >= quads / 2 && zeros[3] < quads / 2)
+            return tt::ENCODING::utf32be;
+        if (zeros[1] + zeros[3] >= quads && zeros[0] + zeros[2] < quads / 4)
+            return tt::ENCODING::utf16le;
+        if (zeros[0] + zeros[2] >= quads && zeros[1] + zeros[3] < quads / 4)
+            return tt::ENCODING::utf16be;
+    }
+
+    // A full sample may end in the middle of a character, which isn't an error. Callers usually pass
+    // exactly sample_size bytes even when the file is larger, so that is treated as a full sample.
+    auto sample = start.substr(0, sample_size);
+    auto invalid = find_invalid_utf8(sample);
+    if (invalid != tt::npos && sample.size() == sample_size)
+    {
+        auto ptr = bytes + invalid;
+        auto end = bytes + sample.size();
+        size_t length;
+        if (*ptr >= 0xC2 && *ptr <= 0xF4 && decode_utf8(ptr, end, length) == bad_sequence && ptr + length == end)
+            invalid = tt::npos;
+    }
+    return invalid == tt::npos ? tt::ENCODING::utf8 : tt::ENCODING::windows_1252;
+}
+
+size_t text_decoder::max_output(size_t size) const noexcept
+{
+    switch (m_encoding)
+    {
+        case tt::ENCODING::utf16le:
+        case tt::ENCODING::utf16be:
+            // Each code unit is at most 3 bytes, and a surrogate pair is 4
+            return (size / 2 + 1) * 3;
+
+        case tt::ENCODING::utf32le:
+        case tt::ENCODING::utf32be:
+            return size + 4;
+
+        default:
+            return size * 3;
+    }
+}
+
+size_t text_decoder::convert(const unsigned char* src, size_t size, char* dest, size_t& consumed, bool final) noexcept
+{
+    char* out = dest;
+    size_t pos = 0;
+    auto write = [&](uint32_t code)
+    {
+        encode_utf8(code, out);
+        out += utf8_length(code);
+    };
+    auto write_invalid = [&]()
+    {
+        write(replacement_char);
+        m_valid = false;
+    };
+
+    switch (m_encoding)
+    {
+        case tt::ENCODING::utf8:
+            std::memcpy(dest, src, size);
+            out += size;
+            pos = size;
+            break;
+
+        case tt::ENCODING::windows_1252:
+            while (pos < size)
+            {
+#if defined(TTLIB_SIMD_X86)
+                if (src[pos] < 0x80 && size - pos >= 16)
+                {
+                    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + pos));
+                    auto non_ascii = static_cast<uint32_t>(_mm_movemask_epi8(bytes));
+                    auto ascii_count = non_ascii ? ctz32(non_ascii) : 16;
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), bytes);
+                    out += ascii_count;
+                    pos += ascii_count;
+                    continue;
+                }
+#endif  // TTLIB_SIMD_X86
+                uint32_t ch = src[pos++];
+                write((ch >= 0x80 && ch < 0xA0) ? windows_1252_table[ch - 0x80] : ch);
+            }
+            break;
+
+        case tt::ENCODING::utf16le:
+        case tt::ENCODING::utf16be:
+            {
+                bool big_endian = (m_encoding == tt::ENCODING::utf16be);
+                while (pos + 2 <= size)
+                {
+#if defined(TTLIB_SIMD_X86)
+                    if (size - pos >= 16)
+                    {
+                        // Narrow 8 code units at a time if they are all ASCII
+                        __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + pos));
+                        if (big_endian)
+                            units = _mm_or_si128(_mm_slli_epi16(units, 8), _mm_srli_epi16(units, 8));
+                        __m128i non_ascii = _mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xFF80)));
+                        if (_mm_movemask_epi8(_mm_cmpeq_epi16(non_ascii, _mm_setzero_si128())) == 0xFFFF)
+                        {
+                            _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(units, units));
+                            out += 8;
+                            pos += 16;
+                            continue;
+                        }
+                    }
+#endif  // TTLIB_SIMD_X86
+
+                    uint32_t unit = read16(src + pos, big_endian);
+                    if (unit < 0xD800 || unit > 0xDFFF)
+                    {
+                        write(unit);
+                        pos += 2;
+                        continue;
+                    }
+                    if (unit <= 0xDBFF)
+                    {
+                        if (pos + 4 > size)
+                        {
+                            if (!final)
+                                break;  // the low surrogate is in the next block
+
+                            // A high surrogate followed by part of a code unit is a single error
+                            write_invalid();
+                            pos = size;
+                            break;
+                        }
+                        uint32_t next = read16(src + pos + 2, big_endian);
+                        if (next >= 0xDC00 && next <= 0xDFFF)
+                        {
+                            write(((unit - 0xD800) << 10) + (next - 0xDC00) + 0x10000);
+                            pos += 4;
+                            continue;
+                        }
+                    }
+                    write_invalid();
+                    pos += 2;
+                }
+                break;
+            }
+
+        case tt::ENCODING::utf32le:
+        case tt::ENCODING::utf32be:
+            {
+                bool big_endian = (m_encoding == tt::ENCODING::utf32be);
+                for (; pos + 4 <= size; pos += 4)
+                {
+                    uint32_t code = read32(src + pos, big_endian);
+                    if (code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF))
+                        write_invalid();
+                    else
+                        write(code);
+                }
+                break;
+            }
+    }
+
+    // Part of a code unit at the end of the input
+    if (final && pos < size)
+    {
+        write_invalid();
+        pos = size;
+    }
+    consumed = pos;
+    return static_cast<size_t>(out - dest);
+}
+
+bool text_decoder::decode(std::string_view block, std::string& dest)
+{
+    if (m_encoding == tt::ENCODING::utf8)
+    {
+        dest += block;
+        return m_valid;
+    }
+
+    auto src = reinterpret_cast<const unsigned char*>(block.data());
+    size_t size = block.size();
+    auto offset = dest.size();
+    // The extra 16 bytes allow the ASCII loops to store a full register
+    dest.resize(offset + max_output(size + m_pending_size) + 16);
+    char* out = dest.data() + offset;
+
+    size_t consumed;
+    if (m_pending_size)
+    {
+        // Complete the character that was split between blocks
+        unsigned char combined[sizeof(m_pending) * 2];
+        size_t extra = (size < sizeof(combined) - m_pending_size) ? size : sizeof(combined) - m_pending_size;
+        std::memcpy(combined, m_pending, m_pending_size);
+        std::memcpy(combined + m_pending_size, src, extra);
+        out += convert(combined, m_pending_size + extra, out, consumed, false);
+        if (consumed < m_pending_size)
+        {
+            // The block was too small to complete the character
+            m_pending_size = m_pending_size + extra - consumed;
+            std::memmove(m_pending, combined + consumed, m_pending_size);
+            dest.resize(static_cast<size_t>(out - dest.data()));
+            return m_valid;
+        }
+        src += consumed - m_pending_size;
+        size -= consumed - m_pending_size;
+        m_pending_size = 0;
+    }
+
+    out += convert(src, size, out, consumed, false);
+    m_pending_size = size - consumed;
+    std::memcpy(m_pending, src + consumed, m_pending_size);
+    dest.resize(static_cast<size_t>(out - dest.data()));
+    return m_valid;
+}
+
+bool text_decoder::finish(std::string& dest)
+{
+    if (m_pending_size)
+    {
+        char buffer[sizeof(m_pending) * 3 + 16];
+        size_t consumed;
+        dest.append(buffer, convert(m_pending, m_pending_size, buffer, consumed, true));
+        m_pending_size = 0;
+    }
+    return m_valid;
+}